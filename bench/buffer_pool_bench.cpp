@@ -0,0 +1,174 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "event_loop.h"
+#include "task.h"
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    constexpr page_id_t NUM_PAGES = 4096;
+
+    struct Pool {
+        std::shared_ptr<DiskManager> m_diskManager;
+        IoId_t                       m_id;
+        std::unique_ptr<BufferPool>  m_pool;
+
+        explicit Pool(size_t numFrames)
+            : m_diskManager{std::make_shared<DiskManager>()},
+              m_id{m_diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B)},
+              m_pool{std::make_unique<BufferPool>(numFrames, m_diskManager)} {}
+    };
+
+    // Fixed seed so that every run probes the same pages.
+    std::vector<page_id_t> randomPages() {
+        std::mt19937                             rng(42);
+        std::uniform_int_distribution<page_id_t> pick(0, NUM_PAGES - 1);
+        std::vector<page_id_t>                   pages(1 << 16);
+        for (auto &p : pages) {
+            p = pick(rng);
+        }
+        return pages;
+    }
+
+    // Loaded once, before any thread of a run starts probing.
+    Pool &residentPool() {
+        static Pool pool = [] {
+            Pool pool(NUM_PAGES);
+            for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+                auto guard = pool.m_pool->GetPage(pool.m_id, p);
+            }
+            return pool;
+        }();
+        return pool;
+    }
+
+    // All pages resident, every access is a hit.
+    void BM_GetPageHit(benchmark::State &state) {
+        Pool       &pool  = residentPool();
+        static auto pages = randomPages();
+
+        size_t i = state.thread_index() * 997;
+        for (auto _ : state) {
+            auto guard = pool.m_pool->GetPage(
+                pool.m_id, pages[i++ & (pages.size() - 1)]);
+            benchmark::DoNotOptimize(guard.getRawPage().iov_base);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Pool holds 1/64th of pages and pages are walked in order, so every
+    // access misses and evicts.
+    void BM_GetPageMiss(benchmark::State &state) {
+        Pool pool(NUM_PAGES / 64);
+
+        page_id_t p = 0;
+        for (auto _ : state) {
+            auto guard = pool.m_pool->GetPage(pool.m_id, p++ % NUM_PAGES);
+            benchmark::DoNotOptimize(guard.getRawPage().iov_base);
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * PAGE_SIZE_B);
+    }
+
+    // Same as miss but every page is dirtied, so eviction also writes back.
+    void BM_GetPageMissDirty(benchmark::State &state) {
+        Pool pool(NUM_PAGES / 64);
+
+        page_id_t p = 0;
+        for (auto _ : state) {
+            auto guard = pool.m_pool->GetPage(pool.m_id, p++ % NUM_PAGES,
+                                              LatchMode::EXCLUSIVE);
+            guard.markDirty();
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Every thread reads the same page, argument is the LatchMode. Shared
+    // readers write to the latch, optimistic ones only validate.
+    void BM_ReadHotPage(benchmark::State &state) {
+        Pool &pool = residentPool();
+        auto  mode = static_cast<LatchMode>(state.range(0));
+
+        for (auto _ : state) {
+            uint64_t value;
+            do {
+                auto guard = pool.m_pool->GetPage(pool.m_id, 0, mode);
+                memcpy(&value, guard.getRawPage().iov_base, sizeof(value));
+                if (guard.validate()) {
+                    break;
+                }
+            } while (true);
+            benchmark::DoNotOptimize(value);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Pool holds 1/16th of pages, so nearly every random access misses and
+    // waits for the read latency of a device.
+    constexpr auto READ_LATENCY = std::chrono::microseconds(50);
+
+    void BM_GetPageMissLatency(benchmark::State &state) {
+        Pool pool(NUM_PAGES / 16);
+        pool.m_diskManager->setReadLatency(READ_LATENCY);
+        static auto pages = randomPages();
+
+        size_t i = 0;
+        for (auto _ : state) {
+            auto guard = pool.m_pool->GetPage(
+                pool.m_id, pages[i++ & (pages.size() - 1)]);
+            benchmark::DoNotOptimize(guard.getRawPage().iov_base);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Same accesses from one thread with getPageAsync, argument is the
+    // number of fetches in flight.
+    void BM_GetPageAsyncMissLatency(benchmark::State &state) {
+        Pool pool(NUM_PAGES / 16);
+        pool.m_diskManager->setReadLatency(READ_LATENCY);
+        static auto pages    = randomPages();
+        auto        inFlight = static_cast<size_t>(state.range(0));
+
+        EventLoop loop;
+        size_t    i = 0;
+        for (auto _ : state) {
+            for (size_t t = 0; t < inFlight; ++t) {
+                loop.spawn([](Pool &pool, page_id_t page) -> Task<void> {
+                    BufferPool::BufferPoolPageGuard guard;
+                    auto err = co_await pool.m_pool->getPageAsync(
+                        pool.m_id, page, LatchMode::SHARED, guard);
+                    benchmark::DoNotOptimize(err.code());
+                    benchmark::DoNotOptimize(guard.getRawPage().iov_base);
+                }(pool, pages[i++ & (pages.size() - 1)]));
+            }
+            loop.run();
+        }
+        state.SetItemsProcessed(state.iterations() * inFlight);
+    }
+
+} // namespace
+
+BENCHMARK(BM_GetPageHit)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_ReadHotPage)
+    ->ArgName("mode")
+    ->Arg(static_cast<int>(LatchMode::OPTIMISTIC))
+    ->Arg(static_cast<int>(LatchMode::SHARED))
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK(BM_GetPageMiss);
+BENCHMARK(BM_GetPageMissDirty);
+BENCHMARK(BM_GetPageMissLatency)->UseRealTime();
+BENCHMARK(BM_GetPageAsyncMissLatency)
+    ->ArgName("in_flight")
+    ->RangeMultiplier(4)
+    ->Range(1, 64)
+    ->UseRealTime();
\ No newline at end of file
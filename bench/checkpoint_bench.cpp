@@ -0,0 +1,83 @@
+#include "buffer_pool.h"
+#include "checkpointer.h"
+#include "core.h"
+#include "disk-manager.h"
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    constexpr page_id_t NUM_PAGES = 4096;
+
+    // Single page updates on a fully resident pool while checkpoints run
+    // back to back. Argument 0 runs no checkpoints, 1 writes as fast as it
+    // can and 2 is limited to 100k pages per second. Reports the latency
+    // percentiles of updates as counters.
+    void BM_UpdateDuringCheckpoint(benchmark::State &state) {
+        auto diskManager = std::make_shared<DiskManager>();
+        auto id          = diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B);
+        auto pool        = std::make_shared<BufferPool>(NUM_PAGES, diskManager);
+        for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+            auto guard = pool->GetPage(id, p);
+        }
+
+        CheckpointerOptions options;
+        options.m_interval       = std::chrono::milliseconds(0);
+        options.m_pagesPerSecond = state.range(0) == 2 ? 100'000 : 0;
+        Checkpointer checkpointer(pool, options);
+        if (state.range(0) != 0) {
+            checkpointer.start();
+        }
+
+        std::mt19937                             rng(42);
+        std::uniform_int_distribution<page_id_t> pick(0, NUM_PAGES - 1);
+        std::vector<uint64_t>                    latencies;
+        latencies.reserve(1 << 20);
+        uint64_t value = 0;
+        for (auto _ : state) {
+            auto start = std::chrono::steady_clock::now();
+            {
+                auto guard = pool->GetPage(id, pick(rng), LatchMode::EXCLUSIVE);
+                memcpy(guard.getRawPage().iov_base, &++value, sizeof(value));
+                guard.markDirty();
+            }
+            auto end = std::chrono::steady_clock::now();
+            if (latencies.size() < latencies.capacity()) {
+                latencies.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        end - start)
+                        .count());
+            }
+        }
+        checkpointer.stop();
+
+        std::sort(latencies.begin(), latencies.end());
+        auto at = [&latencies](double q) {
+            return latencies.empty()
+                       ? 0
+                       : latencies[static_cast<size_t>(
+                             q * (latencies.size() - 1))];
+        };
+        state.counters["p50_ns"]         = at(0.5);
+        state.counters["p99_ns"]         = at(0.99);
+        state.counters["p999_ns"]        = at(0.999);
+        state.counters["checkpoint_lsn"] = checkpointer.getCheckpointLsn();
+        state.SetItemsProcessed(state.iterations());
+    }
+
+} // namespace
+
+BENCHMARK(BM_UpdateDuringCheckpoint)
+    ->ArgName("checkpoint")
+    ->Arg(0)
+    ->Arg(1)
+    ->Arg(2)
+    ->UseRealTime();
\ No newline at end of file
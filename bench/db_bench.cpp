@@ -0,0 +1,202 @@
+#include "metrics.h"
+#include "pigdb/db.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Pig;
+
+namespace {
+
+    constexpr int32_t NUM_ROWS = 10000;
+    // Fewer than the plan cache holds, so repeated texts stay cached.
+    constexpr int32_t NUM_TEXTS = 512;
+
+    std::unique_ptr<Database> loadDatabase(size_t planCacheSize) {
+        DatabaseOptions options;
+        options.m_poolFrames    = 512;
+        options.m_pagesPerTable = 256;
+        options.m_planCacheSize = planCacheSize;
+        std::unique_ptr<Database> db;
+        if (!Database::open(options, db).ok() ||
+            !db->execute("CREATE TABLE t (id INT PRIMARY KEY, a INT, b INT)")
+                 .ok()) {
+            return nullptr;
+        }
+        Statement insert;
+        ResultSet result;
+        if (!db->prepare("INSERT INTO t VALUES (?, ?, ?)", insert).ok()) {
+            return nullptr;
+        }
+        for (int32_t id = 0; id < NUM_ROWS; ++id) {
+            insert.bind(0, id);
+            insert.bind(1, id * 2);
+            insert.bind(2, id * 3);
+            if (!insert.execute(result).ok()) {
+                return nullptr;
+            }
+        }
+        return db;
+    }
+
+    // Fixed seed so that every run probes the same keys.
+    std::vector<int32_t> randomKeys(int32_t bound) {
+        std::mt19937                           rng(42);
+        std::uniform_int_distribution<int32_t> pick(0, bound - 1);
+        std::vector<int32_t>                   keys(1 << 16);
+        for (auto &k : keys) {
+            k = pick(rng);
+        }
+        return keys;
+    }
+
+    std::vector<std::string> pointQueries(const std::vector<int32_t> &keys) {
+        std::vector<std::string> queries;
+        for (int32_t key : keys) {
+            queries.push_back("SELECT a, b FROM t WHERE id = " +
+                              std::to_string(key));
+        }
+        return queries;
+    }
+
+    // Parsed and planned once, only the key is bound per query. Same keys
+    // as the ad-hoc queries so that the rows read are the same.
+    void BM_DbPointQueryPrepared(benchmark::State &state) {
+        static auto db   = loadDatabase(1024);
+        static auto keys = randomKeys(NUM_TEXTS);
+        Statement   select;
+        if (!db || !db->prepare("SELECT a, b FROM t WHERE id = ?", select)
+                        .ok()) {
+            state.SkipWithError("Failed to prepare");
+            return;
+        }
+
+        ResultSet result;
+        size_t    i = 0;
+        for (auto _ : state) {
+            select.bind(0, keys[i++ & (keys.size() - 1)]);
+            benchmark::DoNotOptimize(select.execute(result).ok());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Statement text per query, argument is whether plans are cached. The
+    // texts repeat so with the cache on every query hits it, with it off
+    // every query is parsed and planned.
+    void BM_DbPointQueryAdHoc(benchmark::State &state) {
+        static auto withCache    = loadDatabase(1024);
+        static auto withoutCache = loadDatabase(0);
+        static auto queries      = pointQueries(randomKeys(NUM_TEXTS));
+        auto       &db = state.range(0) != 0 ? withCache : withoutCache;
+        if (!db) {
+            state.SkipWithError("Failed to load");
+            return;
+        }
+
+        ResultSet result;
+        size_t    i = 0;
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(
+                db->execute(queries[i++ & (queries.size() - 1)], result)
+                    .ok());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    constexpr int32_t  SCAN_ROWS  = 200000;
+    constexpr uint16_t SCAN_PAGES = 2048;
+
+    // Resident in the pool, so scans are bound by CPU and not IO.
+    std::unique_ptr<Database> loadScanDatabase(uint32_t scanThreads) {
+        DatabaseOptions options;
+        options.m_poolFrames    = SCAN_PAGES * 2;
+        options.m_pagesPerTable = SCAN_PAGES;
+        options.m_scanThreads   = scanThreads;
+        std::unique_ptr<Database> db;
+        Statement                 insert;
+        ResultSet                 result;
+        if (!Database::open(options, db).ok() ||
+            !db->execute("CREATE TABLE t (id INT PRIMARY KEY, a INT, b INT)")
+                 .ok() ||
+            !db->prepare("INSERT INTO t VALUES (?, ?, ?)", insert).ok()) {
+            return nullptr;
+        }
+        for (int32_t id = 0; id < SCAN_ROWS; ++id) {
+            insert.bind(0, id);
+            insert.bind(1, (id * 7919) % 1000);
+            // Grows with the insert order, like a timestamp.
+            insert.bind(2, id);
+            if (!insert.execute(result).ok()) {
+                return nullptr;
+            }
+        }
+        return db;
+    }
+
+    // Full scan with a filter on a column that is not the key, argument is
+    // the number of scan threads.
+    void scanQuery(benchmark::State &state, const char *sql) {
+        static std::unique_ptr<Database> dbs[65];
+        auto threads = static_cast<uint32_t>(state.range(0));
+        if (!dbs[threads]) {
+            dbs[threads] = loadScanDatabase(threads);
+        }
+        if (!dbs[threads]) {
+            state.SkipWithError("Failed to load");
+            return;
+        }
+
+        ResultSet result;
+        auto      skippedPages = [] {
+            return Core::Metrics::global().snapshot().get(
+                Core::Counter::ZONE_MAP_SKIPPED_PAGES);
+        };
+        uint64_t skipped = skippedPages();
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(dbs[threads]->execute(sql, result).ok());
+        }
+        skipped = skippedPages() - skipped;
+        state.SetItemsProcessed(state.iterations() * SCAN_ROWS);
+        state.counters["skipped_pages"] = benchmark::Counter(
+            static_cast<double>(skipped), benchmark::Counter::kAvgIterations);
+    }
+
+    void BM_DbScanAggregate(benchmark::State &state) {
+        scanQuery(state, "SELECT COUNT(*), SUM(a), MIN(a), MAX(a) FROM t "
+                         "WHERE a < 500");
+    }
+
+    void BM_DbScanFilter(benchmark::State &state) {
+        scanQuery(state, "SELECT id, a FROM t WHERE a = 7");
+    }
+
+    // 1% of the rows either way. Those of the first are in the pages
+    // loaded first, so zone maps skip the others, those of the second are
+    // spread over every page.
+    void BM_DbScanClustered(benchmark::State &state) {
+        scanQuery(state, "SELECT COUNT(*) FROM t WHERE b < 2000");
+    }
+
+    void BM_DbScanSpread(benchmark::State &state) {
+        scanQuery(state, "SELECT COUNT(*) FROM t WHERE a < 10");
+    }
+
+} // namespace
+
+BENCHMARK(BM_DbPointQueryPrepared);
+BENCHMARK(BM_DbPointQueryAdHoc)->ArgName("cached")->Arg(0)->Arg(1);
+BENCHMARK(BM_DbScanAggregate)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK(BM_DbScanFilter)
+    ->ArgName("threads")
+    ->RangeMultiplier(2)
+    ->Range(1, 64)
+    ->UseRealTime();
+BENCHMARK(BM_DbScanClustered)->ArgName("threads")->Arg(1)->UseRealTime();
+BENCHMARK(BM_DbScanSpread)->ArgName("threads")->Arg(1)->UseRealTime();
\ No newline at end of file
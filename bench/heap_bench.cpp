@@ -0,0 +1,283 @@
+#include "buffer_pool.h"
+#include "checksum.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include "util.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <sys/uio.h>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+    // Heap allocations of the calling thread while counting is on. Only the
+    // lookup benchmarks turn it on, the others pay for a thread local load
+    // on each allocation and no shared write.
+    thread_local bool     t_countAllocations = false;
+    thread_local uint64_t t_allocations      = 0;
+} // namespace
+
+// Not inlined, GCC flags free on memory from an inlined operator new.
+__attribute__((noinline)) void *operator new(size_t size) {
+    if (t_countAllocations) {
+        ++t_allocations;
+    }
+    if (void *p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+    constexpr page_id_t NUM_PAGES = 1024;
+
+    iovec makeTuple(std::vector<unsigned char> &payload) {
+        iovec tuple;
+        tuple.iov_base = payload.data();
+        tuple.iov_len  = payload.size();
+        return tuple;
+    }
+
+    // Tuple size in bytes is the argument.
+    void BM_PageAddTuple(benchmark::State &state) {
+        std::vector<unsigned char> payload(state.range(0), 7);
+        HeapFile::Tuple            tuple(0, makeTuple(payload));
+        std::vector<unsigned char> pageBuf(PAGE_SIZE_B);
+        iovec                      buf;
+        buf.iov_base = pageBuf.data();
+        buf.iov_len  = PAGE_SIZE_B;
+
+        auto page = std::make_unique<HeapFile::Page>(0);
+        page->initPage(buf);
+        for (auto _ : state) {
+            if (page->getFreeBytes() < HeapFile::Page::spaceForTuple(tuple)) {
+                // Reset is amortized over a page worth of tuples.
+                page = std::make_unique<HeapFile::Page>(0);
+                page->initPage(buf);
+            }
+            benchmark::DoNotOptimize(page->addTuple(tuple));
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    // Checksum, free space map, buffer pool and page, all resident.
+    void BM_HeapAddTuple(benchmark::State &state) {
+        std::vector<unsigned char> payload(state.range(0), 7);
+        iovec                      tuple = makeTuple(payload);
+        size_t                     maxTuples =
+            NUM_PAGES *
+            (HeapFile::Page::FREE_BYTES /
+             HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuple)));
+
+        std::shared_ptr<DiskManager> diskManager;
+        std::shared_ptr<BufferPool>  bufferPool;
+        std::unique_ptr<HeapFile>    heap;
+        size_t                       inserted = maxTuples;
+        for (auto _ : state) {
+            if (inserted == maxTuples) {
+                // Heap does not grow, start over on a fresh one.
+                state.PauseTiming();
+                heap.reset();
+                diskManager = std::make_shared<DiskManager>();
+                bufferPool  = std::make_shared<BufferPool>(
+                    NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+                heap     = HeapFile::create(diskManager, bufferPool,
+                                            PAGE_SIZE_B, NUM_PAGES);
+                inserted = 0;
+                state.ResumeTiming();
+            }
+            TupleId id;
+            auto    err = heap->addTuple(tuple, id);
+            benchmark::DoNotOptimize(err.code());
+            ++inserted;
+        }
+        state.SetItemsProcessed(state.iterations());
+        state.SetBytesProcessed(state.iterations() * state.range(0));
+    }
+
+    // Checksum, free space map, buffer pool and page, a batch of 64 tuples
+    // per call. Tuple size and checksum type are the arguments.
+    void BM_HeapAddTuples(benchmark::State &state) {
+        auto type = static_cast<ChecksumType>(state.range(1));
+
+        constexpr size_t           BATCH = 64;
+        std::vector<unsigned char> payload(state.range(0), 7);
+        std::vector<iovec>         tuples(BATCH, makeTuple(payload));
+        std::vector<TupleId>       ids(BATCH);
+        size_t                     maxBatches =
+            NUM_PAGES *
+            (HeapFile::Page::FREE_BYTES /
+             HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuples[0]))) /
+            BATCH;
+
+        std::shared_ptr<DiskManager> diskManager;
+        std::shared_ptr<BufferPool>  bufferPool;
+        std::unique_ptr<HeapFile>    heap;
+        size_t                       inserted = maxBatches;
+        for (auto _ : state) {
+            if (inserted == maxBatches) {
+                state.PauseTiming();
+                heap.reset();
+                diskManager = std::make_shared<DiskManager>();
+                bufferPool  = std::make_shared<BufferPool>(
+                    NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+                heap     = HeapFile::create(diskManager, bufferPool,
+                                            PAGE_SIZE_B, NUM_PAGES, type);
+                inserted = 0;
+                state.ResumeTiming();
+            }
+            auto err = heap->addTuples(tuples.data(), BATCH, ids.data());
+            benchmark::DoNotOptimize(err.code());
+            ++inserted;
+        }
+        state.SetItemsProcessed(state.iterations() * BATCH);
+        state.SetBytesProcessed(state.iterations() * BATCH * state.range(0));
+    }
+
+    constexpr size_t LOOKUP_TUPLES = 4096;
+
+    // Heap of LOOKUP_TUPLES tuples of tupleSize bytes, ids in insert order.
+    std::unique_ptr<HeapFile> makeLookupHeap(size_t                tupleSize,
+                                             std::vector<TupleId> &ids) {
+        auto diskManager = std::make_shared<DiskManager>();
+        auto bufferPool  = std::make_shared<BufferPool>(
+            NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+        auto heap =
+            HeapFile::create(diskManager, bufferPool, PAGE_SIZE_B, NUM_PAGES);
+        std::vector<unsigned char> payload(tupleSize, 7);
+        std::vector<iovec>         tuples(LOOKUP_TUPLES, makeTuple(payload));
+        ids.resize(LOOKUP_TUPLES);
+        if (heap->addTuples(tuples.data(), tuples.size(), ids.data())) {
+            return nullptr;
+        }
+        return heap;
+    }
+
+    // Point lookups copying the payload out, tuple size is the argument.
+    void BM_HeapGetTuple(benchmark::State &state) {
+        std::vector<TupleId> ids;
+        auto                 heap = makeLookupHeap(state.range(0), ids);
+        size_t               i    = 0;
+        t_allocations             = 0;
+        t_countAllocations        = true;
+        for (auto _ : state) {
+            std::vector<unsigned char> payload;
+            auto err = heap->getTuple(ids[i++ % ids.size()], payload);
+            benchmark::DoNotOptimize(err.code());
+            benchmark::DoNotOptimize(payload.data());
+        }
+        t_countAllocations              = false;
+        state.counters["allocs_per_op"] = benchmark::Counter(
+            t_allocations, benchmark::Counter::kAvgIterations);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Same lookups through views into the frames.
+    void BM_HeapViewTuple(benchmark::State &state) {
+        std::vector<TupleId> ids;
+        auto                 heap = makeLookupHeap(state.range(0), ids);
+        size_t               i    = 0;
+        t_allocations             = 0;
+        t_countAllocations        = true;
+        HeapFile::TupleView view;
+        for (auto _ : state) {
+            auto err = heap->viewTuple(ids[i++ % ids.size()], view);
+            benchmark::DoNotOptimize(err.code());
+            benchmark::DoNotOptimize(view.data());
+        }
+        t_countAllocations              = false;
+        state.counters["allocs_per_op"] = benchmark::Counter(
+            t_allocations, benchmark::Counter::kAvgIterations);
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Deletes and inserts in a full heap, the insert only finds space as
+    // the delete compacts the page and updates the free space map. Tuple
+    // size is the argument.
+    void BM_HeapDeleteInsert(benchmark::State &state) {
+        constexpr page_id_t        CHURN_PAGES = 16;
+        std::vector<unsigned char> payload(state.range(0), 7);
+        iovec                      tuple = makeTuple(payload);
+        size_t                     numTuples =
+            CHURN_PAGES *
+            (HeapFile::Page::FREE_BYTES /
+             HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuple)));
+
+        auto diskManager = std::make_shared<DiskManager>();
+        auto bufferPool  = std::make_shared<BufferPool>(
+            CHURN_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+        auto heap = HeapFile::create(diskManager, bufferPool, PAGE_SIZE_B,
+                                     CHURN_PAGES);
+        std::vector<iovec>   tuples(numTuples, tuple);
+        std::vector<TupleId> ids(numTuples);
+        if (heap->addTuples(tuples.data(), numTuples, ids.data())) {
+            state.SkipWithError("Heap fill failed");
+            return;
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+            TupleId &id = ids[i++ % numTuples];
+            benchmark::DoNotOptimize(heap->deleteTuple(id).code());
+            benchmark::DoNotOptimize(heap->addTuple(tuple, id).code());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Checksum type and size in bytes are the arguments.
+    void BM_Checksum(benchmark::State &state) {
+        auto type = static_cast<ChecksumType>(state.range(0));
+
+        std::vector<unsigned char> payload(state.range(1), 7);
+        iovec                      data = makeTuple(payload);
+        for (auto _ : state) {
+            benchmark::DoNotOptimize(calculateChecksum(data, type));
+        }
+        state.SetBytesProcessed(state.iterations() * state.range(1));
+    }
+
+    // Same, 64 buffers per call.
+    void BM_ChecksumBatch(benchmark::State &state) {
+        auto type = static_cast<ChecksumType>(state.range(0));
+
+        constexpr size_t           BATCH = 64;
+        std::vector<unsigned char> payload(state.range(1) * BATCH, 7);
+        std::vector<iovec>         data(BATCH);
+        std::vector<uint32_t>      checksums(BATCH);
+        for (size_t i = 0; i < BATCH; ++i) {
+            data[i].iov_base = payload.data() + i * state.range(1);
+            data[i].iov_len  = state.range(1);
+        }
+        for (auto _ : state) {
+            calculateChecksums(data.data(), BATCH, type, checksums.data());
+            benchmark::DoNotOptimize(checksums.data());
+        }
+        state.SetItemsProcessed(state.iterations() * BATCH);
+        state.SetBytesProcessed(state.iterations() * BATCH * state.range(1));
+    }
+
+} // namespace
+
+BENCHMARK(BM_PageAddTuple)->Arg(16)->Arg(64)->Arg(256);
+BENCHMARK(BM_HeapAddTuple)->Arg(16)->Arg(64)->Arg(256);
+BENCHMARK(BM_HeapAddTuples)->ArgsProduct({{16, 64}, {0, 1, 2}});
+BENCHMARK(BM_HeapGetTuple)->Arg(16)->Arg(256);
+BENCHMARK(BM_HeapViewTuple)->Arg(16)->Arg(256);
+BENCHMARK(BM_HeapDeleteInsert)->Arg(16)->Arg(256);
+BENCHMARK(BM_Checksum)
+    ->ArgsProduct({{0, 1, 2}, benchmark::CreateRange(16, 4096, 4)});
+BENCHMARK(BM_ChecksumBatch)->ArgsProduct({{0, 1, 2}, {16, 64, 256}});
@@ -0,0 +1,40 @@
+#include "lock_free_stack.h"
+#include <benchmark/benchmark.h>
+#include <cstddef>
+
+using namespace Pig::Core;
+
+namespace {
+
+    // Shared by all threads of a run.
+    LockFreeStack<size_t> stack;
+
+    void BM_LockFreeStackPushPop(benchmark::State &state) {
+        size_t value = state.thread_index();
+        for (auto _ : state) {
+            stack.push(value);
+            benchmark::DoNotOptimize(stack.pop(&value));
+        }
+        state.SetItemsProcessed(state.iterations() * 2);
+    }
+
+    // Free frame list usage in buffer pool, a batch of pushes followed by
+    // pops.
+    void BM_LockFreeStackBatch(benchmark::State &state) {
+        size_t batch = state.range(0);
+        size_t value = 0;
+        for (auto _ : state) {
+            for (size_t i = 0; i < batch; ++i) {
+                stack.push(i);
+            }
+            for (size_t i = 0; i < batch; ++i) {
+                benchmark::DoNotOptimize(stack.pop(&value));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * batch * 2);
+    }
+
+} // namespace
+
+BENCHMARK(BM_LockFreeStackPushPop)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK(BM_LockFreeStackBatch)->Arg(64)->ThreadRange(1, 8)->UseRealTime();
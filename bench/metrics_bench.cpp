@@ -0,0 +1,83 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include "metrics.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <sys/uio.h>
+
+using namespace Pig::Core;
+
+namespace {
+
+    constexpr page_id_t NUM_PAGES = 1024;
+
+    // Arg 0 runs with metrics off and 1 with metrics on, the difference is
+    // the cost of instrumentation.
+    void BM_GetPageHitMetrics(benchmark::State &state) {
+        Metrics::global().setEnabled(state.range(0) != 0);
+
+        auto       diskManager = std::make_shared<DiskManager>();
+        IoId_t     id = diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B);
+        BufferPool pool(NUM_PAGES, diskManager);
+        for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+            auto guard = pool.GetPage(id, p);
+        }
+
+        page_id_t p = 0;
+        for (auto _ : state) {
+            auto guard = pool.GetPage(id, p++ % NUM_PAGES);
+            benchmark::DoNotOptimize(guard.getRawPage().iov_base);
+        }
+        state.SetItemsProcessed(state.iterations());
+        Metrics::global().setEnabled(true);
+    }
+
+    void BM_HeapInsertMetrics(benchmark::State &state) {
+        Metrics::global().setEnabled(state.range(0) != 0);
+
+        auto diskManager = std::make_shared<DiskManager>();
+        auto bufferPool  = std::make_shared<BufferPool>(
+            NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+        auto heap =
+            HeapFile::create(diskManager, bufferPool, PAGE_SIZE_B, NUM_PAGES);
+
+        uint32_t attrs[4] = {};
+        iovec    tuple;
+        tuple.iov_base = attrs;
+        tuple.iov_len  = sizeof(attrs);
+        // Stop well before the heap is full as it does not grow.
+        size_t maxTuples =
+            NUM_PAGES *
+            (HeapFile::Page::FREE_BYTES /
+             HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuple)));
+
+        size_t inserted = 0;
+        for (auto _ : state) {
+            if (inserted == maxTuples) {
+                state.SkipWithError("Heap is full");
+                break;
+            }
+            TupleId id;
+            auto    err = heap->addTuple(tuple, id);
+            benchmark::DoNotOptimize(err.code());
+            ++inserted;
+        }
+        state.SetItemsProcessed(state.iterations());
+        Metrics::global().setEnabled(true);
+    }
+
+    void BM_CounterAdd(benchmark::State &state) {
+        for (auto _ : state) {
+            Metrics::global().add(Counter::HEAP_INSERTS);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+} // namespace
+
+BENCHMARK(BM_GetPageHitMetrics)->Arg(0)->Arg(1);
+BENCHMARK(BM_HeapInsertMetrics)->Arg(0)->Arg(1)->Iterations(100000);
+BENCHMARK(BM_CounterAdd)->ThreadRange(1, 8);
@@ -0,0 +1,136 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include "transaction.h"
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    constexpr uint32_t PRELOAD_TUPLES  = 1 << 16;
+    constexpr uint32_t INSERTS_PER_TXN = 8;
+
+    // Heap with preloaded tuples and a writer committing inserts into it
+    // till the run ends.
+    struct Env {
+        std::shared_ptr<DiskManager> m_diskManager;
+        std::shared_ptr<BufferPool>  m_pool;
+        std::unique_ptr<HeapFile>    m_heap;
+        TransactionManager           m_txnManager;
+        std::vector<TupleId>         m_ids;
+
+        // Taken by the writer per transaction and by readers per read when
+        // comparing against a reader writer lock instead of snapshots.
+        std::shared_mutex m_lock;
+        const bool        k_locked;
+
+        std::atomic_bool      m_stop{false};
+        std::atomic<uint64_t> m_commits{0};
+        std::thread           m_writer;
+
+        explicit Env(bool locked)
+            : m_diskManager{std::make_shared<DiskManager>()},
+              m_pool{std::make_shared<BufferPool>(
+                  MAX_PAGES + HeapFile::RESERVED_PAGES, m_diskManager)},
+              m_heap{HeapFile::create(m_diskManager, m_pool)},
+              k_locked{locked} {
+            uint64_t value = 0;
+            iovec    buf;
+            buf.iov_base = &value;
+            buf.iov_len  = sizeof(value);
+            m_ids.resize(PRELOAD_TUPLES);
+            for (auto &id : m_ids) {
+                auto err = m_heap->addTuple(buf, id);
+                benchmark::DoNotOptimize(err.code());
+                ++value;
+            }
+            m_writer = std::thread([this] { write(); });
+        }
+
+        ~Env() {
+            m_stop = true;
+            m_writer.join();
+        }
+
+        void write() {
+            // Leave room so a full heap does not end the run early.
+            uint64_t capacity = MAX_PAGES * (HeapFile::Page::FREE_BYTES / 32);
+            uint64_t value    = 0;
+            iovec    buf;
+            buf.iov_base = &value;
+            buf.iov_len  = sizeof(value);
+            for (uint64_t inserted = PRELOAD_TUPLES;
+                 !m_stop && inserted + INSERTS_PER_TXN < capacity;
+                 inserted += INSERTS_PER_TXN) {
+                std::unique_lock<std::shared_mutex> lock(m_lock,
+                                                         std::defer_lock);
+                if (k_locked) {
+                    lock.lock();
+                }
+                auto txn = m_txnManager.beginWrite();
+                for (uint32_t i = 0; i < INSERTS_PER_TXN; ++i) {
+                    TupleId id;
+                    auto    err = m_heap->addTuple(txn, buf, id);
+                    benchmark::DoNotOptimize(err.code());
+                    ++value;
+                }
+                txn.commit();
+                m_commits.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    std::unique_ptr<Env> env;
+
+    // Point reads of random preloaded tuples while one writer commits
+    // inserts. Argument 0 reads through a snapshot, 1 takes a shared lock
+    // that the writer holds exclusively per transaction instead.
+    void BM_ReadDuringInserts(benchmark::State &state) {
+        if (state.thread_index() == 0) {
+            env = std::make_unique<Env>(state.range(0) == 1);
+        }
+
+        std::mt19937                            rng(42 + state.thread_index());
+        std::uniform_int_distribution<uint32_t> pick(0, PRELOAD_TUPLES - 1);
+        std::vector<unsigned char>              payload;
+        uint64_t                                commits = 0;
+        for (auto _ : state) {
+            const TupleId &id = env->m_ids[pick(rng)];
+            if (env->k_locked) {
+                std::shared_lock lock(env->m_lock);
+                auto err = env->m_heap->getTuple(id, payload);
+                benchmark::DoNotOptimize(err.code());
+            } else {
+                auto err = env->m_heap->getTuple(env->m_txnManager.snapshot(),
+                                                 id, payload);
+                benchmark::DoNotOptimize(err.code());
+            }
+        }
+        state.SetItemsProcessed(state.iterations());
+
+        if (state.thread_index() == 0) {
+            commits = env->m_commits.load();
+            env.reset();
+            state.counters["writer_commits"] = commits;
+        }
+    }
+
+} // namespace
+
+BENCHMARK(BM_ReadDuringInserts)
+    ->ArgName("locked")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
\ No newline at end of file
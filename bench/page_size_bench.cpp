@@ -0,0 +1,103 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <sys/uio.h>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    // Same amount of data for every page size so that runs do equal work.
+    constexpr uint64_t TABLE_BYTES = 16 * 1024 * 1024;
+    // 4 integer attributes.
+    constexpr uint32_t NUM_ATTRS = 4;
+
+    struct Table {
+        std::shared_ptr<DiskManager> m_diskManager;
+        std::shared_ptr<BufferPool>  m_bufferPool;
+        std::unique_ptr<HeapFile>    m_heap;
+        std::vector<TupleId>         m_tupleIds;
+    };
+
+    // Builds a fully cached table per page size once and reuses it across
+    // runs.
+    Table &getTable(page_size_t pageSize) {
+        static std::map<page_size_t, std::unique_ptr<Table>> tables;
+        if (auto it = tables.find(pageSize); it != tables.end()) {
+            return *it->second;
+        }
+
+        auto      table    = std::make_unique<Table>();
+        page_id_t numPages = TABLE_BYTES / pageSize;
+        table->m_diskManager = std::make_shared<DiskManager>();
+        table->m_bufferPool  = std::make_shared<BufferPool>(
+            numPages + HeapFile::RESERVED_PAGES, table->m_diskManager,
+            pageSize);
+        table->m_heap = HeapFile::create(
+            table->m_diskManager, table->m_bufferPool, pageSize, numPages);
+
+        uint32_t attrs[NUM_ATTRS] = {};
+        iovec    tuple;
+        tuple.iov_base = attrs;
+        tuple.iov_len  = sizeof(attrs);
+
+        size_t tuplesPerPage =
+            HeapFile::Page::freeBytesFor(pageSize) /
+            HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuple));
+        size_t numTuples = tuplesPerPage * numPages;
+        for (uint32_t i = 0; i < numTuples; ++i) {
+            attrs[0] = i;
+            TupleId id;
+            auto    err = table->m_heap->addTuple(tuple, id);
+            PIG_ASSERT(!err, "Insert failed while loading table");
+            table->m_tupleIds.push_back(id);
+        }
+        return *tables.emplace(pageSize, std::move(table)).first->second;
+    }
+
+    void BM_HeapScan(benchmark::State &state) {
+        Table &table = getTable(state.range(0) * 1024);
+
+        for (auto _ : state) {
+            uint64_t sum = 0;
+            auto     err = table.m_heap->scan([&sum](const TupleId &, iovec p) {
+                sum += *static_cast<uint32_t *>(p.iov_base);
+                return true;
+            });
+            benchmark::DoNotOptimize(err.code());
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(state.iterations() * table.m_tupleIds.size());
+        state.SetBytesProcessed(state.iterations() * TABLE_BYTES);
+    }
+
+    void BM_HeapPointLookup(benchmark::State &state) {
+        Table &table = getTable(state.range(0) * 1024);
+
+        std::mt19937_64                       rng(42);
+        std::uniform_int_distribution<size_t> pick(
+            0, table.m_tupleIds.size() - 1);
+        std::vector<unsigned char> payload;
+
+        for (auto _ : state) {
+            auto err =
+                table.m_heap->getTuple(table.m_tupleIds[pick(rng)], payload);
+            benchmark::DoNotOptimize(err.code());
+            benchmark::DoNotOptimize(payload.data());
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+} // namespace
+
+// Page size in KB.
+BENCHMARK(BM_HeapScan)->RangeMultiplier(2)->Range(4, 64)->Unit(
+    benchmark::kMillisecond);
+BENCHMARK(BM_HeapPointLookup)->RangeMultiplier(2)->Range(4, 64);
@@ -0,0 +1,120 @@
+#include "buffer_pool.h"
+#include "page_table.h"
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    // Keys of numFrames pages spread over 4 files, as a full pool would
+    // hold.
+    std::vector<BufferPoolKey_t> makeKeys(size_t numFrames) {
+        std::vector<BufferPoolKey_t> keys;
+        for (size_t i = 0; i < numFrames; ++i) {
+            keys.push_back(static_cast<BufferPoolKey_t>(i % 4) << 48 | i / 4);
+        }
+        return keys;
+    }
+
+    // Random probe order so that lookups do not walk the table linearly.
+    std::vector<BufferPoolKey_t>
+    makeProbes(const std::vector<BufferPoolKey_t> &keys) {
+        std::mt19937_64                       rng(42);
+        std::uniform_int_distribution<size_t> pick(0, keys.size() - 1);
+        std::vector<BufferPoolKey_t>          probes(1 << 16);
+        for (auto &p : probes) {
+            p = keys[pick(rng)];
+        }
+        return probes;
+    }
+
+    void BM_PageTableHit(benchmark::State &state) {
+        size_t                               numFrames = state.range(0);
+        auto                                 keys      = makeKeys(numFrames);
+        auto                                 probes    = makeProbes(keys);
+        PageTable<BufferPoolKey_t, uint32_t> table(numFrames);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            table.insert(keys[i], i);
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+            uint32_t frameId = 0;
+            benchmark::DoNotOptimize(
+                table.find(probes[i++ & (probes.size() - 1)], frameId));
+            benchmark::DoNotOptimize(frameId);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_UnorderedMapHit(benchmark::State &state) {
+        size_t numFrames = state.range(0);
+        auto   keys      = makeKeys(numFrames);
+        auto   probes    = makeProbes(keys);
+
+        std::unordered_map<BufferPoolKey_t, FrameId_t> map;
+        map.reserve(numFrames);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map[keys[i]] = i;
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+            auto it = map.find(probes[i++ & (probes.size() - 1)]);
+            benchmark::DoNotOptimize(it->second);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    // Evict one page and load another, as on every buffer pool miss.
+    void BM_PageTableChurn(benchmark::State &state) {
+        size_t                               numFrames = state.range(0);
+        auto                                 keys      = makeKeys(numFrames);
+        PageTable<BufferPoolKey_t, uint32_t> table(numFrames);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            table.insert(keys[i], i);
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+            size_t victim = i % numFrames;
+            table.erase(keys[victim]);
+            keys[victim] += 1 << 20;
+            table.insert(keys[victim], victim);
+            ++i;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_UnorderedMapChurn(benchmark::State &state) {
+        size_t numFrames = state.range(0);
+        auto   keys      = makeKeys(numFrames);
+
+        std::unordered_map<BufferPoolKey_t, FrameId_t> map;
+        map.reserve(numFrames);
+        for (size_t i = 0; i < keys.size(); ++i) {
+            map[keys[i]] = i;
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+            size_t victim = i % numFrames;
+            map.erase(keys[victim]);
+            keys[victim] += 1 << 20;
+            map[keys[victim]] = victim;
+            ++i;
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+} // namespace
+
+// Number of frames in pool.
+BENCHMARK(BM_PageTableHit)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_UnorderedMapHit)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_PageTableChurn)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
+BENCHMARK(BM_UnorderedMapChurn)->RangeMultiplier(16)->Range(1 << 10, 1 << 20);
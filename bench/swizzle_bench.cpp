@@ -0,0 +1,168 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "swip.h"
+#include <array>
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace Pig::Core;
+
+namespace {
+
+    // Three level tree standing in for a B+ tree index: a root, FANOUT
+    // inner pages and FANOUT^2 leaves of KEYS_PER_LEAF keys.
+    constexpr uint32_t  FANOUT        = 64;
+    constexpr uint32_t  KEYS_PER_LEAF = 64;
+    constexpr uint32_t  NUM_LEAVES    = FANOUT * FANOUT;
+    constexpr uint32_t  NUM_KEYS      = NUM_LEAVES * KEYS_PER_LEAF;
+    constexpr page_id_t NUM_PAGES     = 1 + FANOUT + NUM_LEAVES;
+
+    Swip &swipAt(BufferPool::BufferPoolPageGuard &guard, uint32_t child) {
+        return reinterpret_cast<Swip *>(guard.getRawPage().iov_base)[child];
+    }
+
+    uint64_t keyAt(BufferPool::BufferPoolPageGuard &guard, uint32_t slot) {
+        uint64_t key;
+        memcpy(&key,
+               static_cast<unsigned char *>(guard.getRawPage().iov_base) +
+                   slot * sizeof(key),
+               sizeof(key));
+        return key;
+    }
+
+    // Pool holds the whole tree, loaded before any thread traverses.
+    struct Tree {
+        std::shared_ptr<DiskManager> m_diskManager;
+        IoId_t                       m_id;
+        std::unique_ptr<BufferPool>  m_pool;
+
+        Tree()
+            : m_diskManager{std::make_shared<DiskManager>()},
+              m_id{m_diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B)},
+              m_pool{std::make_unique<BufferPool>(NUM_PAGES, m_diskManager)} {
+            for (page_id_t p = 0; p < 1 + FANOUT; ++p) {
+                auto guard = m_pool->GetPage(m_id, p, LatchMode::EXCLUSIVE);
+                for (uint32_t c = 0; c < FANOUT; ++c) {
+                    new (&swipAt(guard, c)) Swip(p * FANOUT + c + 1);
+                }
+                guard.markDirty();
+            }
+            for (uint32_t leaf = 0; leaf < NUM_LEAVES; ++leaf) {
+                auto guard = m_pool->GetPage(m_id, 1 + FANOUT + leaf,
+                                             LatchMode::EXCLUSIVE);
+                auto keys =
+                    static_cast<uint64_t *>(guard.getRawPage().iov_base);
+                for (uint32_t k = 0; k < KEYS_PER_LEAF; ++k) {
+                    keys[k] = leaf * KEYS_PER_LEAF + k;
+                }
+                guard.markDirty();
+            }
+        }
+    };
+
+    // Separate trees as following swips swizzles them for good.
+    Tree &tree(bool swizzled) {
+        static Tree byPageId;
+        static Tree bySwip;
+        return swizzled ? bySwip : byPageId;
+    }
+
+    // Same shape as plain heap objects, the speed to match.
+    struct Node {
+        std::array<Node *, FANOUT>          m_children{};
+        std::array<uint64_t, KEYS_PER_LEAF> m_keys{};
+    };
+
+    std::vector<std::unique_ptr<Node>> &inMemoryTree() {
+        static std::vector<std::unique_ptr<Node>> nodes = [] {
+            std::vector<std::unique_ptr<Node>> nodes(NUM_PAGES);
+            for (auto &node : nodes) {
+                node = std::make_unique<Node>();
+            }
+            for (uint32_t p = 0; p < 1 + FANOUT; ++p) {
+                for (uint32_t c = 0; c < FANOUT; ++c) {
+                    nodes[p]->m_children[c] = nodes[p * FANOUT + c + 1].get();
+                }
+            }
+            for (uint32_t leaf = 0; leaf < NUM_LEAVES; ++leaf) {
+                for (uint32_t k = 0; k < KEYS_PER_LEAF; ++k) {
+                    nodes[1 + FANOUT + leaf]->m_keys[k] =
+                        leaf * KEYS_PER_LEAF + k;
+                }
+            }
+            return nodes;
+        }();
+        return nodes;
+    }
+
+    // Fixed seed so that every run looks up the same keys.
+    std::vector<uint32_t> randomKeys() {
+        std::mt19937                            rng(42);
+        std::uniform_int_distribution<uint32_t> pick(0, NUM_KEYS - 1);
+        std::vector<uint32_t>                   keys(1 << 16);
+        for (auto &k : keys) {
+            k = pick(rng);
+        }
+        return keys;
+    }
+
+    // Root to leaf lookups with latch coupling, argument 1 follows swips
+    // through BufferPool::fix and 0 looks every child up by page id.
+    void BM_IndexLookup(benchmark::State &state) {
+        bool        swizzled = state.range(0) == 1;
+        Tree       &t        = tree(swizzled);
+        static auto keys     = randomKeys();
+
+        size_t i = state.thread_index() * 997;
+        for (auto _ : state) {
+            uint32_t key  = keys[i++ & (keys.size() - 1)];
+            uint32_t leaf = key / KEYS_PER_LEAF;
+            auto     node = t.m_pool->GetPage(t.m_id, 0);
+            for (uint32_t child : {leaf / FANOUT, leaf % FANOUT}) {
+                Swip                           &swip = swipAt(node, child);
+                BufferPool::BufferPoolPageGuard next;
+                auto err =
+                    swizzled ? t.m_pool->fix(node, t.m_id, swip,
+                                             LatchMode::SHARED, next)
+                             : t.m_pool->getPage(t.m_id, swip.getPageId(),
+                                                 LatchMode::SHARED, next);
+                benchmark::DoNotOptimize(err.code());
+                node = std::move(next);
+            }
+            benchmark::DoNotOptimize(keyAt(node, key % KEYS_PER_LEAF));
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+    void BM_IndexLookupInMemory(benchmark::State &state) {
+        auto       &nodes = inMemoryTree();
+        static auto keys  = randomKeys();
+
+        size_t i = state.thread_index() * 997;
+        for (auto _ : state) {
+            uint32_t key  = keys[i++ & (keys.size() - 1)];
+            uint32_t leaf = key / KEYS_PER_LEAF;
+            Node    *node = nodes[0].get();
+            node          = node->m_children[leaf / FANOUT];
+            node          = node->m_children[leaf % FANOUT];
+            benchmark::DoNotOptimize(node->m_keys[key % KEYS_PER_LEAF]);
+        }
+        state.SetItemsProcessed(state.iterations());
+    }
+
+} // namespace
+
+BENCHMARK(BM_IndexLookup)
+    ->ArgName("swizzled")
+    ->Arg(0)
+    ->Arg(1)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+BENCHMARK(BM_IndexLookupInMemory)->ThreadRange(1, 8)->UseRealTime();
\ No newline at end of file
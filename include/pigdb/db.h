@@ -1 +1,170 @@
-#ifndef
\ No newline at end of file
+#ifndef PIGDB_DB_H
+#define PIGDB_DB_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Pig {
+
+    // Same values as the errors of the storage engine, and SYNTAX_ERROR.
+    enum class StatusCode : int16_t {
+        OK             = 0,
+        NOT_FOUND      = 1,
+        ALREADY_EXISTS = 2,
+        INVALID_ARG    = 3,
+        NO_FREE_FRAME  = 4,
+        CORRUPTED      = 5,
+        SYNTAX_ERROR   = 100,
+    };
+
+    class Status {
+      public:
+        Status() = default;
+
+        Status(StatusCode code, std::string message)
+            : m_code{code}, m_message{std::move(message)} {}
+
+        bool ok() const noexcept { return m_code == StatusCode::OK; }
+
+        StatusCode code() const noexcept { return m_code; }
+
+        const std::string &message() const noexcept { return m_message; }
+
+      private:
+        StatusCode  m_code = StatusCode::OK;
+        std::string m_message;
+    };
+
+    /**
+    Rows returned by a SELECT, values are INT columns or aggregates of them,
+    which may need 64 bits. Reuse one across queries, it keeps its memory so
+    a point query does not allocate.
+     */
+    class ResultSet {
+      public:
+        const std::vector<std::string> &getColumns() const noexcept {
+            return m_columns;
+        }
+
+        size_t getNumRows() const noexcept {
+            return m_columns.empty() ? 0 : m_values.size() / m_columns.size();
+        }
+
+        int64_t get(size_t row, size_t column) const {
+            return m_values[row * m_columns.size() + column];
+        }
+
+      private:
+        friend class Database;
+
+        std::vector<std::string> m_columns;
+        std::vector<int64_t>     m_values;
+    };
+
+    struct DatabaseOptions {
+        // Frames of the buffer pool shared by all tables.
+        size_t m_poolFrames = 1024;
+        // Pages of each table, tables do not grow yet.
+        uint16_t m_pagesPerTable = 1024;
+        // Most statements whose plans are kept, 0 turns the cache off.
+        size_t m_planCacheSize = 1024;
+        // Threads scanning tables in parallel, 0 for one per core.
+        uint32_t m_scanThreads = 0;
+        // Pages a scan thread takes at a time.
+        uint16_t m_morselPages = 64;
+        // Pins scan threads to cores.
+        bool m_pinScanThreads = false;
+    };
+
+    class Database;
+
+    /**
+    A statement parsed and planned once, executed any number of times with
+    integer parameters bound to its ? placeholders. Not thread safe, use one
+    per thread. The database must outlive it.
+     */
+    class Statement {
+      public:
+        // Parsed and planned statement, shared with the plan cache.
+        struct Plan;
+
+        Statement();
+        Statement(Statement &&) noexcept;
+        Statement &operator=(Statement &&) noexcept;
+        ~Statement();
+
+        size_t getNumParams() const noexcept { return m_params.size(); }
+
+        // Binds the index-th ?, counting from 0, till bound again.
+        Status bind(size_t index, int32_t value);
+
+        // Every parameter must be bound, result is untouched unless SELECT.
+        Status execute(ResultSet &result);
+
+      private:
+        friend class Database;
+
+        Database                   *m_db = nullptr;
+        std::shared_ptr<const Plan> m_plan;
+        std::vector<int32_t>        m_params;
+        std::vector<bool>           m_isBound;
+    };
+
+    /**
+    An embedded database, safe to use from many threads.
+
+    Supports the grammar below, keywords in any case, integer columns only
+    and exactly one of them the primary key:
+
+        CREATE TABLE t (id INT PRIMARY KEY, a INT, ...)
+        INSERT INTO t VALUES (1, ?, ...)
+        SELECT * | col, ... FROM t [WHERE col = | != | < | <= | > | >= 1 | ?]
+        SELECT COUNT(*) | COUNT(col) | SUM(col) | MIN(col) | MAX(col), ...
+            FROM t [WHERE ...]
+
+    Aggregates return one row, there are no NULLs so SUM, MIN and MAX of no
+    rows are 0. Queries that do not use the primary key scan the table in
+    morsels of pages on all scan threads.
+
+    Plans of INSERT and SELECT are cached by statement text, so repeating a
+    statement skips parsing and planning. Tables live in memory for now, a
+    database is empty when opened.
+     */
+    class Database {
+      public:
+        [[nodiscard]] static Status open(const DatabaseOptions   &options,
+                                         std::unique_ptr<Database> &db);
+
+        Database(const Database &)            = delete;
+        Database &operator=(const Database &) = delete;
+
+        ~Database();
+
+        // Runs a statement without parameters.
+        Status execute(const std::string &sql, ResultSet &result);
+
+        Status execute(const std::string &sql);
+
+        Status prepare(const std::string &sql, Statement &statement);
+
+        // Number of plans in the cache.
+        size_t getNumCachedPlans() const;
+
+      private:
+        friend class Statement;
+
+        struct Impl;
+
+        explicit Database(std::unique_ptr<Impl> impl);
+
+        Status run(const Statement::Plan &plan, const int32_t *params,
+                   ResultSet &result);
+
+        std::unique_ptr<Impl> m_impl;
+    };
+} // namespace Pig
+
+#endif // PIGDB_DB_H
\ No newline at end of file
@@ -1,73 +1,676 @@
 #include "buffer_pool.h"
+#include "checksum.h"
 #include "core.h"
+#include "event_loop.h"
+#include "metrics.h"
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <exception>
 #include <memory>
 #include <mutex>
 #include <spdlog/spdlog.h>
 #include <stdexcept>
 #include <sys/uio.h>
+#include <vector>
 
 namespace Pig {
 
     namespace Core {
 
         BufferPool::BufferPool(size_t                       numFrames,
-                               std::shared_ptr<DiskManager> diskManager)
-            : m_diskManager{diskManager}, m_frames(numFrames) {
-            for (size_t in = 0; in < m_frames.size(); ++in) {
-                m_freeFrames.push(in);
+                               std::shared_ptr<DiskManager> diskManager,
+                               page_size_t                  pageSize,
+                               EvictionPolicy               policy)
+            : m_diskManager{diskManager}, k_pageSize{pageSize},
+              k_policy{policy} {
+            PIG_ASSERT(isValidPageSize(k_pageSize),
+                       fmt::format("Unsupported page size {}", k_pageSize));
+            m_checksumOffsets.fill(NO_PAGE_CHECKSUM);
+            auto err = resize(numFrames);
+            PIG_ASSERT(!err, "Failed to allocate buffer pool frames");
+        }
+
+        BufferPool::BufferPoolPageGuard
+        BufferPool::GetPage(IoId_t io_id, page_id_t page_id, LatchMode mode) {
+            BufferPoolPageGuard guard;
+            if (auto err = getPage(io_id, page_id, mode, guard); err) {
+                throw std::runtime_error{
+                    fmt::format("Err in getting page {} of file {}: {}",
+                                page_id, io_id, err.what())};
             }
+            return guard;
         }
 
-        BufferPool::BufferPoolPageGuard BufferPool::GetPage(IoId_t    io_id,
-                                                            page_id_t page_id) {
-            BufferPoolKey_t k;
-            k = static_cast<BufferPoolKey_t>(io_id) << 48;
-            k = k | static_cast<uint64_t>(page_id) >> 16;
-            spdlog::info("[GetPage]Buffer pool key for {} and {} is: {}", io_id,
-                         page_id, k);
+        Error BufferPool::getPage(IoId_t io_id, page_id_t page_id,
+                                  LatchMode mode, BufferPoolPageGuard &guard) {
+            if (auto err = pin(io_id, page_id, guard); err) {
+                return err;
+            }
+            guard.latch(mode);
+            return EMPRY_ERR;
+        }
 
-            std::shared_lock lock(m_mutex);
-            if (auto it = m_map.find(k); it != m_map.end()) {
-                spdlog::info("[GetPage] Found frame for key {}", k);
-                Frame &f = m_frames[it->second];
-                return BufferPoolPageGuard(f);
+        Task<Error> BufferPool::getPageAsync(IoId_t io_id, page_id_t page_id,
+                                             LatchMode            mode,
+                                             BufferPoolPageGuard &guard) {
+            BufferPoolKey_t k = makeKey(io_id, page_id);
+            while (true) {
+                Lookup page;
+                if (auto err = lookup(io_id, k, page); err) {
+                    co_return err;
+                }
+                if (page.m_loading != nullptr) {
+                    // The loader may be a task of this loop, waiting for
+                    // its latch would block the thread.
+                    co_await EventLoop::yield();
+                    continue;
+                }
+                if (!page.m_loader) {
+                    guard = std::move(page.m_guard);
+                    guard.latch(mode);
+                    co_return EMPRY_ERR;
+                }
+
+                ScopedLatency missLatency(Histogram::BUFFER_POOL_MISS_LATENCY);
+                iovec         buffer = page.m_guard.getRawPage();
+                Error         err    = co_await m_diskManager->readAsync(
+                    io_id, static_cast<uint64_t>(page_id) * k_pageSize, buffer);
+                if (!err) {
+                    err = verifyPage(io_id, page_id, buffer);
+                }
+                if (err) {
+                    abortLoad(page);
+                    co_return err;
+                }
+                finishLoad(page);
+                guard = std::move(page.m_guard);
+                guard.latch(mode);
+                co_return EMPRY_ERR;
             }
-            lock.unlock();
-            // TODO: indicate that the page is being loaded so that anyone else
-            // trying on it can piggy back on it.
+        }
 
-            // TODO: For now, assume we always have a free frame.
-            FrameId_t freeFrameId;
-            m_freeFrames.pop(&freeFrameId);
-            Frame &f = m_frames[freeFrameId];
-            iovec  buffer;
-            buffer.iov_base = f.m_page;
-            buffer.iov_len  = sizeof(f.m_page) / sizeof(f.m_page[0]);
+        Error BufferPool::pin(IoId_t io_id, page_id_t page_id,
+                              BufferPoolPageGuard &guard) {
+            BufferPoolKey_t k = makeKey(io_id, page_id);
+            while (true) {
+                Lookup page;
+                if (auto err = lookup(io_id, k, page); err) {
+                    return err;
+                }
+                if (page.m_loading != nullptr) {
+                    // Looked up again, the load may have failed.
+                    waitLoaded(*page.m_loading);
+                    continue;
+                }
+                if (!page.m_loader) {
+                    guard = std::move(page.m_guard);
+                    return EMPRY_ERR;
+                }
 
-            if (auto err = readPageFromDisk(io_id, page_id, buffer); err) {
-                throw std::runtime_error{fmt::format(
-                    "Err in reading page from disk: {}", err.what())};
+                ScopedLatency missLatency(Histogram::BUFFER_POOL_MISS_LATENCY);
+                if (auto err = readPageFromDisk(io_id, page_id,
+                                                page.m_guard.getRawPage());
+                    err) {
+                    abortLoad(page);
+                    return err;
+                }
+                finishLoad(page);
+                guard = std::move(page.m_guard);
+                return EMPRY_ERR;
             }
+        }
 
-            lock.lock();
-            m_map[k] = freeFrameId;
-            return BufferPoolPageGuard(f);
+        Error BufferPool::lookup(IoId_t io_id, BufferPoolKey_t k,
+                                 Lookup &page) {
+            if (io_id >= MAX_TABLES) {
+                return MKERROR(ERR_INVALID_ARG, "Bad file id");
+            }
+            if (m_refusedFiles[io_id].load(std::memory_order_relaxed)) {
+                return MKERROR(ERR_INVALID_ARG,
+                               "File is assigned to another pool");
+            }
+            if (m_diskManager->getPageSize(io_id) != k_pageSize) {
+                return MKERROR(ERR_INVALID_ARG,
+                               "Page size of file does not match buffer pool");
+            }
+            SPDLOG_TRACE("[GetPage] Buffer pool key is: {}", k);
+            {
+                std::shared_lock lock(m_mutex);
+                if (uint32_t frameId; m_map.find(k, frameId)) {
+                    pinMapped(*m_frames[frameId], page);
+                    return EMPRY_ERR;
+                }
+            }
+
+            std::unique_lock lock(m_mutex);
+            // Another thread may have mapped it meanwhile.
+            if (uint32_t frameId; m_map.find(k, frameId)) {
+                pinMapped(*m_frames[frameId], page);
+                return EMPRY_ERR;
+            }
+            Metrics::global().add(Counter::BUFFER_POOL_MISSES);
+            if (!m_freeFrames.pop(&page.m_frameId)) {
+                if (auto err = evictPage(page.m_frameId); err) {
+                    return err;
+                }
+            }
+            Frame &f = *m_frames[page.m_frameId];
+            f.m_key  = k;
+            f.m_dirty.store(false);
+            f.m_referenced.store(true, std::memory_order_relaxed);
+            f.m_loading.store(true);
+            m_map.insert(k, static_cast<uint32_t>(page.m_frameId));
+            // Free frames are unpinned, a waiter of its last load may still
+            // hold the latch but does not need the pool lock to drop it.
+            page.m_guard = BufferPoolPageGuard(f, *this);
+            page.m_guard.latch(LatchMode::EXCLUSIVE);
+            page.m_loader = true;
+            return EMPRY_ERR;
+        }
+
+        void BufferPool::pinMapped(Frame &frame, Lookup &page) {
+            if (frame.m_loading.load()) {
+                page.m_loading = &frame;
+                return;
+            }
+            SPDLOG_TRACE("[GetPage] Found frame for key {}", frame.m_key);
+            Metrics::global().add(Counter::BUFFER_POOL_HITS);
+            frame.m_referenced.store(true, std::memory_order_relaxed);
+            // Pinned under lock so that it can not be evicted.
+            page.m_guard = BufferPoolPageGuard(frame, *this);
+        }
+
+        void BufferPool::finishLoad(Lookup &page) {
+            // Cleared before unlatching, so woken waiters find it loaded.
+            page.m_guard.m_frame->m_loading.store(false);
+            page.m_guard.dropLatch();
+        }
+
+        void BufferPool::abortLoad(Lookup &page) {
+            Frame &f = *page.m_guard.m_frame;
+            {
+                std::unique_lock lock(m_mutex);
+                m_map.erase(f.m_key);
+                f.m_key = INVALID_POOL_KEY;
+            }
+            f.m_loading.store(false);
+            page.m_guard.release();
+            m_freeFrames.push(page.m_frameId);
+        }
+
+        void BufferPool::waitLoaded(Frame &frame) {
+            frame.m_latch.lockShared();
+            frame.m_latch.unlockShared();
+        }
+
+        Error BufferPool::resize(size_t numFrames) {
+            PIG_ASSERT(numFrames <= UINT32_MAX, "Too many frames for pool");
+            std::unique_lock lock(m_mutex);
+            size_t           current = m_numFrames.load();
+            // Rehashing only happens here, never on GetPage.
+            m_map.reserve(numFrames);
+
+            while (current < numFrames) {
+                FrameId_t id;
+                if (!m_releasedFrames.empty()) {
+                    id = m_releasedFrames.back();
+                    m_releasedFrames.pop_back();
+                    m_frames[id]->m_page =
+                        std::make_unique<unsigned char[]>(k_pageSize);
+                } else {
+                    id = m_frames.size();
+                    m_frames.push_back(std::make_unique<Frame>(k_pageSize));
+                }
+                m_freeFrames.push(id);
+                ++current;
+            }
+
+            while (current > numFrames) {
+                FrameId_t id;
+                if (!m_freeFrames.pop(&id)) {
+                    if (auto err = evictPage(id); err) {
+                        m_numFrames.store(current);
+                        return err;
+                    }
+                }
+                m_frames[id]->m_page.reset();
+                m_releasedFrames.push_back(id);
+                --current;
+            }
+
+            m_numFrames.store(current);
+            return EMPRY_ERR;
         }
 
         Error BufferPool::readPageFromDisk(IoId_t io_id, page_id_t page_id,
-                                           iovec buffer) const {
-            return m_diskManager->read(io_id, page_id * PAGE_SIZE_B, buffer);
+                                           iovec buffer) {
+            uint64_t offset = static_cast<uint64_t>(page_id) * k_pageSize;
+            if (auto err = m_diskManager->read(io_id, offset, buffer); err) {
+                return err;
+            }
+            return verifyPage(io_id, page_id, buffer);
+        }
+
+        Error BufferPool::verifyPage(IoId_t io_id, page_id_t page_id,
+                                     iovec buffer) {
+            uint64_t     offset = static_cast<uint64_t>(page_id) * k_pageSize;
+            page_size_t  checksumOffset = m_checksumOffsets[io_id];
+            ChecksumType checksumType   = m_checksumTypes[io_id];
+            if (checksumOffset == NO_PAGE_CHECKSUM ||
+                verifyPageChecksum(buffer, checksumOffset, checksumType)) {
+                return EMPRY_ERR;
+            }
+
+            // Torn by a crash or corrupted on disk, the double write area
+            // has it whole if it was in the last batch.
+            if (m_doubleWrite != nullptr &&
+                !m_doubleWrite->find(io_id, page_id, buffer) &&
+                verifyPageChecksum(buffer, checksumOffset, checksumType)) {
+                SPDLOG_WARN("Restored torn page {} of file {}", page_id,
+                            io_id);
+                return m_diskManager->write(io_id, offset, buffer);
+            }
+            SPDLOG_ERROR("Checksum mismatch on page {} of file {}", page_id,
+                         io_id);
+            return MKERROR(ERR_CORRUPTED, "Page checksum mismatch");
+        }
+
+        void BufferPool::enablePageChecksums(IoId_t      io_id,
+                                             page_size_t offset,
+                                             ChecksumType type) {
+            PIG_ASSERT(io_id < MAX_TABLES, "Bad id for page checksums");
+            PIG_ASSERT(offset + sizeof(uint32_t) <= k_pageSize,
+                       "Page checksum is out of page");
+            m_checksumOffsets[io_id] = offset;
+            m_checksumTypes[io_id]   = type;
+        }
+
+        void BufferPool::refuseFile(IoId_t io_id) {
+            PIG_ASSERT(io_id < MAX_TABLES, "Bad id to refuse");
+            m_refusedFiles[io_id].store(true, std::memory_order_relaxed);
+        }
+
+        void BufferPool::enableDoubleWrite(uint32_t numSlots) {
+            m_doubleWrite = std::make_unique<DoubleWriteBuffer>(
+                m_diskManager, k_pageSize, numSlots);
+        }
+
+        Error BufferPool::recoverTornPages() {
+            if (m_doubleWrite == nullptr) {
+                return EMPRY_ERR;
+            }
+            auto  page = std::make_unique<unsigned char[]>(k_pageSize);
+            iovec buffer;
+            buffer.iov_base = page.get();
+            buffer.iov_len  = k_pageSize;
+            return m_doubleWrite->forEach(
+                [&](IoId_t io_id, page_id_t page_id, iovec copy) -> Error {
+                    page_size_t  checksumOffset = m_checksumOffsets[io_id];
+                    ChecksumType checksumType   = m_checksumTypes[io_id];
+                    // A torn copy means the page was never written in place.
+                    if (checksumOffset == NO_PAGE_CHECKSUM ||
+                        !verifyPageChecksum(copy, checksumOffset,
+                                            checksumType)) {
+                        return EMPRY_ERR;
+                    }
+                    uint64_t offset =
+                        static_cast<uint64_t>(page_id) * k_pageSize;
+                    if (auto err = m_diskManager->read(io_id, offset, buffer);
+                        err) {
+                        return err;
+                    }
+                    if (verifyPageChecksum(buffer, checksumOffset,
+                                           checksumType)) {
+                        return EMPRY_ERR;
+                    }
+                    SPDLOG_WARN("Restored torn page {} of file {}", page_id,
+                                io_id);
+                    return m_diskManager->write(io_id, offset, copy);
+                });
         }
 
         Error BufferPool::flushPage(IoId_t io_id, page_id_t page_id) {
-            throw std::runtime_error("not implemented");
+            std::shared_lock lock(m_mutex);
+            uint32_t         frameId;
+            // A page being loaded is clean, and its frame is freed without
+            // waiting for pins if the read fails.
+            if (!m_map.find(makeKey(io_id, page_id), frameId) ||
+                m_frames[frameId]->m_loading.load()) {
+                return EMPRY_ERR;
+            }
+            // Stays mapped while waiting for a writer to finish the page.
+            BufferPoolPageGuard guard(*m_frames[frameId], *this);
+            lock.unlock();
+            guard.latch(LatchMode::SHARED);
+            lock.lock();
+            return flushFrame(*guard.m_frame);
+        }
+
+        Error BufferPool::flushFrame(Frame &frame) {
+            if (!frame.m_dirty.exchange(false)) {
+                return EMPRY_ERR;
+            }
+            IoId_t    io_id   = frame.m_key >> 48;
+            page_id_t page_id = frame.m_key & 0xFFFF'FFFFFFFF;
+
+            std::unique_ptr<unsigned char[]> copy;
+            DoubleWriteBuffer::PageWrite     write{io_id, page_id,
+                                               pageForDisk(frame, copy)};
+            if (auto err = writePages(&write, 1); err) {
+                frame.m_dirty.store(true);
+                return err;
+            }
+            return EMPRY_ERR;
+        }
+
+        Error
+        BufferPool::writePages(const DoubleWriteBuffer::PageWrite *pages,
+                               size_t                              count) {
+            auto writeInPlace =
+                [this](const DoubleWriteBuffer::PageWrite *batch,
+                       size_t                              n) {
+                    return this->writeInPlace(batch, n);
+                };
+            if (m_doubleWrite != nullptr) {
+                return m_doubleWrite->write(pages, count, writeInPlace);
+            }
+            return writeInPlace(pages, count);
+        }
+
+        Error
+        BufferPool::writeInPlace(const DoubleWriteBuffer::PageWrite *pages,
+                                 size_t                              count) {
+            std::vector<iovec> buffers;
+            for (size_t i = 0; i < count;) {
+                size_t end = i + 1;
+                while (end < count && pages[end].m_ioId == pages[i].m_ioId &&
+                       pages[end].m_pageId == pages[i].m_pageId + (end - i)) {
+                    ++end;
+                }
+                buffers.clear();
+                for (size_t j = i; j < end; ++j) {
+                    buffers.push_back(pages[j].m_page);
+                }
+                if (auto err = m_diskManager->write(
+                        pages[i].m_ioId,
+                        static_cast<uint64_t>(pages[i].m_pageId) * k_pageSize,
+                        buffers.data(), buffers.size());
+                    err) {
+                    return err;
+                }
+                i = end;
+            }
+            return EMPRY_ERR;
+        }
+
+        iovec BufferPool::pageForDisk(Frame                            &frame,
+                                      std::unique_ptr<unsigned char[]> &copy) {
+            iovec buffer;
+            buffer.iov_base = frame.m_page.get();
+            buffer.iov_len  = k_pageSize;
+
+            // Frame addresses must not reach disk, write a copy with the
+            // swips turned back to page ids.
+            if (frame.m_swizzledChildren != 0) {
+                copy = std::make_unique<unsigned char[]>(k_pageSize);
+                memcpy(copy.get(), frame.m_page.get(), k_pageSize);
+                for (const auto &child : m_frames) {
+                    if (child->m_parent != &frame) {
+                        continue;
+                    }
+                    auto     offset = reinterpret_cast<unsigned char *>(
+                                      child->m_swip) -
+                                  frame.m_page.get();
+                    uint64_t word   = Swip::encode(
+                        static_cast<page_id_t>(child->m_key));
+                    memcpy(copy.get() + offset, &word, sizeof(word));
+                }
+                buffer.iov_base = copy.get();
+            }
+            IoId_t io_id = frame.m_key >> 48;
+            if (page_size_t offset = m_checksumOffsets[io_id];
+                offset != NO_PAGE_CHECKSUM) {
+                setPageChecksum(buffer, offset, m_checksumTypes[io_id]);
+            }
+            return buffer;
+        }
+
+        std::vector<BufferPool::DirtyPage> BufferPool::getDirtyPages() {
+            std::vector<DirtyPage> dirty;
+            {
+                std::shared_lock lock(m_mutex);
+                for (const auto &f : m_frames) {
+                    if (f->m_key != INVALID_POOL_KEY && f->m_dirty.load()) {
+                        dirty.push_back(
+                            DirtyPage{static_cast<IoId_t>(f->m_key >> 48),
+                                      static_cast<page_id_t>(f->m_key),
+                                      f->m_recLsn.load()});
+                    }
+                }
+            }
+            std::sort(dirty.begin(), dirty.end(),
+                      [](const DirtyPage &a, const DirtyPage &b) {
+                          return makeKey(a.m_ioId, a.m_pageId) <
+                                 makeKey(b.m_ioId, b.m_pageId);
+                      });
+            return dirty;
+        }
+
+        Error BufferPool::flushPages(const DirtyPage *pages, size_t count) {
+            std::vector<BufferPoolPageGuard> guards;
+            guards.reserve(count);
+            {
+                std::shared_lock lock(m_mutex);
+                for (size_t i = 0; i < count; ++i) {
+                    // Not found if evicted since, which wrote it, and clean
+                    // if loaded again since.
+                    if (uint32_t frameId;
+                        m_map.find(makeKey(pages[i].m_ioId, pages[i].m_pageId),
+                                   frameId) &&
+                        !m_frames[frameId]->m_loading.load()) {
+                        guards.push_back(
+                            BufferPoolPageGuard(*m_frames[frameId], *this));
+                    }
+                }
+            }
+
+            // Waiting for a writer while holding latches could deadlock with
+            // it, pages being written are flushed alone after the batch.
+            std::vector<BufferPoolPageGuard> busy;
+            size_t                           latched = 0;
+            for (auto &guard : guards) {
+                if (guard.tryLatchShared()) {
+                    guards[latched++] = std::move(guard);
+                } else {
+                    busy.push_back(std::move(guard));
+                }
+            }
+            guards.erase(guards.begin() + latched, guards.end());
+            if (auto err = writeLatched(guards); err) {
+                return err;
+            }
+            guards.clear();
+
+            for (auto &guard : busy) {
+                guard.latch(LatchMode::SHARED);
+                guards.push_back(std::move(guard));
+                if (auto err = writeLatched(guards); err) {
+                    return err;
+                }
+                guards.clear();
+            }
+            return EMPRY_ERR;
+        }
+
+        Error
+        BufferPool::writeLatched(std::vector<BufferPoolPageGuard> &guards) {
+            std::vector<std::unique_ptr<unsigned char[]>> copies(guards.size());
+            std::vector<DoubleWriteBuffer::PageWrite>     writes;
+            std::vector<Frame *>                          written;
+            {
+                std::shared_lock lock(m_mutex);
+                for (size_t i = 0; i < guards.size(); ++i) {
+                    Frame &f = *guards[i].m_frame;
+                    // Cleared under the latch, so a writer that comes after
+                    // the write dirties it again.
+                    if (f.m_dirty.exchange(false)) {
+                        writes.push_back(DoubleWriteBuffer::PageWrite{
+                            static_cast<IoId_t>(f.m_key >> 48),
+                            static_cast<page_id_t>(f.m_key),
+                            pageForDisk(f, copies[i])});
+                        written.push_back(&f);
+                    }
+                }
+            }
+            if (auto err = writePages(writes.data(), writes.size()); err) {
+                // Still latched, so the recLSN is unchanged.
+                for (Frame *f : written) {
+                    f->m_dirty.store(true);
+                }
+                return err;
+            }
+            return EMPRY_ERR;
+        }
+
+        Error BufferPool::evictPage(FrameId_t &frameId) {
+            size_t numSlots = m_frames.size();
+            // Two rounds so that pages referenced since last sweep get a
+            // second chance.
+            for (size_t i = 0; i < 2 * numSlots; ++i) {
+                FrameId_t id;
+                if (k_policy == EvictionPolicy::RANDOM) {
+                    m_randomState ^= m_randomState << 13;
+                    m_randomState ^= m_randomState >> 7;
+                    m_randomState ^= m_randomState << 17;
+                    id = m_randomState % numSlots;
+                } else {
+                    id          = m_clockHand;
+                    m_clockHand = (m_clockHand + 1) % numSlots;
+                }
+
+                Frame *f = m_frames[id].get();
+                if (!isEvictable(f)) {
+                    continue;
+                }
+                if (k_policy == EvictionPolicy::CLOCK &&
+                    f->m_referenced.exchange(false)) {
+                    continue;
+                }
+                if (!detachFromParent(*f) || f->m_pinCount.load() != 0) {
+                    continue;
+                }
+                if (auto err = evictFrame(id, *f); err) {
+                    return err;
+                }
+                frameId = id;
+                return EMPRY_ERR;
+            }
+
+            // Random probes can miss the few unpinned frames, fall back to a
+            // full walk.
+            for (FrameId_t id = 0; id < numSlots; ++id) {
+                if (Frame *f = m_frames[id].get();
+                    isEvictable(f) && detachFromParent(*f) &&
+                    f->m_pinCount.load() == 0) {
+                    if (auto err = evictFrame(id, *f); err) {
+                        return err;
+                    }
+                    frameId = id;
+                    return EMPRY_ERR;
+                }
+            }
+            return MKERROR(ERR_NO_FREE_FRAME, "All frames are pinned");
+        }
+
+        bool BufferPool::detachFromParent(Frame &frame) {
+            Frame *parent = frame.m_parent;
+            if (parent == nullptr) {
+                return true;
+            }
+            // Writers of the parent may be moving its swips, and waiting for
+            // them under pool lock could deadlock.
+            if (!parent->m_latch.tryLockExclusive()) {
+                return false;
+            }
+            // A reader that loaded the frame address rechecks the swip after
+            // pinning, so it either sees the page id or holds the pin that
+            // stops eviction.
+            frame.m_swip->store(
+                Swip::encode(static_cast<page_id_t>(frame.m_key)));
+            parent->m_latch.unlockExclusive();
+            --parent->m_swizzledChildren;
+            frame.m_parent = nullptr;
+            frame.m_swip   = nullptr;
+            return true;
         }
 
-        void BufferPool::evictPage() {
-            throw std::runtime_error("not implemented");
+        Error BufferPool::fix(BufferPoolPageGuard &parent, IoId_t io_id,
+                              Swip &swip, LatchMode mode,
+                              BufferPoolPageGuard &guard) {
+            PIG_ASSERT(parent.holdsPage(), "Parent page is not held");
+            uint64_t word = swip.load();
+            while ((word & 1) == 0) {
+                Frame              &f = *reinterpret_cast<Frame *>(word);
+                BufferPoolPageGuard child(f, *this);
+                if (swip.load() == word) {
+                    Metrics::global().add(Counter::BUFFER_POOL_HITS);
+                    f.m_referenced.store(true, std::memory_order_relaxed);
+                    guard = std::move(child);
+                    guard.latch(mode);
+                    return EMPRY_ERR;
+                }
+                // Unswizzled for eviction meanwhile, drop the stray pin.
+                word = swip.load();
+            }
+
+            BufferPoolPageGuard child;
+            if (auto err = pin(io_id, static_cast<page_id_t>(word >> 1), child);
+                err) {
+                return err;
+            }
+            {
+                std::unique_lock lock(m_mutex);
+                // A page has one swip, another one may have won the race.
+                if (swip.load() == word && child.m_frame->m_parent == nullptr) {
+                    child.m_frame->m_parent = parent.m_frame;
+                    child.m_frame->m_swip   = &swip;
+                    ++parent.m_frame->m_swizzledChildren;
+                    swip.store(reinterpret_cast<uint64_t>(child.m_frame));
+                }
+            }
+            guard = std::move(child);
+            guard.latch(mode);
+            return EMPRY_ERR;
+        }
+
+        void BufferPool::unswizzle(BufferPoolPageGuard &parent, Swip &swip) {
+            PIG_ASSERT(parent.getMode() == LatchMode::EXCLUSIVE,
+                       "Swips can only be moved under exclusive latch");
+            std::unique_lock lock(m_mutex);
+            uint64_t         word = swip.load();
+            if (word & 1) {
+                return;
+            }
+            Frame &child = *reinterpret_cast<Frame *>(word);
+            swip.store(Swip::encode(static_cast<page_id_t>(child.m_key)));
+            --parent.m_frame->m_swizzledChildren;
+            child.m_parent = nullptr;
+            child.m_swip   = nullptr;
+        }
+
+        Error BufferPool::evictFrame([[maybe_unused]] FrameId_t id,
+                                     Frame                     &frame) {
+            if (auto err = flushFrame(frame); err) {
+                return err;
+            }
+            SPDLOG_TRACE("[evictPage] Evicting key {} from frame {}",
+                         frame.m_key, id);
+            m_map.erase(frame.m_key);
+            frame.m_key = INVALID_POOL_KEY;
+            Metrics::global().add(Counter::BUFFER_POOL_EVICTIONS);
+            return EMPRY_ERR;
         }
     } // namespace Core
 
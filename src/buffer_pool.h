@@ -1,17 +1,23 @@
 #ifndef PIG_CORE_BUFFER_POOL_H
 #define PIG_CORE_BUFFER_POOL_H
 
+#include "checksum.h"
 #include "core.h"
 #include "disk-manager.h"
+#include "double_write.h"
 #include "error.h"
+#include "latch.h"
 #include "lock_free_stack.h"
+#include "page_table.h"
+#include "swip.h"
+#include "task.h"
 #include <array>
 #include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <memory>
 #include <shared_mutex>
-#include <unordered_map>
 #include <vector>
 namespace Pig {
 
@@ -22,91 +28,536 @@ namespace Pig {
         using BufferPoolKey_t = uint64_t;
         using FrameId_t       = size_t;
 
+        constexpr BufferPoolKey_t INVALID_POOL_KEY =
+            std::numeric_limits<BufferPoolKey_t>::max();
+
+        // Checksum offset of files whose pages have no checksum.
+        constexpr page_size_t NO_PAGE_CHECKSUM =
+            std::numeric_limits<page_size_t>::max();
+
+        // How a victim is picked when there is no free frame.
+        enum class EvictionPolicy : uint8_t {
+            // Second chance, skips pages accessed since last sweep.
+            CLOCK = 0,
+            // Any unpinned page, a baseline to compare against.
+            RANDOM
+        };
+
         /**
         A buffer pool stores pages of Heap and Index file in fixed size frames.
-        In current implementation there is only 1 buffer pool.
+        There can be many pools, see BufferPoolManager, each serving the files
+        assigned to it.
+        All frames of a pool have the same size, chosen at construction, and
+        only files with that page size can be served by the pool.
 
-        The pool is pre-allocated and does not grow today.
+        The pool is pre-allocated and can be resized online, frames are added
+        to free list on growth and unpinned frames are evicted and released
+        on shrink.
         The buffer pool handles misses by fetching from disk manager.
 
         On get, it first sees if page is in buffer pool, if yes pins it and
         returns the page raw contents.
         If not, it needs to fetch from Disk.
         For this it gets a free frame for free list and pins it.
-        If it can't it evicts a page, if dirty flushing it to disk
-        synchronously.
+        If it can't it evicts a page picked by the eviction policy, if dirty
+        flushing it to disk synchronously.
          */
         class BufferPool : public std::enable_shared_from_this<BufferPool> {
           private:
             struct Frame {
                 std::atomic_uint16_t m_pinCount;
+                // Pins of guards kept after unlatch, which read the page
+                // without validating, so its bytes must stay in place.
+                std::atomic_uint16_t m_viewPins;
                 std::atomic_bool     m_dirty;
+                // Set while the page is read into the frame, which is mapped
+                // and exclusively latched by the reader meanwhile, so that
+                // others wait for it instead of reading the page again.
+                std::atomic_bool m_loading;
+                // LSN of the first change since the page was last written,
+                // only meaningful while dirty.
+                std::atomic<lsn_t> m_recLsn;
+                // Set on every access, cleared by the clock hand.
+                std::atomic_bool m_referenced;
+                // Key of the page held, INVALID_POOL_KEY if frame is free.
+                // Only changed under exclusive lock of pool.
+                BufferPoolKey_t m_key;
                 // page in the buffer pool, not interpreted by buffer pool.
-                unsigned char m_page[PAGE_SIZE_B];
+                std::unique_ptr<unsigned char[]> m_page;
+                // Guards contents of m_page, only taken while pinned.
+                HybridLatch m_latch;
+                // Swip pointing to this frame and the frame of the page that
+                // holds it, null if none does.
+                // Swizzling state only changes under exclusive lock of pool.
+                Frame *m_parent;
+                Swip  *m_swip;
+                // Swips in this page pointing to other frames, the page is not
+                // evicted till they are unswizzled.
+                uint32_t m_swizzledChildren;
 
-                Frame() : m_pinCount{0}, m_dirty{false} {}
+                explicit Frame(page_size_t pageSize)
+                    : m_pinCount{0}, m_viewPins{0}, m_dirty{false},
+                      m_loading{false}, m_recLsn{0},
+                      m_referenced{false},
+                      m_key{INVALID_POOL_KEY},
+                      m_page{std::make_unique<unsigned char[]>(pageSize)},
+                      m_parent{nullptr}, m_swip{nullptr},
+                      m_swizzledChildren{0} {}
             };
 
-            class BufferPoolPageGuard {
+          public:
+            // Entry of the dirty page table, see getDirtyPages.
+            struct DirtyPage {
+                IoId_t    m_ioId;
+                page_id_t m_pageId;
+                lsn_t     m_recLsn;
+            };
 
+            /**
+                Pins a page and latches it in the mode it was requested with,
+                both are released when the guard is destroyed.
+
+                An OPTIMISTIC guard only pins, the reader must call validate
+                after reading and retry if it fails. Only an EXCLUSIVE guard
+                may change the page.
+                Guards are movable so that they can be returned from functions
+                and held by iterators, a moved from guard holds nothing.
+             */
+            class BufferPoolPageGuard {
               public:
-                BufferPoolPageGuard(Frame &f) : m_frame(f) {
-                    m_frame.m_pinCount++;
+                // Holds nothing, e.g for getPage to fill in.
+                BufferPoolPageGuard() noexcept
+                    : m_frame{nullptr}, m_pool{nullptr},
+                      m_mode{LatchMode::OPTIMISTIC}, m_version{0} {}
+
+                BufferPoolPageGuard(BufferPoolPageGuard &&other) noexcept
+                    : m_frame{other.m_frame}, m_pool{other.m_pool},
+                      m_mode{other.m_mode}, m_version{other.m_version},
+                      m_unlatched{other.m_unlatched} {
+                    other.m_frame = nullptr;
                 }
 
-                BufferPoolPageGuard(const BufferPoolPageGuard &) = delete;
-                BufferPoolPageGuard(BufferPoolPageGuard &&)      = delete;
+                BufferPoolPageGuard &
+                operator=(BufferPoolPageGuard &&other) noexcept {
+                    if (this != &other) {
+                        release();
+                        m_frame       = other.m_frame;
+                        m_pool        = other.m_pool;
+                        m_mode        = other.m_mode;
+                        m_version     = other.m_version;
+                        m_unlatched   = other.m_unlatched;
+                        other.m_frame = nullptr;
+                    }
+                    return *this;
+                }
 
+                BufferPoolPageGuard(const BufferPoolPageGuard &) = delete;
                 BufferPoolPageGuard &
-                operator=(const BufferPoolPageGuard &)                 = delete;
-                BufferPoolPageGuard &operator=(BufferPoolPageGuard &&) = delete;
+                operator=(const BufferPoolPageGuard &) = delete;
+
+                ~BufferPoolPageGuard() { release(); }
 
-                ~BufferPoolPageGuard() { m_frame.m_pinCount--; }
+                LatchMode getMode() const noexcept { return m_mode; }
 
-                void markDirty() { m_frame.m_dirty.store(true); }
+                // False once released or moved from.
+                bool holdsPage() const noexcept { return m_frame != nullptr; }
+
+                /**
+                    True if guards kept pinned after unlatch, e.g views, may
+                    point into the page. Other readers either hold the latch
+                    or validate, so they do not hold up moving its bytes.
+                 */
+                bool isViewed() const noexcept {
+                    // Pairs with the fence in unlatch, either the viewer
+                    // sees the exclusive latch or this sees its pin.
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    return m_frame->m_viewPins.load() > 0;
+                }
+
+                // Stamps the recLSN when a clean page turns dirty.
+                void markDirty() {
+                    PIG_ASSERT(m_mode == LatchMode::EXCLUSIVE,
+                               "Page changed without exclusive latch");
+                    if (!m_frame->m_dirty.load()) {
+                        m_frame->m_recLsn.store(m_pool->nextLsn());
+                        m_frame->m_dirty.store(true);
+                    }
+                }
 
                 iovec getRawPage() {
                     iovec buf;
-                    buf.iov_base = m_frame.m_page;
-                    buf.iov_len =
-                        sizeof(m_frame.m_page) / sizeof(m_frame.m_page[0]);
+                    buf.iov_base = m_frame->m_page.get();
+                    buf.iov_len  = m_pool->k_pageSize;
                     return buf;
                 }
 
+                /**
+                    For OPTIMISTIC guards, true if no writer latched the page
+                    since the guard was taken, so what was read is consistent.
+                    Always true for latched guards.
+                 */
+                bool validate() const noexcept {
+                    return m_mode != LatchMode::OPTIMISTIC ||
+                           m_frame->m_latch.validate(m_version);
+                }
+
+                /**
+                    Drops a SHARED latch but keeps the page pinned, for
+                    callers that only need the frame to stay resident, e.g
+                    views into parts of a page that never change. Writers
+                    do not move the bytes of the page meanwhile, an
+                    OPTIMISTIC guard must validate after unlatch for that.
+                 */
+                void unlatch() {
+                    PIG_ASSERT(m_mode != LatchMode::EXCLUSIVE,
+                               "Exclusive latch can not be dropped early");
+                    if (!m_unlatched) {
+                        m_unlatched = true;
+                        m_frame->m_viewPins++;
+                        std::atomic_thread_fence(std::memory_order_seq_cst);
+                    }
+                    if (m_mode == LatchMode::SHARED) {
+                        m_frame->m_latch.unlockShared();
+                        m_mode    = LatchMode::OPTIMISTIC;
+                        m_version = m_frame->m_latch.getVersion();
+                    }
+                }
+
+                // Unlatches and unpins, safe to call more than once.
+                void release() {
+                    if (m_frame == nullptr) {
+                        return;
+                    }
+                    if (m_mode == LatchMode::SHARED) {
+                        m_frame->m_latch.unlockShared();
+                    } else if (m_mode == LatchMode::EXCLUSIVE) {
+                        m_frame->m_latch.unlockExclusive();
+                    }
+                    if (m_unlatched) {
+                        m_frame->m_viewPins--;
+                        m_unlatched = false;
+                    }
+                    m_frame->m_pinCount--;
+                    m_frame = nullptr;
+                }
+
               private:
-                Frame &m_frame;
+                friend class BufferPool;
+
+                // Pins f, under pool lock so that it can not be evicted.
+                BufferPoolPageGuard(Frame &f, BufferPool &pool)
+                    : m_frame{&f}, m_pool{&pool},
+                      m_mode{LatchMode::OPTIMISTIC}, m_version{0} {
+                    m_frame->m_pinCount++;
+                }
+
+                // For a pinned guard, false if a writer holds the page.
+                bool tryLatchShared() {
+                    if (!m_frame->m_latch.tryLockShared()) {
+                        return false;
+                    }
+                    m_mode = LatchMode::SHARED;
+                    return true;
+                }
+
+                // Unlatches but keeps the pin, the page must be latched again
+                // before it is read.
+                void dropLatch() {
+                    if (m_mode == LatchMode::SHARED) {
+                        m_frame->m_latch.unlockShared();
+                    } else if (m_mode == LatchMode::EXCLUSIVE) {
+                        m_frame->m_latch.unlockExclusive();
+                    }
+                    m_mode = LatchMode::OPTIMISTIC;
+                }
+
+                // Called once the pool lock is released, latching can block.
+                void latch(LatchMode mode) {
+                    m_mode = mode;
+                    if (mode == LatchMode::OPTIMISTIC) {
+                        m_version = m_frame->m_latch.readOptimistic();
+                    } else if (mode == LatchMode::SHARED) {
+                        m_frame->m_latch.lockShared();
+                    } else {
+                        m_frame->m_latch.lockExclusive();
+                    }
+                }
+
+                Frame      *m_frame;
+                BufferPool *m_pool;
+                LatchMode   m_mode;
+                uint64_t    m_version;
+                bool        m_unlatched{false};
             };
 
-          public:
             BufferPool(size_t                       numFrames,
-                       std::shared_ptr<DiskManager> diskManager);
+                       std::shared_ptr<DiskManager> diskManager,
+                       page_size_t                  pageSize = PAGE_SIZE_B,
+                       EvictionPolicy policy = EvictionPolicy::CLOCK);
+
+            page_size_t getPageSize() const noexcept { return k_pageSize; }
+
+            EvictionPolicy getEvictionPolicy() const noexcept {
+                return k_policy;
+            }
+
+            // Number of frames currently owned by the pool.
+            size_t getNumFrames() const noexcept {
+                return m_numFrames.load(std::memory_order_relaxed);
+            }
 
             /**
                 Gets a page from bufferpool.
                 If the page is in pool, its latest.
                 If the page is not present, tries to reserve a frame from
                 free list and then reads it from disk assuming the page is
-                valid. If there are no frames, it evicts the first unpinned page
-                from LRU.
+                valid. If there are no frames, it evicts an unpinned page
+                picked by the eviction policy.
+                The page is latched in mode after it is pinned, so waiting
+                for a writer never holds up the rest of the pool.
+                ERR_NO_FREE_FRAME if every frame is pinned, ERR_CORRUPTED if
+                the page fails its checksum, or the error of the read.
+                ERR_INVALID_ARG if the file has another page size or is
+                assigned to another pool.
              */
-            BufferPoolPageGuard GetPage(IoId_t io_id, page_id_t page_id);
+            [[nodiscard]] Error getPage(IoId_t io_id, page_id_t page_id,
+                                        LatchMode            mode,
+                                        BufferPoolPageGuard &guard);
 
-          private:
-            void evictPage();
+            /**
+                As getPage, throwing std::runtime_error if it fails, for
+                tests and tools that can not go on without the page.
+             */
+            BufferPoolPageGuard GetPage(IoId_t io_id, page_id_t page_id,
+                                        LatchMode mode = LatchMode::SHARED);
+
+            /**
+                As getPage from a task on an EventLoop. A miss suspends the
+                task till the page is read instead of blocking the thread, so
+                one thread keeps many misses in flight. A task that misses on
+                a page being read by another yields till it is loaded.
+                Guards must not stay latched across a suspension, as another
+                task of the loop may wait for the latch and block the thread.
+             */
+            Task<Error> getPageAsync(IoId_t io_id, page_id_t page_id,
+                                     LatchMode            mode,
+                                     BufferPoolPageGuard &guard);
+
+            /**
+                Follows a swip stored in the page held by parent.
+                A swizzled swip goes straight to its frame, without the page
+                table or pool lock. Otherwise the page is fetched like getPage
+                and the swip is swizzled, so the next fix is direct.
+                parent must stay held till the returned guard is latched.
+             */
+            [[nodiscard]] Error fix(BufferPoolPageGuard &parent, IoId_t io_id,
+                                    Swip &swip, LatchMode mode,
+                                    BufferPoolPageGuard &guard);
+
+            /**
+                Turns swip back to a page id, required before moving or
+                dropping it. parent must hold its page exclusively.
+             */
+            void unswizzle(BufferPoolPageGuard &parent, Swip &swip);
 
+            /**
+                Grows or shrinks the pool to numFrames while it is in use.
+                Growing adds new free frames. Shrinking releases free frames
+                first and then evicts unpinned pages, flushing dirty ones.
+                If not enough frames can be released as they are pinned, the
+                pool is left as small as it could get and an error is returned.
+             */
+            [[nodiscard]] Error resize(size_t numFrames);
+
+            /**
+                Writes the page to disk if it is in pool and dirty.
+             */
             [[nodiscard]] Error flushPage(IoId_t io_id, page_id_t page_id);
 
+            /**
+                LSN of the latest change to any page of the pool.
+                There is no log yet, so it counts pages turning dirty, which
+                is enough to order changes against checkpoints.
+             */
+            lsn_t getCurrentLsn() const noexcept {
+                return m_lsn.load(std::memory_order_acquire);
+            }
+
+            /**
+                Dirty page table, the dirty pages with their recLSN sorted by
+                file and page id. It is fuzzy, pages can be dirtied or written
+                while it is built.
+             */
+            std::vector<DirtyPage> getDirtyPages();
+
+            /**
+                Writes the pages that are still dirty, pages sorted as from
+                getDirtyPages. Runs of adjacent pages of a file go to disk in
+                one vectored write.
+                Pages are latched shared only till written, one batch at a
+                time, so writers stall for at most one write.
+             */
+            [[nodiscard]] Error flushPages(const DirtyPage *pages,
+                                           size_t           count);
+
+            /**
+                Pages of the file carry a 32 bit checksum of type at offset,
+                see pageChecksum. It is set on every write and verified on
+                every read, a page that fails is restored from the double
+                write area if it is there or else getPage fails with
+                ERR_CORRUPTED.
+                Must be set before the file is used.
+             */
+            void enablePageChecksums(IoId_t io_id, page_size_t offset,
+                                     ChecksumType type = ChecksumType::XXHASH3);
+
+            /**
+                Pages of the file are served by another pool, getPage fails
+                with ERR_INVALID_ARG from then on, see
+                BufferPoolManager::assign.
+             */
+            void refuseFile(IoId_t io_id);
+
+            /**
+                Writes go through a double write area of numSlots pages, see
+                DoubleWriteBuffer. Must be enabled before the pool is used.
+             */
+            void enableDoubleWrite(uint32_t numSlots);
+
+            /**
+                At startup, writes back pages of the last double write batch
+                that are torn in place. Checksums of the files must be
+                enabled first.
+             */
+            [[nodiscard]] Error recoverTornPages();
+
+          private:
+            static BufferPoolKey_t makeKey(IoId_t io_id, page_id_t page_id) {
+                return static_cast<BufferPoolKey_t>(io_id) << 48 |
+                       static_cast<BufferPoolKey_t>(page_id);
+            }
+
+            // The page pinned but not latched.
+            [[nodiscard]] Error pin(IoId_t io_id, page_id_t page_id,
+                                    BufferPoolPageGuard &guard);
+
+            // Outcome of lookup, m_guard holds nothing while m_loading is
+            // set.
+            struct Lookup {
+                BufferPoolPageGuard m_guard;
+                // Frame another thread is reading the page into.
+                Frame *m_loading = nullptr;
+                // The page is not read yet, m_guard holds the frame mapped
+                // to it latched exclusively, see finishLoad and abortLoad.
+                bool      m_loader  = false;
+                FrameId_t m_frameId = 0;
+            };
+
+            /**
+                Pins the page if it is in the pool. Otherwise maps a free
+                frame to it, marked loading, so that the page is read once
+                and never while its old frame is being written, which
+                happens under the exclusive pool lock. Counts the hit or miss.
+             */
+            [[nodiscard]] Error lookup(IoId_t io_id, BufferPoolKey_t k,
+                                       Lookup &page);
+
+            // Must hold lock. Pins a mapped frame unless it is loading.
+            void pinMapped(Frame &frame, Lookup &page);
+
+            // The loader read the page, waiters may pin it.
+            static void finishLoad(Lookup &page);
+
+            // The loader failed to read the page, unmaps and frees the frame.
+            void abortLoad(Lookup &page);
+
+            // Waits for another thread to load frame, which it latches
+            // exclusively till done. The frame need not be pinned, frames
+            // are never freed.
+            static void waitLoaded(Frame &frame);
+
+            // Must hold exclusive lock.
+            [[nodiscard]] Error evictPage(FrameId_t &frameId);
+
+            // Frame can be evicted if it holds a page that is not pinned and
+            // does not hold swizzled swips.
+            static bool isEvictable(const Frame *frame) {
+                return frame->m_key != INVALID_POOL_KEY &&
+                       frame->m_pinCount.load() == 0 &&
+                       frame->m_swizzledChildren == 0;
+            }
+
+            // Must hold exclusive lock. Unswizzles the swip pointing to frame,
+            // false if its parent is latched.
+            bool detachFromParent(Frame &frame);
+
+            // Must hold exclusive lock, flushes and unmaps the page.
+            [[nodiscard]] Error evictFrame(FrameId_t id, Frame &frame);
+
+            // Must hold lock. Frame must be unpinned or shared latched, so
+            // that no writer is halfway through the page.
+            [[nodiscard]] Error flushFrame(Frame &frame);
+
+            // Must hold lock. The page as it goes to disk, which is a copy
+            // in copy if it holds swizzled swips, with its checksum set.
+            iovec pageForDisk(Frame                            &frame,
+                              std::unique_ptr<unsigned char[]> &copy);
+
+            // Through the double write area if there is one.
+            [[nodiscard]] Error
+            writePages(const DoubleWriteBuffer::PageWrite *pages,
+                       size_t                              count);
+
+            // Adjacent pages of a file go in one vectored write.
+            [[nodiscard]] Error
+            writeInPlace(const DoubleWriteBuffer::PageWrite *pages,
+                         size_t                              count);
+
+            // Writes the dirty pages of shared latched guards, which are
+            // sorted by page.
+            [[nodiscard]] Error
+            writeLatched(std::vector<BufferPoolPageGuard> &guards);
+
+            lsn_t nextLsn() noexcept {
+                return m_lsn.fetch_add(1, std::memory_order_acq_rel) + 1;
+            }
+
+            // Reads the page and verifies it.
             [[nodiscard]] Error readPageFromDisk(IoId_t    io_id,
                                                  page_id_t page_id,
-                                                 iovec     buffer) const;
+                                                 iovec     buffer);
+
+            // Verifies the checksum of a page read and restores it if torn.
+            [[nodiscard]] Error verifyPage(IoId_t io_id, page_id_t page_id,
+                                           iovec buffer);
 
             std::shared_ptr<DiskManager> m_diskManager;
+            const page_size_t            k_pageSize;
+            const EvictionPolicy         k_policy;
 
             std::shared_mutex m_mutex;
-            // FrameId_t is index in m_frames.
-            std::unordered_map<BufferPoolKey_t, FrameId_t> m_map;
-            std::vector<Frame>                             m_frames;
-            LockFreeStack<FrameId_t>                       m_freeFrames;
+            // FrameId_t is index in m_frames, released frames keep their
+            // Frame, as a stale swip may still point there, but free the page
+            // and are reused on growth.
+            // Frame ids are stored as 32 bits to keep page table entries
+            // compact.
+            PageTable<BufferPoolKey_t, uint32_t> m_map;
+            std::vector<std::unique_ptr<Frame>>  m_frames;
+            std::vector<FrameId_t>               m_releasedFrames;
+            std::atomic_size_t                   m_numFrames{0};
+            FrameId_t                            m_clockHand{0};
+            LockFreeStack<FrameId_t>             m_freeFrames;
+
+            // xorshift state for RANDOM policy, under exclusive lock.
+            uint64_t m_randomState{0x9E3779B97F4A7C15};
+
+            std::atomic<lsn_t> m_lsn{0};
+
+            std::array<page_size_t, MAX_TABLES>  m_checksumOffsets;
+            std::array<ChecksumType, MAX_TABLES> m_checksumTypes{};
+            // Files assigned to other pools of the same manager.
+            std::array<std::atomic_bool, MAX_TABLES> m_refusedFiles{};
+            std::unique_ptr<DoubleWriteBuffer>   m_doubleWrite;
         };
     } // namespace Core
 
@@ -0,0 +1,84 @@
+#include "buffer_pool_manager.h"
+#include "error.h"
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <utility>
+
+namespace Pig {
+    namespace Core {
+
+        BufferPoolManager::BufferPoolManager(
+            std::shared_ptr<DiskManager> diskManager)
+            : m_diskManager{std::move(diskManager)} {}
+
+        Error BufferPoolManager::createPool(const std::string &name,
+                                            size_t             numFrames,
+                                            page_size_t        pageSize,
+                                            EvictionPolicy     policy) {
+            if (!isValidPageSize(pageSize)) {
+                return MKERROR(ERR_INVALID_ARG, "Unsupported page size");
+            }
+            std::unique_lock lock(m_mutex);
+            if (m_pools.count(name) != 0) {
+                return MKERROR(ERR_ALREADY_EXISTS, "Pool already exists");
+            }
+            auto pool = std::make_shared<BufferPool>(numFrames, m_diskManager,
+                                                     pageSize, policy);
+            for (const auto &[id, assigned] : m_assignments) {
+                pool->refuseFile(id);
+            }
+            m_pools.emplace(name, std::move(pool));
+            return EMPRY_ERR;
+        }
+
+        std::shared_ptr<BufferPool>
+        BufferPoolManager::getPool(const std::string &name) const {
+            std::shared_lock lock(m_mutex);
+            if (auto it = m_pools.find(name); it != m_pools.end()) {
+                return it->second;
+            }
+            return nullptr;
+        }
+
+        Error BufferPoolManager::assign(IoId_t id, const std::string &name) {
+            std::unique_lock lock(m_mutex);
+            auto             it = m_pools.find(name);
+            if (it == m_pools.end()) {
+                return MKERROR(ERR_NOT_FOUND, "Pool does not exist");
+            }
+            if (m_diskManager->getPageSize(id) != it->second->getPageSize()) {
+                return MKERROR(ERR_INVALID_ARG,
+                               "Page size of file does not match pool");
+            }
+            if (!m_assignments.emplace(id, it->second).second) {
+                return MKERROR(ERR_ALREADY_EXISTS, "File already has a pool");
+            }
+            for (const auto &[other, pool] : m_pools) {
+                if (pool != it->second) {
+                    pool->refuseFile(id);
+                }
+            }
+            return EMPRY_ERR;
+        }
+
+        std::shared_ptr<BufferPool>
+        BufferPoolManager::getPoolFor(IoId_t id) const {
+            std::shared_lock lock(m_mutex);
+            if (auto it = m_assignments.find(id); it != m_assignments.end()) {
+                return it->second;
+            }
+            return nullptr;
+        }
+
+        Error BufferPoolManager::resizePool(const std::string &name,
+                                            size_t             numFrames) {
+            auto pool = getPool(name);
+            if (pool == nullptr) {
+                return MKERROR(ERR_NOT_FOUND, "Pool does not exist");
+            }
+            return pool->resize(numFrames);
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef PIG_CORE_BUFFER_POOL_MANAGER_H
+#define PIG_CORE_BUFFER_POOL_MANAGER_H
+
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "error.h"
+#include <cstddef>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Owns the named buffer pools of a database and which pool serves each
+        file.
+
+        Pools let hot and cold data be kept apart, e.g a small pool for index
+        pages and a large one for heap scans, so that a scan of a cold table
+        can not evict index pages.
+        A file is assigned to exactly one pool for its lifetime and the page
+        size of the file must match the frames of the pool.
+         */
+        class BufferPoolManager {
+          public:
+            explicit BufferPoolManager(
+                std::shared_ptr<DiskManager> diskManager);
+
+            BufferPoolManager(const BufferPoolManager &)            = delete;
+            BufferPoolManager &operator=(const BufferPoolManager &) = delete;
+
+            [[nodiscard]] Error
+            createPool(const std::string &name, size_t numFrames,
+                       page_size_t    pageSize = PAGE_SIZE_B,
+                       EvictionPolicy policy   = EvictionPolicy::CLOCK);
+
+            // Returns nullptr if there is no such pool.
+            std::shared_ptr<BufferPool> getPool(const std::string &name) const;
+
+            /**
+                Assigns the file to pool, all page accesses of the file must go
+                through it. The other pools of the manager, including ones
+                created later, refuse the file, so it must be assigned
+                before it is used.
+             */
+            [[nodiscard]] Error assign(IoId_t id, const std::string &name);
+
+            // Returns nullptr if file is not assigned to any pool.
+            std::shared_ptr<BufferPool> getPoolFor(IoId_t id) const;
+
+            /**
+                Resizes the pool online, see BufferPool::resize.
+             */
+            [[nodiscard]] Error resizePool(const std::string &name,
+                                           size_t             numFrames);
+
+          private:
+            std::shared_ptr<DiskManager> m_diskManager;
+
+            mutable std::shared_mutex m_mutex;
+            std::unordered_map<std::string, std::shared_ptr<BufferPool>>
+                m_pools;
+            std::unordered_map<IoId_t, std::shared_ptr<BufferPool>>
+                m_assignments;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
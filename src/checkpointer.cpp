@@ -0,0 +1,102 @@
+#include "checkpointer.h"
+#include "metrics.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <spdlog/spdlog.h>
+#include <utility>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        Checkpointer::Checkpointer(std::shared_ptr<BufferPool> pool,
+                                   CheckpointerOptions         options)
+            : m_pool{std::move(pool)}, k_options{options} {
+            PIG_ASSERT(k_options.m_batchPages > 0,
+                       "Checkpoint batch must have pages");
+        }
+
+        Checkpointer::~Checkpointer() { stop(); }
+
+        void Checkpointer::start() {
+            PIG_ASSERT(!m_thread.joinable(), "Checkpointer already started");
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = false;
+            }
+            m_thread = std::thread([this] { run(); });
+        }
+
+        void Checkpointer::stop() {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+            }
+            m_stopped.notify_all();
+            if (m_thread.joinable()) {
+                m_thread.join();
+            }
+        }
+
+        void Checkpointer::run() {
+            do {
+                if (auto err = checkpoint(); err) {
+                    SPDLOG_ERROR("Checkpoint failed: {}", err.what());
+                }
+            } while (waitUntil(std::chrono::steady_clock::now() +
+                               k_options.m_interval));
+        }
+
+        bool Checkpointer::waitUntil(
+            std::chrono::steady_clock::time_point deadline) {
+            std::unique_lock lock(m_mutex);
+            return !m_stopped.wait_until(lock, deadline,
+                                         [this] { return m_stopping; });
+        }
+
+        Error Checkpointer::checkpoint() {
+            lsn_t begin = m_pool->getCurrentLsn();
+            auto  dirty = m_pool->getDirtyPages();
+            // Changes after begin are not part of this checkpoint.
+            dirty.erase(std::remove_if(dirty.begin(), dirty.end(),
+                                       [begin](const BufferPool::DirtyPage &p) {
+                                           return p.m_recLsn > begin;
+                                       }),
+                        dirty.end());
+
+            auto   start   = std::chrono::steady_clock::now();
+            size_t written = 0;
+            while (written < dirty.size()) {
+                size_t batch = std::min<size_t>(k_options.m_batchPages,
+                                                dirty.size() - written);
+                if (auto err = m_pool->flushPages(&dirty[written], batch);
+                    err) {
+                    return err;
+                }
+                written += batch;
+                Metrics::global().add(Counter::CHECKPOINT_PAGES, batch);
+
+                if (k_options.m_pagesPerSecond != 0 &&
+                    !waitUntil(start + std::chrono::microseconds(
+                                           written * 1'000'000 /
+                                           k_options.m_pagesPerSecond))) {
+                    // Stopped, the checkpoint LSN stays where it was.
+                    return EMPRY_ERR;
+                }
+            }
+
+            // Redo starts at the oldest change not on disk, some pages may
+            // have been dirtied since begin.
+            lsn_t checkpointLsn = begin + 1;
+            for (const auto &page : m_pool->getDirtyPages()) {
+                checkpointLsn = std::min(checkpointLsn, page.m_recLsn);
+            }
+            m_checkpointLsn.store(checkpointLsn, std::memory_order_release);
+            Metrics::global().add(Counter::CHECKPOINTS);
+            SPDLOG_DEBUG("Checkpoint wrote {} pages, checkpoint LSN {}",
+                         written, checkpointLsn);
+            return EMPRY_ERR;
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
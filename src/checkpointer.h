@@ -0,0 +1,86 @@
+#ifndef PIG_CORE_CHECKPOINTER_H
+#define PIG_CORE_CHECKPOINTER_H
+
+#include "buffer_pool.h"
+#include "core.h"
+#include "error.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace Pig {
+    namespace Core {
+
+        struct CheckpointerOptions {
+            // Time from the end of one checkpoint to the start of the next.
+            std::chrono::milliseconds m_interval{1000};
+            // Pages written per second, 0 to write as fast as the disk can.
+            uint32_t m_pagesPerSecond = 0;
+            // Most pages latched and written together.
+            uint32_t m_batchPages = 16;
+        };
+
+        /**
+        Writes back dirty pages of a pool in the background so that recovery
+        only has to redo changes after the last checkpoint, and eviction
+        rarely has to flush.
+
+        Checkpoints are fuzzy, the pool stays in use throughout. A checkpoint
+        takes the current LSN, then writes every page of the dirty page table
+        whose recLSN is not later, in page id order and batches of adjacent
+        pages. Pages dirtied after it started are left to the next one.
+        Writes are spread over time at m_pagesPerSecond so that a checkpoint
+        does not compete with foreground IO in a burst.
+
+        The checkpoint LSN is the oldest recLSN still dirty once a checkpoint
+        ends, every change before it is on disk.
+         */
+        class Checkpointer {
+          public:
+            Checkpointer(std::shared_ptr<BufferPool> pool,
+                         CheckpointerOptions         options = {});
+
+            Checkpointer(const Checkpointer &)            = delete;
+            Checkpointer &operator=(const Checkpointer &) = delete;
+
+            ~Checkpointer();
+
+            // Starts checkpointing every m_interval on a background thread.
+            void start();
+
+            // Stops the background thread, cutting short a checkpoint.
+            void stop();
+
+            /**
+                Runs one checkpoint on the calling thread, rate limited as
+                the background ones.
+             */
+            [[nodiscard]] Error checkpoint();
+
+            lsn_t getCheckpointLsn() const noexcept {
+                return m_checkpointLsn.load(std::memory_order_acquire);
+            }
+
+          private:
+            void run();
+
+            // Waits till deadline, false if stopped meanwhile.
+            bool waitUntil(std::chrono::steady_clock::time_point deadline);
+
+            std::shared_ptr<BufferPool> m_pool;
+            const CheckpointerOptions   k_options;
+            std::atomic<lsn_t>          m_checkpointLsn{0};
+
+            std::mutex              m_mutex;
+            std::condition_variable m_stopped;
+            bool                    m_stopping{false};
+            std::thread             m_thread;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
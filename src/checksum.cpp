@@ -0,0 +1,199 @@
+#include "checksum.h"
+#include "xxhash.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace Pig {
+    namespace Core {
+
+        namespace {
+            // Reflected Castagnoli polynomial.
+            constexpr uint32_t CRC32C_POLY = 0x82F63B78;
+
+            constexpr std::array<uint32_t, 256> makeCrc32cTable() {
+                std::array<uint32_t, 256> table{};
+                for (uint32_t i = 0; i < 256; ++i) {
+                    uint32_t crc = i;
+                    for (int bit = 0; bit < 8; ++bit) {
+                        crc = crc & 1 ? crc >> 1 ^ CRC32C_POLY : crc >> 1;
+                    }
+                    table[i] = crc;
+                }
+                return table;
+            }
+
+            constexpr auto CRC32C_TABLE = makeCrc32cTable();
+
+            uint32_t crc32cSoftware(uint32_t crc, const unsigned char *data,
+                                    size_t len) {
+                for (size_t i = 0; i < len; ++i) {
+                    crc = CRC32C_TABLE[(crc ^ data[i]) & 0xFF] ^ crc >> 8;
+                }
+                return crc;
+            }
+
+#if defined(__x86_64__)
+            __attribute__((target("sse4.2"))) uint32_t
+            crc32cHardware(uint32_t crc, const unsigned char *data,
+                           size_t len) {
+                uint64_t crc64 = crc;
+                for (; len >= sizeof(uint64_t); len -= sizeof(uint64_t)) {
+                    uint64_t word;
+                    memcpy(&word, data, sizeof(word));
+                    crc64 = _mm_crc32_u64(crc64, word);
+                    data += sizeof(word);
+                }
+                crc = static_cast<uint32_t>(crc64);
+                for (; len > 0; --len) {
+                    crc = _mm_crc32_u8(crc, *data++);
+                }
+                return crc;
+            }
+
+            // The instruction has a latency of 3 cycles but a throughput of
+            // 1, so 4 independent buffers go through in the time of one.
+            __attribute__((target("sse4.2"))) void
+            crc32cHardware4(const iovec *data, uint32_t *checksums) {
+                std::array<uint64_t, 4>              crc;
+                std::array<const unsigned char *, 4> base;
+                size_t                               common = SIZE_MAX;
+                for (int k = 0; k < 4; ++k) {
+                    crc[k]  = 0xFFFFFFFF;
+                    base[k] = static_cast<const unsigned char *>(
+                        data[k].iov_base);
+                    common  = std::min(common, data[k].iov_len);
+                }
+                common -= common % sizeof(uint64_t);
+                for (size_t offset = 0; offset < common;
+                     offset += sizeof(uint64_t)) {
+                    for (int k = 0; k < 4; ++k) {
+                        uint64_t word;
+                        memcpy(&word, base[k] + offset, sizeof(word));
+                        crc[k] = _mm_crc32_u64(crc[k], word);
+                    }
+                }
+                for (int k = 0; k < 4; ++k) {
+                    checksums[k] = ~crc32cHardware(
+                        static_cast<uint32_t>(crc[k]), base[k] + common,
+                        data[k].iov_len - common);
+                }
+            }
+#endif
+
+            using Crc32cFn = uint32_t (*)(uint32_t, const unsigned char *,
+                                          size_t);
+
+            bool hasCrc32cInstruction() {
+#if defined(__x86_64__)
+                static const bool has = __builtin_cpu_supports("sse4.2");
+                return has;
+#else
+                return false;
+#endif
+            }
+
+            Crc32cFn crc32cUpdate() {
+#if defined(__x86_64__)
+                if (hasCrc32cInstruction()) {
+                    return crc32cHardware;
+                }
+#endif
+                return crc32cSoftware;
+            }
+
+            uint32_t crc32c(iovec data) {
+                auto base = static_cast<const unsigned char *>(data.iov_base);
+                return ~crc32cUpdate()(0xFFFFFFFF, base, data.iov_len);
+            }
+        } // namespace
+
+        uint32_t calculateChecksum(iovec data, ChecksumType type) {
+            switch (type) {
+            case ChecksumType::XXHASH32:
+                return XXH32(data.iov_base, data.iov_len, 0);
+            case ChecksumType::XXHASH3:
+                return static_cast<uint32_t>(
+                    XXH3_64bits(data.iov_base, data.iov_len));
+            case ChecksumType::CRC32C:
+                return crc32c(data);
+            }
+            return 0;
+        }
+
+        void calculateChecksums(const iovec *data, size_t count,
+                                ChecksumType type, uint32_t *checksums) {
+            size_t i = 0;
+            switch (type) {
+            case ChecksumType::XXHASH32:
+                for (; i < count; ++i) {
+                    checksums[i] =
+                        XXH32(data[i].iov_base, data[i].iov_len, 0);
+                }
+                break;
+            case ChecksumType::XXHASH3:
+                for (; i < count; ++i) {
+                    checksums[i] = static_cast<uint32_t>(
+                        XXH3_64bits(data[i].iov_base, data[i].iov_len));
+                }
+                break;
+            case ChecksumType::CRC32C:
+#if defined(__x86_64__)
+                if (hasCrc32cInstruction()) {
+                    for (; i + 4 <= count; i += 4) {
+                        crc32cHardware4(data + i, checksums + i);
+                    }
+                }
+#endif
+                for (; i < count; ++i) {
+                    checksums[i] = crc32c(data[i]);
+                }
+                break;
+            }
+        }
+
+        uint32_t pageChecksum(iovec page, size_t offset, ChecksumType type) {
+            auto base = static_cast<const unsigned char *>(page.iov_base);
+            auto rest = offset + sizeof(uint32_t);
+            switch (type) {
+            case ChecksumType::XXHASH32:
+                return XXH32(base + rest, page.iov_len - rest,
+                             XXH32(base, offset, 0));
+            case ChecksumType::XXHASH3:
+                return static_cast<uint32_t>(
+                    XXH3_64bits_withSeed(base + rest, page.iov_len - rest,
+                                         XXH3_64bits(base, offset)));
+            case ChecksumType::CRC32C: {
+                Crc32cFn update = crc32cUpdate();
+                return ~update(update(0xFFFFFFFF, base, offset), base + rest,
+                               page.iov_len - rest);
+            }
+            }
+            return 0;
+        }
+
+        void setPageChecksum(iovec page, size_t offset, ChecksumType type) {
+            uint32_t checksum = pageChecksum(page, offset, type);
+            // Flushers of a shared latched page may store it concurrently.
+            __atomic_store_n(reinterpret_cast<uint32_t *>(
+                                 static_cast<unsigned char *>(page.iov_base) +
+                                 offset),
+                             checksum, __ATOMIC_RELAXED);
+        }
+
+        bool verifyPageChecksum(iovec page, size_t offset, ChecksumType type) {
+            auto     base = static_cast<const unsigned char *>(page.iov_base);
+            uint32_t stored;
+            memcpy(&stored, base + offset, sizeof(stored));
+            if (stored == pageChecksum(page, offset, type)) {
+                return true;
+            }
+            return base[0] == 0 &&
+                   memcmp(base, base + 1, page.iov_len - 1) == 0;
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
@@ -0,0 +1,47 @@
+#ifndef PIG_CORE_CHECKSUM_H
+#define PIG_CORE_CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/uio.h>
+
+namespace Pig {
+    namespace Core {
+
+        // Checksum of tuples and pages of a file, recorded in its header.
+        enum class ChecksumType : uint8_t {
+            // Files created before the type was recorded.
+            XXHASH32 = 0,
+            // Low 32 bits of XXH3-64.
+            XXHASH3,
+            // Uses SSE4.2 when the CPU has it.
+            CRC32C
+        };
+
+        uint32_t calculateChecksum(iovec        data,
+                                   ChecksumType type = ChecksumType::XXHASH32);
+
+        /**
+            Checksums count buffers into checksums, same as calling
+            calculateChecksum on each. Picks the algorithm once and, for
+            CRC32C, interleaves several buffers to hide the latency of the
+            instruction, which matters for short tuples.
+         */
+        void calculateChecksums(const iovec *data, size_t count,
+                                ChecksumType type, uint32_t *checksums);
+
+        // Checksum of a whole page, without the 4 bytes at offset where it
+        // is stored.
+        uint32_t pageChecksum(iovec page, size_t offset,
+                              ChecksumType type = ChecksumType::XXHASH3);
+
+        void setPageChecksum(iovec page, size_t offset,
+                             ChecksumType type = ChecksumType::XXHASH3);
+
+        // Pages never written are all zeros and pass as well.
+        bool verifyPageChecksum(iovec page, size_t offset,
+                                ChecksumType type = ChecksumType::XXHASH3);
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
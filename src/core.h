@@ -2,17 +2,38 @@
 #define PIG_CORE_CORE_H
 
 #include <cstdint>
+#include <utility>
 
 namespace Pig {
     namespace Core {
 
-        using page_id_t   = uint16_t;
-        using page_size_t = uint16_t;
+        using page_id_t = uint16_t;
+        // Wide enough to hold the largest supported page size(64KB).
+        using page_size_t = uint32_t;
+        using PageSlot    = uint16_t;
+        using TupleId     = std::pair<page_id_t, PageSlot>;
+        // Transaction ids are handed out in commit order, see transaction.h
+        using txn_id_t = uint32_t;
+        // Orders page changes, see BufferPool::getCurrentLsn.
+        using lsn_t = uint64_t;
 
-        constexpr uint8_t     PAGE_SIZE_KB = 4;
-        constexpr page_size_t PAGE_SIZE_B  = PAGE_SIZE_KB * 1024;
+        // Default page size, each file can pick its own page size within
+        // [MIN_PAGE_SIZE_KB, MAX_PAGE_SIZE_KB] at creation.
+        constexpr uint8_t     PAGE_SIZE_KB     = 4;
+        constexpr uint8_t     MIN_PAGE_SIZE_KB = 4;
+        constexpr uint8_t     MAX_PAGE_SIZE_KB = 64;
+        constexpr page_size_t PAGE_SIZE_B      = PAGE_SIZE_KB * 1024;
+        constexpr page_size_t MIN_PAGE_SIZE_B  = MIN_PAGE_SIZE_KB * 1024;
+        constexpr page_size_t MAX_PAGE_SIZE_B  = MAX_PAGE_SIZE_KB * 1024;
         constexpr uint16_t    MAX_PAGES = 32768; // 4KB page enough for spacemap
         constexpr uint16_t    MAX_TABLES = 100;
+
+        // Page sizes are powers of 2 so that page offsets are shifts.
+        constexpr bool isValidPageSize(page_size_t pageSizeBytes) {
+            return pageSizeBytes >= MIN_PAGE_SIZE_B &&
+                   pageSizeBytes <= MAX_PAGE_SIZE_B &&
+                   (pageSizeBytes & (pageSizeBytes - 1)) == 0;
+        }
     } // namespace Core
 } // namespace Pig
 
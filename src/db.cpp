@@ -0,0 +1,1016 @@
+#include "pigdb/db.h"
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "error.h"
+#include "heap.h"
+#include "metrics.h"
+#include "task_scheduler.h"
+#include "transaction.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string_view>
+#include <sys/uio.h>
+#include <unordered_map>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace Pig {
+    using Core::BufferPool;
+    using Core::Counter;
+    using Core::DiskManager;
+    using Core::HeapFile;
+    using Core::Metrics;
+    using Core::page_id_t;
+    using Core::Snapshot;
+    using Core::TransactionManager;
+    using Core::TupleId;
+
+    namespace {
+        enum class CompareOp : uint8_t { EQ, NE, LT, LE, GT, GE };
+
+        enum class AggregateFn : uint8_t { COUNT, SUM, MIN, MAX };
+
+        struct Aggregate {
+            AggregateFn m_fn;
+            // Empty for COUNT(*).
+            std::string m_columnName;
+            size_t      m_column = SIZE_MAX;
+        };
+
+        // Running value of an aggregate over some of the rows.
+        struct AggregateState {
+            int64_t m_count = 0;
+            int64_t m_sum   = 0;
+            int64_t m_min   = INT64_MAX;
+            int64_t m_max   = INT64_MIN;
+
+            void add(int64_t value) noexcept {
+                ++m_count;
+                m_sum += value;
+                m_min = std::min(m_min, value);
+                m_max = std::max(m_max, value);
+            }
+
+            void merge(const AggregateState &other) noexcept {
+                m_count += other.m_count;
+                m_sum += other.m_sum;
+                m_min = std::min(m_min, other.m_min);
+                m_max = std::max(m_max, other.m_max);
+            }
+
+            int64_t get(AggregateFn fn) const noexcept {
+                switch (fn) {
+                case AggregateFn::COUNT:
+                    return m_count;
+                case AggregateFn::SUM:
+                    return m_sum;
+                case AggregateFn::MIN:
+                    return m_count == 0 ? 0 : m_min;
+                case AggregateFn::MAX:
+                    return m_count == 0 ? 0 : m_max;
+                }
+                return 0;
+            }
+        };
+
+        // A literal, or the index of a parameter.
+        struct Operand {
+            int32_t m_value   = 0;
+            bool    m_isParam = false;
+
+            int32_t resolve(const int32_t *params) const noexcept {
+                return m_isParam ? params[m_value] : m_value;
+            }
+        };
+
+        bool compare(int32_t lhs, CompareOp op, int32_t rhs) noexcept {
+            switch (op) {
+            case CompareOp::EQ:
+                return lhs == rhs;
+            case CompareOp::NE:
+                return lhs != rhs;
+            case CompareOp::LT:
+                return lhs < rhs;
+            case CompareOp::LE:
+                return lhs <= rhs;
+            case CompareOp::GT:
+                return lhs > rhs;
+            case CompareOp::GE:
+                return lhs >= rhs;
+            }
+            return false;
+        }
+
+        struct Table {
+            std::string               m_name;
+            std::vector<std::string>  m_columns;
+            size_t                    m_keyColumn = 0;
+            std::unique_ptr<HeapFile> m_heap;
+            // Rows that fit the heap, an insert past it would find no page.
+            uint64_t m_capacity = 0;
+            // Only changed by the writer transaction.
+            uint64_t m_numRows = 0;
+
+            // Stand-in for the primary index.
+            std::shared_mutex          m_indexLock;
+            std::map<int32_t, TupleId> m_index;
+        };
+
+        Status toStatus(const Core::Error &err) {
+            return Status(static_cast<StatusCode>(err.code()), err.what());
+        }
+    } // namespace
+
+    struct Statement::Plan {
+        enum class Kind : uint8_t { CREATE_TABLE, INSERT, SELECT };
+        // How SELECT finds its rows.
+        enum class Access : uint8_t { SCAN, KEY_LOOKUP, KEY_RANGE };
+
+        static constexpr size_t NO_COLUMN = SIZE_MAX;
+
+        Kind        m_kind      = Kind::SELECT;
+        size_t      m_numParams = 0;
+        std::string m_tableName;
+        // Columns of CREATE TABLE, or those SELECT returns, none for *.
+        std::vector<std::string> m_columns;
+        size_t                   m_keyColumn = NO_COLUMN;
+        // SELECT returns these instead of columns if any.
+        std::vector<Aggregate> m_aggregates;
+        // Values of INSERT in column order.
+        std::vector<Operand> m_values;
+        bool                 m_hasWhere = false;
+        std::string          m_whereColumnName;
+        CompareOp            m_op = CompareOp::EQ;
+        Operand              m_operand;
+
+        // Filled in by planning from the catalog.
+        Table              *m_table = nullptr;
+        std::vector<size_t> m_projection;
+        size_t              m_whereColumn = NO_COLUMN;
+        Access              m_access      = Access::SCAN;
+    };
+
+    namespace {
+        using Plan = Statement::Plan;
+
+        /**
+            Recursive descent over the statement text, straight into a
+            plan. Keywords are matched in any case, names as written.
+         */
+        class Parser {
+          public:
+            Parser(std::string_view sql, Plan &plan)
+                : m_sql{sql}, m_plan{plan} {}
+
+            Status parse() {
+                Status status;
+                if (acceptKeyword("CREATE")) {
+                    status = parseCreate();
+                } else if (acceptKeyword("INSERT")) {
+                    status = parseInsert();
+                } else if (acceptKeyword("SELECT")) {
+                    status = parseSelect();
+                } else {
+                    return expected("CREATE, INSERT or SELECT");
+                }
+                if (!status.ok()) {
+                    return status;
+                }
+                acceptSymbol(";");
+                skipSpaces();
+                if (m_pos != m_sql.size()) {
+                    return expected("end of statement");
+                }
+                return status;
+            }
+
+          private:
+            // TABLE t (col INT [PRIMARY KEY] [NOT NULL], ...)
+            Status parseCreate() {
+                m_plan.m_kind = Plan::Kind::CREATE_TABLE;
+                if (!acceptKeyword("TABLE")) {
+                    return expected("TABLE");
+                }
+                if (auto status = name(m_plan.m_tableName); !status.ok()) {
+                    return status;
+                }
+                if (!acceptSymbol("(")) {
+                    return expected("(");
+                }
+                do {
+                    std::string column;
+                    if (auto status = name(column); !status.ok()) {
+                        return status;
+                    }
+                    if (!acceptKeyword("INT") && !acceptKeyword("INTEGER")) {
+                        return expected("INT");
+                    }
+                    for (;;) {
+                        if (acceptKeyword("PRIMARY")) {
+                            if (!acceptKeyword("KEY")) {
+                                return expected("KEY");
+                            }
+                            if (m_plan.m_keyColumn != Plan::NO_COLUMN) {
+                                return Status(StatusCode::SYNTAX_ERROR,
+                                              "More than one primary key");
+                            }
+                            m_plan.m_keyColumn = m_plan.m_columns.size();
+                        } else if (acceptKeyword("NOT")) {
+                            // Columns are never null anyway.
+                            if (!acceptKeyword("NULL")) {
+                                return expected("NULL");
+                            }
+                        } else {
+                            break;
+                        }
+                    }
+                    m_plan.m_columns.push_back(std::move(column));
+                } while (acceptSymbol(","));
+                if (!acceptSymbol(")")) {
+                    return expected(")");
+                }
+                return Status();
+            }
+
+            // INTO t VALUES (v, ...)
+            Status parseInsert() {
+                m_plan.m_kind = Plan::Kind::INSERT;
+                if (!acceptKeyword("INTO")) {
+                    return expected("INTO");
+                }
+                if (auto status = name(m_plan.m_tableName); !status.ok()) {
+                    return status;
+                }
+                if (!acceptKeyword("VALUES")) {
+                    return expected("VALUES");
+                }
+                if (!acceptSymbol("(")) {
+                    return expected("(");
+                }
+                do {
+                    Operand value;
+                    if (auto status = operand(value); !status.ok()) {
+                        return status;
+                    }
+                    m_plan.m_values.push_back(value);
+                } while (acceptSymbol(","));
+                if (!acceptSymbol(")")) {
+                    return expected(")");
+                }
+                return Status();
+            }
+
+            // * | item, ... FROM t [WHERE col op v], item is a column or
+            // an aggregate of one.
+            Status parseSelect() {
+                m_plan.m_kind = Plan::Kind::SELECT;
+                if (!acceptSymbol("*")) {
+                    do {
+                        if (auto status = selectItem(); !status.ok()) {
+                            return status;
+                        }
+                    } while (acceptSymbol(","));
+                }
+                if (!m_plan.m_aggregates.empty() &&
+                    !m_plan.m_columns.empty()) {
+                    return Status(StatusCode::SYNTAX_ERROR,
+                                  "Columns can not be mixed with aggregates");
+                }
+                if (!acceptKeyword("FROM")) {
+                    return expected("FROM");
+                }
+                if (auto status = name(m_plan.m_tableName); !status.ok()) {
+                    return status;
+                }
+                if (!acceptKeyword("WHERE")) {
+                    return Status();
+                }
+                m_plan.m_hasWhere = true;
+                if (auto status = name(m_plan.m_whereColumnName);
+                    !status.ok()) {
+                    return status;
+                }
+                // Two character operators first so that < does not match <=.
+                static constexpr std::pair<const char *, CompareOp> OPS[] = {
+                    {"<=", CompareOp::LE}, {">=", CompareOp::GE},
+                    {"!=", CompareOp::NE}, {"<>", CompareOp::NE},
+                    {"=", CompareOp::EQ},  {"<", CompareOp::LT},
+                    {">", CompareOp::GT}};
+                auto op = std::find_if(
+                    std::begin(OPS), std::end(OPS),
+                    [this](const auto &o) { return acceptSymbol(o.first); });
+                if (op == std::end(OPS)) {
+                    return expected("comparison");
+                }
+                m_plan.m_op = op->second;
+                return operand(m_plan.m_operand);
+            }
+
+            Status selectItem() {
+                static constexpr std::pair<const char *, AggregateFn> FNS[] =
+                    {{"COUNT", AggregateFn::COUNT},
+                     {"SUM", AggregateFn::SUM},
+                     {"MIN", AggregateFn::MIN},
+                     {"MAX", AggregateFn::MAX}};
+                size_t start = m_pos;
+                for (const auto &[keyword, fn] : FNS) {
+                    if (!acceptKeyword(keyword)) {
+                        continue;
+                    }
+                    if (!acceptSymbol("(")) {
+                        // A column named as the function.
+                        m_pos = start;
+                        break;
+                    }
+                    Aggregate aggregate{fn, {}};
+                    if (fn != AggregateFn::COUNT || !acceptSymbol("*")) {
+                        if (auto status = name(aggregate.m_columnName);
+                            !status.ok()) {
+                            return status;
+                        }
+                    }
+                    if (!acceptSymbol(")")) {
+                        return expected(")");
+                    }
+                    m_plan.m_aggregates.push_back(std::move(aggregate));
+                    return Status();
+                }
+                std::string column;
+                if (auto status = name(column); !status.ok()) {
+                    return status;
+                }
+                m_plan.m_columns.push_back(std::move(column));
+                return Status();
+            }
+
+            Status name(std::string &out) {
+                skipSpaces();
+                size_t start = m_pos;
+                while (m_pos < m_sql.size() && isNameChar(m_sql[m_pos]) &&
+                       (m_pos > start || !isDigit(m_sql[m_pos]))) {
+                    ++m_pos;
+                }
+                if (m_pos == start) {
+                    return expected("name");
+                }
+                out.assign(m_sql.substr(start, m_pos - start));
+                return Status();
+            }
+
+            Status operand(Operand &out) {
+                if (acceptSymbol("?")) {
+                    out.m_isParam = true;
+                    out.m_value   = static_cast<int32_t>(m_plan.m_numParams++);
+                    return Status();
+                }
+                skipSpaces();
+                const char *first = m_sql.data() + m_pos;
+                const char *last  = m_sql.data() + m_sql.size();
+                auto [end, ec]    = std::from_chars(first, last, out.m_value);
+                if (ec == std::errc::result_out_of_range) {
+                    return Status(StatusCode::SYNTAX_ERROR,
+                                  fmt::format("Integer out of range at "
+                                              "offset {}",
+                                              m_pos));
+                }
+                if (ec != std::errc() ||
+                    (end != last && isNameChar(*end))) {
+                    return expected("integer or ?");
+                }
+                out.m_isParam = false;
+                m_pos += end - first;
+                return Status();
+            }
+
+            bool acceptKeyword(std::string_view keyword) {
+                skipSpaces();
+                if (m_sql.size() - m_pos < keyword.size()) {
+                    return false;
+                }
+                for (size_t i = 0; i < keyword.size(); ++i) {
+                    if (toUpper(m_sql[m_pos + i]) != keyword[i]) {
+                        return false;
+                    }
+                }
+                size_t end = m_pos + keyword.size();
+                if (end < m_sql.size() && isNameChar(m_sql[end])) {
+                    return false;
+                }
+                m_pos = end;
+                return true;
+            }
+
+            bool acceptSymbol(std::string_view symbol) {
+                skipSpaces();
+                if (m_sql.substr(m_pos, symbol.size()) != symbol) {
+                    return false;
+                }
+                m_pos += symbol.size();
+                return true;
+            }
+
+            void skipSpaces() {
+                while (m_pos < m_sql.size() &&
+                       (m_sql[m_pos] == ' ' || m_sql[m_pos] == '\t' ||
+                        m_sql[m_pos] == '\n' || m_sql[m_pos] == '\r')) {
+                    ++m_pos;
+                }
+            }
+
+            Status expected(std::string_view what) const {
+                return Status(StatusCode::SYNTAX_ERROR,
+                              fmt::format("Expected {} at offset {}", what,
+                                          m_pos));
+            }
+
+            static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+            static bool isNameChar(char c) {
+                return isDigit(c) || c == '_' || (c >= 'a' && c <= 'z') ||
+                       (c >= 'A' && c <= 'Z');
+            }
+
+            static char toUpper(char c) {
+                return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A')
+                                            : c;
+            }
+
+            std::string_view m_sql;
+            Plan            &m_plan;
+            size_t           m_pos = 0;
+        };
+
+        size_t findColumn(const Table &table, const std::string &column) {
+            auto it = std::find(table.m_columns.begin(),
+                                table.m_columns.end(), column);
+            return it == table.m_columns.end()
+                       ? Plan::NO_COLUMN
+                       : static_cast<size_t>(it - table.m_columns.begin());
+        }
+
+        int32_t readColumn(iovec payload, size_t column) {
+            int32_t value;
+            memcpy(&value,
+                   static_cast<const unsigned char *>(payload.iov_base) +
+                       column * sizeof(value),
+                   sizeof(value));
+            return value;
+        }
+
+        bool matches(const Plan &plan, iovec payload, const int32_t *params) {
+            return !plan.m_hasWhere ||
+                   compare(readColumn(payload, plan.m_whereColumn), plan.m_op,
+                           plan.m_operand.resolve(params));
+        }
+
+        /**
+            Values of the WHERE column that may match, for zone maps to skip
+            pages without any. Inequality rules out too little to bother.
+         */
+        bool whereRange(const Plan &plan, const int32_t *params,
+                        HeapFile::ColumnRange &range) {
+            if (!plan.m_hasWhere || plan.m_op == CompareOp::NE) {
+                return false;
+            }
+            int64_t value = plan.m_operand.resolve(params);
+            int64_t low   = INT32_MIN;
+            int64_t high  = INT32_MAX;
+            switch (plan.m_op) {
+            case CompareOp::EQ:
+                low  = value;
+                high = value;
+                break;
+            case CompareOp::LT:
+                high = value - 1;
+                break;
+            case CompareOp::LE:
+                high = value;
+                break;
+            case CompareOp::GT:
+                low = value + 1;
+                break;
+            case CompareOp::GE:
+                low = value;
+                break;
+            case CompareOp::NE:
+                break;
+            }
+            // Below INT32_MIN or above INT32_MAX, no value matches.
+            if (low > high) {
+                low  = INT32_MAX;
+                high = INT32_MIN;
+            }
+            range = HeapFile::ColumnRange{
+                static_cast<uint16_t>(plan.m_whereColumn),
+                static_cast<int32_t>(low), static_cast<int32_t>(high)};
+            return true;
+        }
+
+        // Appends the columns SELECT returns or adds the row to states.
+        void consume(const Plan &plan, iovec payload,
+                     std::vector<int64_t> &rows, AggregateState *states) {
+            for (size_t column : plan.m_projection) {
+                rows.push_back(readColumn(payload, column));
+            }
+            for (size_t i = 0; i < plan.m_aggregates.size(); ++i) {
+                size_t column = plan.m_aggregates[i].m_column;
+                states[i].add(column == Plan::NO_COLUMN
+                                  ? 0
+                                  : readColumn(payload, column));
+            }
+        }
+    } // namespace
+
+    struct Database::Impl {
+        explicit Impl(const DatabaseOptions &options)
+            : k_options{options},
+              m_diskManager{std::make_shared<DiskManager>()},
+              m_pool{std::make_shared<BufferPool>(options.m_poolFrames,
+                                                  m_diskManager)},
+              m_scheduler{options.m_scanThreads != 0
+                              ? options.m_scanThreads
+                              : Core::TaskScheduler::defaultNumWorkers(),
+                          options.m_pinScanThreads} {}
+
+        // Plan from the cache, or parsed and planned on a miss.
+        Status getPlan(const std::string           &sql,
+                       std::shared_ptr<const Plan> &plan);
+
+        // Resolves names of the plan against the catalog.
+        Status resolve(Plan &plan) const;
+
+        Status createTable(const Plan &plan);
+
+        Status insert(const Plan &plan, const int32_t *params);
+
+        // Scans the whole table in morsels of pages on the scan threads,
+        // appending rows or adding them to states.
+        Status scan(const Plan &plan, const int32_t *params,
+                    const Snapshot &snapshot, std::vector<int64_t> &rows,
+                    std::vector<AggregateState> &states);
+
+        // Finds the rows through the primary index.
+        Status lookup(const Plan &plan, const int32_t *params,
+                      const Snapshot &snapshot, std::vector<int64_t> &rows,
+                      std::vector<AggregateState> &states);
+
+        const DatabaseOptions        k_options;
+        std::shared_ptr<DiskManager> m_diskManager;
+        std::shared_ptr<BufferPool>  m_pool;
+        TransactionManager           m_txnManager;
+        Core::TaskScheduler          m_scheduler;
+
+        // Tables are never dropped, so plans may keep pointers to them.
+        mutable std::shared_mutex                               m_catalogLock;
+        std::unordered_map<std::string, std::unique_ptr<Table>> m_tables;
+
+        mutable std::mutex m_planCacheLock;
+        std::unordered_map<std::string, std::shared_ptr<const Plan>>
+            m_planCache;
+    };
+
+    Status Database::Impl::getPlan(const std::string           &sql,
+                                   std::shared_ptr<const Plan> &plan) {
+        if (k_options.m_planCacheSize > 0) {
+            std::lock_guard lock(m_planCacheLock);
+            auto            it = m_planCache.find(sql);
+            if (it != m_planCache.end()) {
+                Metrics::global().add(Counter::PLAN_CACHE_HITS);
+                plan = it->second;
+                return Status();
+            }
+        }
+        Metrics::global().add(Counter::PLAN_CACHE_MISSES);
+
+        auto parsed = std::make_shared<Plan>();
+        if (auto status = Parser(sql, *parsed).parse(); !status.ok()) {
+            return status;
+        }
+        if (auto status = resolve(*parsed); !status.ok()) {
+            return status;
+        }
+        // CREATE TABLE runs once, there is nothing to reuse.
+        if (k_options.m_planCacheSize > 0 &&
+            parsed->m_kind != Plan::Kind::CREATE_TABLE) {
+            std::lock_guard lock(m_planCacheLock);
+            // Statements that repeat are added back soon after.
+            if (m_planCache.size() >= k_options.m_planCacheSize) {
+                m_planCache.clear();
+            }
+            m_planCache.emplace(sql, parsed);
+        }
+        plan = std::move(parsed);
+        return Status();
+    }
+
+    Status Database::Impl::resolve(Plan &plan) const {
+        if (plan.m_kind == Plan::Kind::CREATE_TABLE) {
+            if (plan.m_keyColumn == Plan::NO_COLUMN) {
+                return Status(StatusCode::INVALID_ARG,
+                              fmt::format("Table {} has no primary key",
+                                          plan.m_tableName));
+            }
+            for (size_t i = 0; i < plan.m_columns.size(); ++i) {
+                if (std::count(plan.m_columns.begin(),
+                               plan.m_columns.begin() + i,
+                               plan.m_columns[i]) != 0) {
+                    return Status(StatusCode::INVALID_ARG,
+                                  fmt::format("Duplicate column {}",
+                                              plan.m_columns[i]));
+                }
+            }
+            return Status();
+        }
+
+        {
+            std::shared_lock lock(m_catalogLock);
+            auto             it = m_tables.find(plan.m_tableName);
+            if (it == m_tables.end()) {
+                return Status(
+                    StatusCode::NOT_FOUND,
+                    fmt::format("No table {}", plan.m_tableName));
+            }
+            plan.m_table = it->second.get();
+        }
+        const Table &table = *plan.m_table;
+
+        if (plan.m_kind == Plan::Kind::INSERT) {
+            if (plan.m_values.size() != table.m_columns.size()) {
+                return Status(
+                    StatusCode::INVALID_ARG,
+                    fmt::format("Table {} has {} columns, {} values given",
+                                table.m_name, table.m_columns.size(),
+                                plan.m_values.size()));
+            }
+            return Status();
+        }
+
+        if (plan.m_aggregates.empty()) {
+            if (plan.m_columns.empty()) {
+                plan.m_columns = table.m_columns;
+            }
+            for (const auto &column : plan.m_columns) {
+                size_t index = findColumn(table, column);
+                if (index == Plan::NO_COLUMN) {
+                    return Status(StatusCode::NOT_FOUND,
+                                  fmt::format("No column {} in table {}",
+                                              column, table.m_name));
+                }
+                plan.m_projection.push_back(index);
+            }
+        }
+        for (auto &aggregate : plan.m_aggregates) {
+            static constexpr const char *NAMES[] = {"COUNT", "SUM", "MIN",
+                                                    "MAX"};
+            const char *fn = NAMES[static_cast<size_t>(aggregate.m_fn)];
+            if (aggregate.m_columnName.empty()) {
+                plan.m_columns.push_back(fmt::format("{}(*)", fn));
+                continue;
+            }
+            aggregate.m_column = findColumn(table, aggregate.m_columnName);
+            if (aggregate.m_column == Plan::NO_COLUMN) {
+                return Status(StatusCode::NOT_FOUND,
+                              fmt::format("No column {} in table {}",
+                                          aggregate.m_columnName,
+                                          table.m_name));
+            }
+            plan.m_columns.push_back(
+                fmt::format("{}({})", fn, aggregate.m_columnName));
+        }
+        if (!plan.m_hasWhere) {
+            return Status();
+        }
+        plan.m_whereColumn = findColumn(table, plan.m_whereColumnName);
+        if (plan.m_whereColumn == Plan::NO_COLUMN) {
+            return Status(StatusCode::NOT_FOUND,
+                          fmt::format("No column {} in table {}",
+                                      plan.m_whereColumnName, table.m_name));
+        }
+        // The index answers any comparison on the key but inequality.
+        if (plan.m_whereColumn == table.m_keyColumn &&
+            plan.m_op != CompareOp::NE) {
+            plan.m_access = plan.m_op == CompareOp::EQ
+                                ? Plan::Access::KEY_LOOKUP
+                                : Plan::Access::KEY_RANGE;
+        }
+        return Status();
+    }
+
+    Status Database::Impl::createTable(const Plan &plan) {
+        iovec row;
+        row.iov_base = nullptr;
+        row.iov_len  = sizeof(int32_t) * plan.m_columns.size();
+        uint64_t tuplesPerPage =
+            HeapFile::Page::freeBytesFor(Core::PAGE_SIZE_B) /
+            HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, row));
+        if (tuplesPerPage == 0) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("Rows of {} columns do not fit a page",
+                                      plan.m_columns.size()));
+        }
+
+        std::unique_lock lock(m_catalogLock);
+        if (m_tables.count(plan.m_tableName) != 0) {
+            return Status(StatusCode::ALREADY_EXISTS,
+                          fmt::format("Table {} already exists",
+                                      plan.m_tableName));
+        }
+        if (m_tables.size() >= Core::MAX_TABLES) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("At most {} tables", Core::MAX_TABLES));
+        }
+        auto table         = std::make_unique<Table>();
+        table->m_name      = plan.m_tableName;
+        table->m_columns   = plan.m_columns;
+        table->m_keyColumn = plan.m_keyColumn;
+        // Every column has a zone map, so scans filtering on any of them can
+        // skip pages.
+        table->m_heap = HeapFile::create(
+            m_diskManager, m_pool, Core::PAGE_SIZE_B,
+            k_options.m_pagesPerTable, Core::ChecksumType::XXHASH3,
+            static_cast<uint16_t>(plan.m_columns.size()));
+        // Rows are all the same size and pages are filled in order, so
+        // every page is full before an insert finds no room.
+        table->m_capacity = k_options.m_pagesPerTable * tuplesPerPage;
+        m_tables.emplace(plan.m_tableName, std::move(table));
+        return Status();
+    }
+
+    Status Database::Impl::insert(const Plan &plan, const int32_t *params) {
+        Table               &table = *plan.m_table;
+        std::vector<int32_t> row(plan.m_values.size());
+        for (size_t i = 0; i < row.size(); ++i) {
+            row[i] = plan.m_values[i].resolve(params);
+        }
+        int32_t key = row[table.m_keyColumn];
+
+        // Only the writer changes the index, so the key stays absent
+        // between the check and the insert.
+        auto txn = m_txnManager.beginWrite();
+        if (table.m_numRows >= table.m_capacity) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("Table {} is full", table.m_name));
+        }
+        {
+            std::shared_lock lock(table.m_indexLock);
+            if (table.m_index.count(key) != 0) {
+                return Status(StatusCode::ALREADY_EXISTS,
+                              fmt::format("Duplicate key {} in table {}", key,
+                                          table.m_name));
+            }
+        }
+        iovec tuple;
+        tuple.iov_base = row.data();
+        tuple.iov_len  = row.size() * sizeof(int32_t);
+        TupleId tupleId;
+        if (auto err = table.m_heap->addTuple(txn, tuple, tupleId); err) {
+            return toStatus(err);
+        }
+        {
+            // Readers that find the entry before commit do not see the
+            // tuple version, as if the entry was not there.
+            std::unique_lock lock(table.m_indexLock);
+            table.m_index.emplace(key, tupleId);
+        }
+        ++table.m_numRows;
+        txn.commit();
+        return Status();
+    }
+
+    Status Database::Impl::scan(const Plan &plan, const int32_t *params,
+                                const Snapshot              &snapshot,
+                                std::vector<int64_t>        &rows,
+                                std::vector<AggregateState> &states) {
+        HeapFile    &heap        = *plan.m_table->m_heap;
+        const size_t numPages    = heap.getHeader().m_numPages;
+        const size_t morselPages = k_options.m_morselPages;
+        const size_t numMorsels  = (numPages + morselPages - 1) / morselPages;
+
+        // A cache line each as workers append to them at once. Merged in
+        // page order, so rows come out as a serial scan returns them.
+        struct alignas(64) Partial {
+            std::vector<int64_t>        m_rows;
+            std::vector<AggregateState> m_states;
+            Status                      m_status;
+        };
+        std::vector<Partial>  partials(numMorsels);
+        HeapFile::ColumnRange range;
+        bool hasRange = whereRange(plan, params, range);
+        m_scheduler.parallelFor(numMorsels, [&](uint32_t, size_t morsel) {
+            Partial &partial = partials[morsel];
+            partial.m_states.resize(states.size());
+            auto first = static_cast<page_id_t>(morsel * morselPages);
+            auto end   = static_cast<page_id_t>(
+                std::min(numPages, first + morselPages));
+            auto visit = [&](const TupleId &, iovec payload) {
+                if (matches(plan, payload, params)) {
+                    consume(plan, payload, partial.m_rows,
+                            partial.m_states.data());
+                }
+                return true;
+            };
+            auto err = hasRange ? heap.scan(snapshot, first, end, range, visit)
+                                : heap.scan(snapshot, first, end, visit);
+            if (err) {
+                partial.m_status = toStatus(err);
+            }
+        });
+
+        for (auto &partial : partials) {
+            if (!partial.m_status.ok()) {
+                return partial.m_status;
+            }
+            rows.insert(rows.end(), partial.m_rows.begin(),
+                        partial.m_rows.end());
+            for (size_t i = 0; i < states.size(); ++i) {
+                states[i].merge(partial.m_states[i]);
+            }
+        }
+        return Status();
+    }
+
+    Status Database::Impl::lookup(const Plan &plan, const int32_t *params,
+                                  const Snapshot              &snapshot,
+                                  std::vector<int64_t>        &rows,
+                                  std::vector<AggregateState> &states) {
+        Table &table = *plan.m_table;
+        // Ids are collected first so that the index is not locked while
+        // pages are read.
+        int32_t              key = plan.m_operand.resolve(params);
+        TupleId              single;
+        std::vector<TupleId> range;
+        const TupleId       *first = &single;
+        const TupleId       *last  = &single;
+        {
+            std::shared_lock lock(table.m_indexLock);
+            auto            &index = table.m_index;
+            if (plan.m_access == Plan::Access::KEY_LOOKUP) {
+                auto it = index.find(key);
+                if (it != index.end()) {
+                    single = it->second;
+                    last   = first + 1;
+                }
+            } else {
+                auto begin = index.begin();
+                auto end   = index.end();
+                switch (plan.m_op) {
+                case CompareOp::LT:
+                    end = index.lower_bound(key);
+                    break;
+                case CompareOp::LE:
+                    end = index.upper_bound(key);
+                    break;
+                case CompareOp::GT:
+                    begin = index.upper_bound(key);
+                    break;
+                default:
+                    begin = index.lower_bound(key);
+                    break;
+                }
+                for (auto it = begin; it != end; ++it) {
+                    range.push_back(it->second);
+                }
+                first = range.data();
+                last  = first + range.size();
+            }
+        }
+
+        HeapFile::TupleView view;
+        for (const TupleId *tupleId = first; tupleId != last; ++tupleId) {
+            auto err = table.m_heap->viewTuple(snapshot, *tupleId, view);
+            if (err.code() == Core::ERR_NOT_FOUND) {
+                // Inserted after the snapshot.
+                continue;
+            }
+            if (err) {
+                return toStatus(err);
+            }
+            consume(plan, view.getPayload(), rows, states.data());
+        }
+        return Status();
+    }
+
+    Database::Database(std::unique_ptr<Impl> impl) : m_impl{std::move(impl)} {}
+
+    Database::~Database() = default;
+
+    Status Database::open(const DatabaseOptions   &options,
+                          std::unique_ptr<Database> &db) {
+        if (options.m_poolFrames == 0) {
+            return Status(StatusCode::INVALID_ARG, "Pool needs a frame");
+        }
+        if (options.m_morselPages == 0) {
+            return Status(StatusCode::INVALID_ARG, "Morsels need a page");
+        }
+        if (options.m_pagesPerTable == 0 ||
+            options.m_pagesPerTable > Core::MAX_PAGES) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("Tables have 1 to {} pages",
+                                      Core::MAX_PAGES));
+        }
+        db.reset(new Database(std::make_unique<Impl>(options)));
+        return Status();
+    }
+
+    Status Database::execute(const std::string &sql, ResultSet &result) {
+        std::shared_ptr<const Plan> plan;
+        if (auto status = m_impl->getPlan(sql, plan); !status.ok()) {
+            return status;
+        }
+        if (plan->m_numParams > 0) {
+            return Status(StatusCode::INVALID_ARG,
+                          "Statement has parameters, prepare it");
+        }
+        return run(*plan, nullptr, result);
+    }
+
+    Status Database::execute(const std::string &sql) {
+        ResultSet result;
+        return execute(sql, result);
+    }
+
+    Status Database::prepare(const std::string &sql, Statement &statement) {
+        std::shared_ptr<const Plan> plan;
+        if (auto status = m_impl->getPlan(sql, plan); !status.ok()) {
+            return status;
+        }
+        statement.m_db = this;
+        statement.m_params.assign(plan->m_numParams, 0);
+        statement.m_isBound.assign(plan->m_numParams, false);
+        statement.m_plan = std::move(plan);
+        return Status();
+    }
+
+    size_t Database::getNumCachedPlans() const {
+        std::lock_guard lock(m_impl->m_planCacheLock);
+        return m_impl->m_planCache.size();
+    }
+
+    Status Database::run(const Plan &plan, const int32_t *params,
+                         ResultSet &result) {
+        switch (plan.m_kind) {
+        case Plan::Kind::CREATE_TABLE:
+            return m_impl->createTable(plan);
+        case Plan::Kind::INSERT:
+            return m_impl->insert(plan, params);
+        case Plan::Kind::SELECT:
+            break;
+        }
+
+        // Assigning keeps the memory of the previous result.
+        result.m_columns = plan.m_columns;
+        result.m_values.clear();
+        Snapshot snapshot = m_impl->m_txnManager.snapshot();
+        // Empty unless the query aggregates, so point queries do not
+        // allocate.
+        std::vector<AggregateState> states(plan.m_aggregates.size());
+        auto status = plan.m_access == Plan::Access::SCAN
+                          ? m_impl->scan(plan, params, snapshot,
+                                         result.m_values, states)
+                          : m_impl->lookup(plan, params, snapshot,
+                                           result.m_values, states);
+        if (!status.ok()) {
+            return status;
+        }
+        for (size_t i = 0; i < states.size(); ++i) {
+            result.m_values.push_back(
+                states[i].get(plan.m_aggregates[i].m_fn));
+        }
+        return Status();
+    }
+
+    Statement::Statement()                                 = default;
+    Statement::Statement(Statement &&) noexcept            = default;
+    Statement &Statement::operator=(Statement &&) noexcept = default;
+    Statement::~Statement()                                = default;
+
+    Status Statement::bind(size_t index, int32_t value) {
+        if (index >= m_params.size()) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("No parameter {}, statement has {}",
+                                      index, m_params.size()));
+        }
+        m_params[index]  = value;
+        m_isBound[index] = true;
+        return Status();
+    }
+
+    Status Statement::execute(ResultSet &result) {
+        if (!m_plan) {
+            return Status(StatusCode::INVALID_ARG, "Statement not prepared");
+        }
+        auto unbound = std::find(m_isBound.begin(), m_isBound.end(), false);
+        if (unbound != m_isBound.end()) {
+            return Status(StatusCode::INVALID_ARG,
+                          fmt::format("Parameter {} is not bound",
+                                      unbound - m_isBound.begin()));
+        }
+        return m_db->run(*m_plan, m_params.data(), result);
+    }
+} // namespace Pig
\ No newline at end of file
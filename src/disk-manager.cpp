@@ -4,11 +4,13 @@
 
 #include "core.h"
 #include "disk-manager.h"
+#include "metrics.h"
 #include "util.h"
 #include <atomic>
 #include <cstring>
 #include <mutex>
 #include <new>
+#include <thread>
 
 namespace Pig {
 
@@ -18,25 +20,98 @@ namespace Pig {
             memset(m_buffers.get(), 0, MAX_TABLES * sizeof(OwningIovec));
         }
 
-        IoId_t DiskManager::registerFile(uint64_t initalSizeBytes) {
-            IoId_t id           = m_size.fetch_add(1);
+        IoId_t DiskManager::registerFile(uint64_t    initalSizeBytes,
+                                         page_size_t pageSize) {
+            PIG_ASSERT(isValidPageSize(pageSize),
+                       fmt::format("Unsupported page size {}", pageSize));
+            PIG_ASSERT(initalSizeBytes % pageSize == 0,
+                       "File size is not a multiple of page size");
+
+            std::lock_guard lk{m_lock};
+            IoId_t          id = m_size.load(std::memory_order_relaxed);
+            PIG_ASSERT(id < MAX_TABLES, "Too many files registered");
             m_buffers.get()[id] = OwningIovec(initalSizeBytes);
+            m_pageSizes[id]     = pageSize;
+            // Publish only after the file is fully set up.
+            m_size.store(id + 1, std::memory_order_release);
 
             return id;
         }
 
+        page_size_t DiskManager::getPageSize(IoId_t id) const {
+            PIG_ASSERT(id < m_size.load(std::memory_order_acquire),
+                       "Bad id for page size");
+            return m_pageSizes[id];
+        }
+
         Error DiskManager::read(IoId_t id, uint64_t offset,
                                 iovec buffer) const {
+            if (m_readLatency.count() != 0) {
+                std::this_thread::sleep_for(m_readLatency);
+            }
+            return readNow(id, offset, buffer);
+        }
+
+        void DiskManager::ReadAwaiter::await_suspend(
+            std::coroutine_handle<> waiter) {
+            EventLoop *loop = EventLoop::current();
+            PIG_ASSERT(loop != nullptr, "Async read outside an event loop");
+            m_due      = EventLoop::Clock::now() + m_diskManager->m_readLatency;
+            m_complete = &ReadAwaiter::complete;
+            m_waiter   = waiter;
+            loop->submit(*this);
+        }
+
+        void
+        DiskManager::ReadAwaiter::complete(EventLoop::IoRequest &request) {
+            auto &read    = static_cast<ReadAwaiter &>(request);
+            read.m_result = read.m_diskManager->readNow(
+                read.m_id, read.m_offset, read.m_buffer);
+        }
+
+        Error DiskManager::readNow(IoId_t id, uint64_t offset,
+                                   iovec buffer) const {
             PIG_ASSERT(id < m_size.load(std::memory_order_acquire),
                        "Bad id for read");
+            PIG_ASSERT(offset % m_pageSizes[id] == 0 &&
+                           buffer.iov_len % m_pageSizes[id] == 0,
+                       "Read is not page aligned");
+            Metrics::global().add(Counter::DISK_READS);
+            Metrics::global().add(Counter::DISK_READ_BYTES, buffer.iov_len);
             return m_buffers.get()[id].read(offset, buffer);
         }
 
         Error DiskManager::write(IoId_t id, uint64_t offset, iovec buffer) {
             PIG_ASSERT(id < m_size.load(std::memory_order_acquire),
                        "Bad id for write");
+            PIG_ASSERT(offset % m_pageSizes[id] == 0 &&
+                           buffer.iov_len % m_pageSizes[id] == 0,
+                       "Write is not page aligned");
+            Metrics::global().add(Counter::DISK_WRITES);
+            Metrics::global().add(Counter::DISK_WRITE_BYTES, buffer.iov_len);
             return m_buffers.get()[id].write(offset, buffer);
         }
+
+        Error DiskManager::write(IoId_t id, uint64_t offset,
+                                 const iovec *buffers, size_t count) {
+            PIG_ASSERT(id < m_size.load(std::memory_order_acquire),
+                       "Bad id for write");
+            PIG_ASSERT(offset % m_pageSizes[id] == 0, "Write is not aligned");
+            uint64_t bytes = 0;
+            for (size_t i = 0; i < count; ++i) {
+                PIG_ASSERT(buffers[i].iov_len % m_pageSizes[id] == 0,
+                           "Write is not page aligned");
+                if (auto err = m_buffers.get()[id].write(offset + bytes,
+                                                         buffers[i]);
+                    err) {
+                    return err;
+                }
+                bytes += buffers[i].iov_len;
+            }
+            Metrics::global().add(Counter::DISK_WRITES);
+            Metrics::global().add(Counter::DISK_WRITE_BYTES, bytes);
+            return EMPRY_ERR;
+        }
     } // namespace Core
 
 } // namespace Pig
\ No newline at end of file
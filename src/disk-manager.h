@@ -3,9 +3,12 @@
 
 #include "core.h"
 #include "error.h"
+#include "event_loop.h"
 #include "util.h"
 #include <array>
 #include <atomic>
+#include <chrono>
+#include <coroutine>
 #include <cstdint>
 #include <mutex>
 #include <sys/uio.h>
@@ -23,7 +26,9 @@ namespace Pig {
         It does not understand the contents of any page.
 
         Currently it is implemented as in memory buffer, in future
-        we can have one DiskManager per disk device.
+        we can have one DiskManager per disk device. A read latency can be
+        set to model a device, blocking reads sleep for it while async ones
+        leave the thread to other tasks.
          */
         class DiskManager {
           public:
@@ -38,19 +43,88 @@ namespace Pig {
 
                 The registered id never changes for an entity and hence is part
                of the name.
+
+                The page size is fixed for the lifetime of the file and all IO
+                on it must be in multiples of it.
              */
-            IoId_t registerFile(uint64_t initalSizeBytes);
+            IoId_t registerFile(uint64_t    initalSizeBytes,
+                                page_size_t pageSize = PAGE_SIZE_B);
+
+            page_size_t getPageSize(IoId_t id) const;
 
             [[nodiscard]] Error read(IoId_t id, uint64_t offset,
                                      iovec buffer) const;
 
+            // Awaitable read, see readAsync.
+            class [[nodiscard]] ReadAwaiter : private EventLoop::IoRequest {
+              public:
+                // Reads at once if there is no latency to wait for.
+                bool await_ready() {
+                    if (m_diskManager->m_readLatency.count() != 0) {
+                        return false;
+                    }
+                    m_result = m_diskManager->readNow(m_id, m_offset, m_buffer);
+                    return true;
+                }
+
+                void await_suspend(std::coroutine_handle<> waiter);
+
+                Error await_resume() const noexcept { return m_result; }
+
+              private:
+                friend class DiskManager;
+
+                ReadAwaiter(const DiskManager *diskManager, IoId_t id,
+                            uint64_t offset, iovec buffer)
+                    : m_diskManager{diskManager}, m_id{id}, m_offset{offset},
+                      m_buffer{buffer} {}
+
+                static void complete(EventLoop::IoRequest &request);
+
+                const DiskManager *m_diskManager;
+                IoId_t             m_id;
+                uint64_t           m_offset;
+                iovec              m_buffer;
+                Error              m_result;
+            };
+
+            /**
+                Read for a task on an EventLoop, co_await returns the Error.
+                The task is suspended till the read latency passed and the
+                buffer is filled on completion, as a device would.
+             */
+            ReadAwaiter readAsync(IoId_t id, uint64_t offset,
+                                  iovec buffer) const {
+                return ReadAwaiter(this, id, offset, buffer);
+            }
+
+            /**
+                Time every read takes from now on, 0 by default. Must be set
+                while no IO runs.
+             */
+            void setReadLatency(std::chrono::nanoseconds latency) noexcept {
+                m_readLatency = latency;
+            }
+
             [[nodiscard]] Error write(IoId_t id, uint64_t offset, iovec buffer);
 
+            /**
+                Writes count buffers back to back from offset as one IO,
+                like pwritev.
+             */
+            [[nodiscard]] Error write(IoId_t id, uint64_t offset,
+                                      const iovec *buffers, size_t count);
+
           private:
+            // Read without the latency.
+            Error readNow(IoId_t id, uint64_t offset, iovec buffer) const;
+
             std::mutex m_lock;
             // OwningIovec         *m_buffers;
-            std::unique_ptr<OwningIovec[]> m_buffers;
-            std::atomic_uint16_t           m_size{0};
+            std::unique_ptr<OwningIovec[]>      m_buffers;
+            std::array<page_size_t, MAX_TABLES> m_pageSizes{};
+            std::atomic_uint16_t                m_size{0};
+            std::chrono::nanoseconds            m_readLatency{0};
         };
     } // namespace Core
 } // namespace Pig
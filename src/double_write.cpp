@@ -0,0 +1,82 @@
+#include "double_write.h"
+#include "checksum.h"
+#include "util.h"
+#include <cstring>
+#include <mutex>
+#include <utility>
+
+namespace Pig {
+    namespace Core {
+
+        DoubleWriteBuffer::DoubleWriteBuffer(
+            std::shared_ptr<DiskManager> diskManager, page_size_t pageSize,
+            uint32_t numSlots)
+            : m_diskManager{std::move(diskManager)}, k_pageSize{pageSize},
+              k_numSlots{numSlots},
+              m_directory{std::make_unique<unsigned char[]>(pageSize)} {
+            PIG_ASSERT(numSlots > 0 &&
+                           DIRECTORY_HEADER_BYTES +
+                                   numSlots * sizeof(uint32_t) <=
+                               pageSize,
+                       "Double write slots do not fit the directory");
+            m_id = m_diskManager->registerFile(
+                (static_cast<uint64_t>(numSlots) + 1) * pageSize, pageSize);
+        }
+
+        Error DoubleWriteBuffer::stage(const PageWrite *pages, size_t count) {
+            memset(m_directory.get(), 0, k_pageSize);
+            auto entries = reinterpret_cast<uint32_t *>(m_directory.get());
+            entries[1]   = static_cast<uint32_t>(count);
+
+            std::vector<iovec> buffers(count + 1);
+            buffers[0].iov_base = m_directory.get();
+            buffers[0].iov_len  = k_pageSize;
+            for (size_t i = 0; i < count; ++i) {
+                entries[2 + i] = static_cast<uint32_t>(pages[i].m_ioId) << 16 |
+                                 pages[i].m_pageId;
+                buffers[i + 1] = pages[i].m_page;
+            }
+            setPageChecksum(buffers[0], 0);
+            return m_diskManager->write(m_id, 0, buffers.data(),
+                                        buffers.size());
+        }
+
+        Error DoubleWriteBuffer::readDirectory(std::vector<uint32_t> &entries) {
+            iovec buf;
+            buf.iov_base = m_directory.get();
+            buf.iov_len  = k_pageSize;
+            if (auto err = m_diskManager->read(m_id, 0, buf); err) {
+                return err;
+            }
+            entries.clear();
+            if (!verifyPageChecksum(buf, 0)) {
+                return EMPRY_ERR;
+            }
+            auto     words = reinterpret_cast<const uint32_t *>(buf.iov_base);
+            uint32_t count = std::min(words[1], k_numSlots);
+            entries.assign(words + 2, words + 2 + count);
+            return EMPRY_ERR;
+        }
+
+        Error DoubleWriteBuffer::readCopy(uint32_t slot, iovec page) {
+            return m_diskManager->read(
+                m_id, (static_cast<uint64_t>(slot) + 1) * k_pageSize, page);
+        }
+
+        Error DoubleWriteBuffer::find(IoId_t io_id, page_id_t page_id,
+                                      iovec page) {
+            std::lock_guard       lock(m_mutex);
+            std::vector<uint32_t> entries;
+            if (auto err = readDirectory(entries); err) {
+                return err;
+            }
+            uint32_t wanted = static_cast<uint32_t>(io_id) << 16 | page_id;
+            for (uint32_t slot = 0; slot < entries.size(); ++slot) {
+                if (entries[slot] == wanted) {
+                    return readCopy(slot, page);
+                }
+            }
+            return MKERROR(ERR_NOT_FOUND, "Page is not in double write area");
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
@@ -0,0 +1,133 @@
+#ifndef PIG_CORE_DOUBLE_WRITE_H
+#define PIG_CORE_DOUBLE_WRITE_H
+
+#include "core.h"
+#include "disk-manager.h"
+#include "error.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sys/uio.h>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Double write area, a file of its own where pages are written before
+        they are written in place.
+
+        A crash in the middle of a page write can leave the page torn, half
+        old and half new, which its checksum catches but can not fix. With
+        the area, the page either was torn in the area, and the in place
+        write never started, or the copy in the area is whole and can be
+        written in place again. This avoids logging full page images.
+
+        Pages go through the area in batches of upto numSlots pages, the
+        copies and a directory page listing them in one vectored write, so
+        a batch costs one extra IO. Page 0 of the area is the directory,
+        {checksum, count, (io id << 16 | page id) per slot}, and the copies
+        follow in order.
+         */
+        class DoubleWriteBuffer {
+          public:
+            struct PageWrite {
+                IoId_t    m_ioId;
+                page_id_t m_pageId;
+                iovec     m_page;
+            };
+
+            DoubleWriteBuffer(std::shared_ptr<DiskManager> diskManager,
+                              page_size_t pageSize, uint32_t numSlots);
+
+            uint32_t getNumSlots() const noexcept { return k_numSlots; }
+
+            /**
+                Writes pages through the area in batches, calling
+                writeInPlace(const PageWrite *, size_t) for each batch once
+                it is in the area. Batches are written one at a time, the
+                area is reused once a batch is in place.
+             */
+            template <typename WriteInPlace>
+            Error write(const PageWrite *pages, size_t count,
+                        WriteInPlace &&writeInPlace) {
+                std::lock_guard lock(m_mutex);
+                for (size_t done = 0; done < count;) {
+                    size_t batch =
+                        std::min<size_t>(k_numSlots, count - done);
+                    if (auto err = stage(pages + done, batch); err) {
+                        return err;
+                    }
+                    if (auto err = writeInPlace(pages + done, batch); err) {
+                        return err;
+                    }
+                    done += batch;
+                }
+                return EMPRY_ERR;
+            }
+
+            /**
+                Reads the copy of the page from the last batch into page,
+                ERR_NOT_FOUND if it was not in it. The copy may itself be
+                torn, the caller verifies it.
+             */
+            [[nodiscard]] Error find(IoId_t io_id, page_id_t page_id,
+                                     iovec page);
+
+            /**
+                Calls visitor(IoId_t, page_id_t, iovec) with every copy of
+                the last batch, for recovery at startup.
+             */
+            template <typename Visitor> Error forEach(Visitor &&visitor) {
+                std::lock_guard lock(m_mutex);
+                std::vector<uint32_t> entries;
+                if (auto err = readDirectory(entries); err) {
+                    return err;
+                }
+                auto  copy = std::make_unique<unsigned char[]>(k_pageSize);
+                iovec buf;
+                buf.iov_base = copy.get();
+                buf.iov_len  = k_pageSize;
+                for (uint32_t slot = 0; slot < entries.size(); ++slot) {
+                    if (auto err = readCopy(slot, buf); err) {
+                        return err;
+                    }
+                    if (auto err = visitor(
+                            static_cast<IoId_t>(entries[slot] >> 16),
+                            static_cast<page_id_t>(entries[slot]), buf);
+                        err) {
+                        return err;
+                    }
+                }
+                return EMPRY_ERR;
+            }
+
+          private:
+            // Directory is {checksum, count, entries...}.
+            static constexpr size_t DIRECTORY_HEADER_BYTES =
+                2 * sizeof(uint32_t);
+
+            // Must hold m_mutex.
+            [[nodiscard]] Error stage(const PageWrite *pages, size_t count);
+
+            // Must hold m_mutex. No entries if the directory is torn, then
+            // no batch was being written in place.
+            [[nodiscard]] Error readDirectory(std::vector<uint32_t> &entries);
+
+            // Must hold m_mutex.
+            [[nodiscard]] Error readCopy(uint32_t slot, iovec page);
+
+            std::shared_ptr<DiskManager> m_diskManager;
+            const page_size_t            k_pageSize;
+            const uint32_t               k_numSlots;
+            IoId_t                       m_id;
+
+            std::mutex                       m_mutex;
+            std::unique_ptr<unsigned char[]> m_directory;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -1,52 +1,66 @@
 #ifndef PIGDB_CORE_ERROR_H
 #define PIGDB_CORE_ERROR_H
 
-#include <exception>
-#include <sstream>
-#include <string>
+#include <cstdint>
+#include <type_traits>
 
 namespace Pig {
     namespace Core {
 
-// Quick error creation.
-#define MKERROR(errCode, msg) Error((errCode), (msg))
+#define PIG_STRINGIFY_(x) #x
+#define PIG_STRINGIFY(x)  PIG_STRINGIFY_(x)
 
-// More verbose (and slightly slower)
+// Quick error creation, msg must be a string literal.
+#define MKERROR(errCode, msg) Error((errCode), "" msg)
+
+// Appends the call site to the message, at compile time.
 #define MKERRORSITE(errCode, msg)                                              \
-    Error((errCode), (msg), __FILE__, __LINE__, __func__)
+    Error((errCode), "" msg " | Location: " __FILE__                           \
+                     ":" PIG_STRINGIFY(__LINE__))
 
 #define EMPRY_ERR Error();
 
         using ErrCode = int16_t;
 
-        struct Error : private std::exception {
-            Error() : m_code{0} {}
+        // 0 is reserved for no error.
+        constexpr ErrCode ERR_NOT_FOUND      = 1;
+        constexpr ErrCode ERR_ALREADY_EXISTS = 2;
+        constexpr ErrCode ERR_INVALID_ARG    = 3;
+        constexpr ErrCode ERR_NO_FREE_FRAME  = 4;
+        constexpr ErrCode ERR_CORRUPTED      = 5;
 
-            Error(ErrCode code, const std::string &message)
-                : m_code{code}, m_message{message} {}
+        /**
+            Code and a message with static storage, so that it is returned
+            in registers and neither success nor failure allocates. Details
+            only known at runtime, e.g the page that failed its checksum, are
+            logged where the error is raised.
+         */
+        class Error {
+          public:
+            constexpr Error() noexcept = default;
 
-            Error(ErrCode code, const std::string &message, const char *file,
-                  int line, const char *func)
-                : m_code{code} {
-                std::ostringstream oss;
-                oss << "Error: " << message << " | Code: " << code
-                    << " | Location: " << file << ":" << line << " in " << func;
-                m_message = oss.str();
-            }
+            constexpr Error(ErrCode code, const char *message) noexcept
+                : m_message{message}, m_code{code} {}
 
-            ErrCode code() const noexcept { return m_code; }
+            constexpr ErrCode code() const noexcept { return m_code; }
 
-            explicit operator bool() const noexcept { return m_code != 0; }
+            constexpr explicit operator bool() const noexcept {
+                return m_code != 0;
+            }
 
-            const char *what() const noexcept override {
-                return m_message.c_str();
+            const char *what() const noexcept {
+                return m_message != nullptr ? m_message : "";
             }
 
           private:
-            const ErrCode m_code;
-            std::string   m_message;
+            const char *m_message = nullptr;
+            ErrCode     m_code    = 0;
         };
 
+        static_assert(std::is_trivially_copyable_v<Error> &&
+                          sizeof(Error) <= 2 * sizeof(void *),
+                      "Error must be returned in registers");
+
     } // namespace Core
 } // namespace Pig
 
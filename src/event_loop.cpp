@@ -0,0 +1,114 @@
+#include "event_loop.h"
+#include "util.h"
+#include <thread>
+#include <utility>
+
+namespace Pig {
+    namespace Core {
+
+        namespace {
+            thread_local EventLoop *t_current = nullptr;
+        } // namespace
+
+        // Top level coroutine of a spawned task, its frame is freed when it
+        // finishes.
+        struct EventLoop::Detached {
+            struct promise_type {
+                Detached get_return_object() noexcept {
+                    return Detached{
+                        std::coroutine_handle<promise_type>::from_promise(
+                            *this)};
+                }
+
+                std::suspend_always initial_suspend() const noexcept {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() const noexcept {
+                    return {};
+                }
+
+                void return_void() const noexcept {}
+
+                // drive catches everything.
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+
+            std::coroutine_handle<> m_handle;
+        };
+
+        EventLoop::~EventLoop() {
+            PIG_ASSERT(m_numTasks == 0, "Event loop destroyed with tasks");
+        }
+
+        EventLoop *EventLoop::current() noexcept { return t_current; }
+
+        EventLoop::Detached EventLoop::drive(EventLoop &loop,
+                                             Task<void> task) {
+            try {
+                co_await std::move(task);
+            } catch (...) {
+                if (!loop.m_error) {
+                    loop.m_error = std::current_exception();
+                }
+            }
+            --loop.m_numTasks;
+        }
+
+        void EventLoop::spawn(Task<void> task) {
+            ++m_numTasks;
+            m_ready.push_back(drive(*this, std::move(task)).m_handle);
+        }
+
+        void EventLoop::submit(IoRequest &request) {
+            PIG_ASSERT(t_current == this, "IO submitted outside its loop");
+            m_inFlight.push(&request);
+        }
+
+        void EventLoop::run() {
+            EventLoop *previous = t_current;
+            t_current           = this;
+            while (m_numTasks > 0) {
+                // Only the tasks ready now, a task that yields runs again
+                // after the IO that is due.
+                for (size_t n = m_ready.size(); n > 0; --n) {
+                    auto task = m_ready.front();
+                    m_ready.pop_front();
+                    task.resume();
+                }
+                if (m_numTasks > 0) {
+                    PIG_ASSERT(!m_ready.empty() || !m_inFlight.empty(),
+                               "Tasks wait for nothing in flight");
+                    complete(m_ready.empty());
+                }
+            }
+            t_current = previous;
+            if (m_error) {
+                std::rethrow_exception(std::exchange(m_error, nullptr));
+            }
+        }
+
+        void EventLoop::Yield::await_suspend(
+            std::coroutine_handle<> waiter) const {
+            PIG_ASSERT(t_current != nullptr, "Yield outside of a loop");
+            t_current->m_ready.push_back(waiter);
+        }
+
+        void EventLoop::complete(bool wait) {
+            if (m_inFlight.empty()) {
+                return;
+            }
+            auto now = Clock::now();
+            if (wait && m_inFlight.top()->m_due > now) {
+                std::this_thread::sleep_until(m_inFlight.top()->m_due);
+                now = Clock::now();
+            }
+            while (!m_inFlight.empty() && m_inFlight.top()->m_due <= now) {
+                IoRequest *request = m_inFlight.top();
+                m_inFlight.pop();
+                request->m_complete(*request);
+                m_ready.push_back(request->m_waiter);
+            }
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
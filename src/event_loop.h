@@ -0,0 +1,113 @@
+#ifndef PIG_CORE_EVENT_LOOP_H
+#define PIG_CORE_EVENT_LOOP_H
+
+#include "task.h"
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <queue>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Runs the tasks of one thread, e.g one per core, and completes the
+        IO they wait on.
+
+        A task that waits for a read is suspended and the thread runs the
+        others meanwhile, so a thread keeps many page fetches in flight
+        where a blocking read would need a thread each. IO is submitted by
+        backends, see DiskManager::readAsync, and completed by the loop
+        when due. When every task waits, the loop sleeps till the first
+        read is due.
+
+        Not thread safe, tasks are spawned and run by the thread owning the
+        loop.
+         */
+        class EventLoop {
+          public:
+            using Clock = std::chrono::steady_clock;
+
+            // An IO in flight, owned by the awaiter of the suspended task.
+            struct IoRequest {
+                Clock::time_point m_due;
+                // Called by the loop when due, before m_waiter resumes.
+                void (*m_complete)(IoRequest &) = nullptr;
+                std::coroutine_handle<> m_waiter;
+            };
+
+            EventLoop() = default;
+
+            EventLoop(const EventLoop &)            = delete;
+            EventLoop &operator=(const EventLoop &) = delete;
+
+            // Every spawned task must have finished.
+            ~EventLoop();
+
+            /**
+                Queues task to start on the next run, the loop owns it till
+                it finishes.
+             */
+            void spawn(Task<void> task);
+
+            /**
+                Runs till every spawned task finished. The first exception
+                escaping a task is rethrown here after the others finished.
+             */
+            void run();
+
+            /**
+                Called by backends from a task of the loop, request completes
+                once due.
+             */
+            void submit(IoRequest &request);
+
+            size_t getNumInFlight() const noexcept { return m_inFlight.size(); }
+
+            // Awaitable that lets the other tasks of the loop run first.
+            struct Yield {
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> waiter) const;
+                void await_resume() const noexcept {}
+            };
+
+            /**
+                For a task waiting on another thread, e.g for a page it
+                loads. The task is resumed after the tasks ready now and the
+                IO that is due, without sleeping.
+             */
+            static Yield yield() noexcept { return {}; }
+
+            // The loop running on this thread, null outside run.
+            static EventLoop *current() noexcept;
+
+          private:
+            struct Detached;
+
+            static Detached drive(EventLoop &loop, Task<void> task);
+
+            // Moves the requests that are due to ready, if wait sleeping
+            // till the first is if none is.
+            void complete(bool wait);
+
+            struct DueLater {
+                bool operator()(const IoRequest *a,
+                                const IoRequest *b) const noexcept {
+                    return a->m_due > b->m_due;
+                }
+            };
+
+            std::deque<std::coroutine_handle<>> m_ready;
+            std::priority_queue<IoRequest *, std::vector<IoRequest *>,
+                                DueLater>
+                               m_inFlight;
+            size_t             m_numTasks = 0;
+            std::exception_ptr m_error;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -1,75 +1,133 @@
 #include "heap.h"
+#include "checksum.h"
 #include "core.h"
 #include "error.h"
+#include "metrics.h"
+#include "transaction.h"
 #include "util.h"
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <optional>
+#include <vector>
 
 #include <fmt/core.h>
 #include <fmt/format.h>
 #include <shared_mutex>
+#include <spdlog/spdlog.h>
 #include <sys/uio.h>
 
 namespace Pig {
     namespace Core {
 
-        HeapFile::HeapFile(std::shared_ptr<DiskManager> diskManager)
-            : m_diskManager{std::move(diskManager)} {
+        HeapFile::HeapFile(std::shared_ptr<DiskManager> diskManager,
+                           std::shared_ptr<BufferPool>  bufferPool,
+                           page_size_t pageSize, page_id_t numPages,
+                           ChecksumType checksum, uint16_t zoneMapColumns)
+            : m_diskManager{std::move(diskManager)},
+              m_bufferPool{std::move(bufferPool)},
+              k_zoneMapColumns{zoneMapColumns} {
+            PIG_ASSERT(m_bufferPool->getPageSize() == pageSize,
+                       "Buffer pool frames do not match heap page size");
+            PIG_ASSERT(numPages <= MAX_PAGES, "Too many pages for heap file");
+            m_header.m_pageSize = pageSize;
+            m_header.m_numPages = numPages;
+            m_header.m_checksum = checksum;
+
+            size_t numZoneMaps = static_cast<size_t>(numPages) *
+                                 zoneMapColumns;
+            m_zoneMaps = std::make_unique<ZoneMap[]>(numZoneMaps);
+            std::fill_n(m_zoneMaps.get(), numZoneMaps,
+                        ZoneMap{INT32_MAX, INT32_MIN});
+
             // Use diskManager to intialize new file
-            m_id = m_diskManager->registerFile(MAX_PAGES * PAGE_SIZE_KB +
-                                               4 /* header + 3 spacemap */ *
-                                                   PAGE_SIZE_KB);
+            m_id = m_diskManager->registerFile(
+                (static_cast<uint64_t>(numPages) + RESERVED_PAGES) * pageSize,
+                pageSize);
+            m_bufferPool->enablePageChecksums(m_id, Page::CHECKSUM_OFFSET,
+                                              pageChecksumType());
 
-            // CREATE PAGES in put to disk, TODO: initialize header
-            size_t offset = PAGE_SIZE_B;
-            for (uint32_t i = 0; i < MAX_PAGES; ++i) {
-                auto page = Page(i);
+            iovec buf;
+            auto  buffer = std::make_unique<unsigned char[]>(pageSize);
+            buf.iov_base = buffer.get();
+            buf.iov_len  = pageSize;
 
-                iovec buf;
-                auto  buffer = std::make_unique<unsigned char[]>(PAGE_SIZE_B);
+            memcpy(buffer.get(), &m_header, sizeof(m_header));
+            setPageChecksum(buf, Page::CHECKSUM_OFFSET, pageChecksumType());
+            auto err = m_diskManager->write(m_id, 0, buf);
+            PIG_ASSERT(!err, "Header write failed");
 
-                buf.iov_base = buffer.get();
-                buf.iov_len  = PAGE_SIZE_B;
+            // CREATE PAGES in put to disk
+            uint64_t offset = static_cast<uint64_t>(RESERVED_PAGES) * pageSize;
+            for (uint32_t i = 0; i < numPages; ++i) {
+                auto page = Page(i, pageSize);
 
                 auto err = m_diskManager->read(m_id, offset, buf);
                 PIG_ASSERT(!err, "Page read failed");
                 page.initPage(buf);
+                setPageChecksum(buf, Page::CHECKSUM_OFFSET,
+                                pageChecksumType());
                 auto err2 = m_diskManager->write(m_id, offset, buf);
                 PIG_ASSERT(!err2, "Page write failed");
 
-                offset += PAGE_SIZE_B;
+                offset += pageSize;
 
-                m_freeSpaceMap.push(Page::FREE_BYTES << 16 | i);
+                uint32_t entry = Page::freeBytesFor(pageSize) << 16 | i;
+                m_freeSpaceEntries.push_back(entry);
+                m_freeSpaceMap.push(entry);
             }
         }
 
         std::unique_ptr<HeapFile>
-        HeapFile::create(std::shared_ptr<DiskManager> diskManager) {
-            return std::unique_ptr<HeapFile>(
-                new HeapFile(std::move(diskManager)));
+        HeapFile::create(std::shared_ptr<DiskManager> diskManager,
+                         std::shared_ptr<BufferPool>  bufferPool,
+                         page_size_t pageSize, page_id_t numPages,
+                         ChecksumType checksum, uint16_t zoneMapColumns) {
+            return std::unique_ptr<HeapFile>(new HeapFile(
+                std::move(diskManager), std::move(bufferPool), pageSize,
+                numPages, checksum, zoneMapColumns));
         }
 
         HeapFile::Page *HeapFile::getPage(page_id_t pageId) const noexcept {
-            PIG_ASSERT(pageId < MAX_PAGES,
+            PIG_ASSERT(pageId < m_header.m_numPages,
                        fmt::format("Invalid PageId {} requested", pageId));
             // TODO delegate to buffer pool
             return nullptr;
         }
 
         Error HeapFile::addTuple(iovec tuple, TupleId &assignedTupleId) {
-            auto checksum          = calculateChecksum(tuple);
-            auto t                 = Tuple(checksum, tuple);
+            return insert(tuple, FROZEN_TXN_ID, assignedTupleId);
+        }
+
+        Error HeapFile::addTuple(WriteTransaction &txn, iovec tuple,
+                                 TupleId &assignedTupleId) {
+            PIG_ASSERT(txn.isActive(), "Transaction is not active");
+            if (auto err = insert(tuple, txn.getId(), assignedTupleId); err) {
+                return err;
+            }
+            txn.onInsert(*this, assignedTupleId);
+            return EMPRY_ERR;
+        }
+
+        Error HeapFile::insert(iovec tuple, txn_id_t xmin,
+                               TupleId &assignedTupleId) {
+            ScopedLatency latency(Histogram::HEAP_INSERT_LATENCY,
+                                  INSERT_LATENCY_SAMPLE_EVERY);
+            Metrics::global().add(Counter::HEAP_INSERTS);
+
+            auto checksum          = calculateChecksum(tuple,
+                                                       m_header.m_checksum);
+            auto t                 = Tuple(checksum, tuple, xmin);
             auto spaceNeededInPage = Page::spaceForTuple(t);
 
             // Locate a page for it from space map.
-            std::shared_lock lock(m_freeSpaceLock);
-            const uint32_t  &top = m_freeSpaceMap.top();
-            PIG_ASSERT((top >> 16) > spaceNeededInPage,
+            std::unique_lock lock(m_freeSpaceLock);
+            const uint32_t   top = takePageFor(spaceNeededInPage);
+            PIG_ASSERT((top >> 16) >= spaceNeededInPage,
                        fmt::format("No space available in heap file for tuple "
                                    "of size {}, top space: {}",
                                    spaceNeededInPage, (top >> 16)));
-            m_freeSpaceMap.pop();
             lock.unlock();
             // At this point, the page is not in freespacemap, so it can not
             // be updated concurrently for other INSERTs
@@ -85,29 +143,528 @@ namespace Pig {
             6. Add back to freeSpaceMap
             7. Return pageId, tupleId
             */
-            PageSlot slot;
-            auto     page_id = top & 0xFFFF;
+            PageSlot    slot;
+            page_size_t freeBytes;
+            auto        page_id = top & 0xFFFF;
             {
-                auto pageGuard = m_bufferPool->GetPage(m_id, page_id);
+                BufferPool::BufferPoolPageGuard pageGuard;
+                if (auto err = m_bufferPool->getPage(
+                        m_id, toFilePageId(page_id), LatchMode::EXCLUSIVE,
+                        pageGuard);
+                    err) {
+                    lock.lock();
+                    putPage(page_id, top >> 16);
+                    return err;
+                }
 
                 iovec pageBuf = pageGuard.getRawPage();
 
                 auto heapPage = HeapFile::Page(page_id, pageBuf);
 
+                widenZoneMaps(page_id, tuple);
                 slot = heapPage.addTuple(t);
+                // Less than spaceNeededInPage is used if a slot is reused.
+                freeBytes = heapPage.getFreeBytes();
 
                 pageGuard.markDirty();
             }
 
-            uint32_t newEntry =
-                ((top >> 16) - spaceNeededInPage) << 16 | page_id;
-
-            m_freeSpaceMap.push(newEntry);
+            lock.lock();
+            putPage(page_id, freeBytes);
+            lock.unlock();
 
             assignedTupleId.first  = page_id;
             assignedTupleId.second = slot;
             return EMPRY_ERR;
         }
 
+        Error HeapFile::addTuples(const iovec *tuples, size_t count,
+                                  TupleId *assignedTupleIds) {
+            size_t numInserted;
+            return insertBatch(tuples, count, FROZEN_TXN_ID, assignedTupleIds,
+                               numInserted);
+        }
+
+        Error HeapFile::addTuples(WriteTransaction &txn, const iovec *tuples,
+                                  size_t count, TupleId *assignedTupleIds) {
+            PIG_ASSERT(txn.isActive(), "Transaction is not active");
+            size_t numInserted;
+            auto   err = insertBatch(tuples, count, txn.getId(),
+                                     assignedTupleIds, numInserted);
+            // Also on error, the tuples placed carry the id of txn and would
+            // show once the id is reused.
+            for (size_t i = 0; i < numInserted; ++i) {
+                txn.onInsert(*this, assignedTupleIds[i]);
+            }
+            return err;
+        }
+
+        Error HeapFile::insertBatch(const iovec *tuples, size_t count,
+                                    txn_id_t xmin, TupleId *assignedTupleIds,
+                                    size_t &numInserted) {
+            Metrics::global().add(Counter::HEAP_INSERTS, count);
+            numInserted = 0;
+
+            std::vector<uint32_t> checksums(count);
+            calculateChecksums(tuples, count, m_header.m_checksum,
+                               checksums.data());
+
+            for (size_t done = 0; done < count;) {
+                auto first = Tuple(checksums[done], tuples[done], xmin);
+
+                std::unique_lock lock(m_freeSpaceLock);
+                const uint32_t   top =
+                    takePageFor(Page::spaceForTuple(first));
+                PIG_ASSERT((top >> 16) >= Page::spaceForTuple(first),
+                           fmt::format("No space available in heap file for "
+                                       "tuple of size {}, top space: {}",
+                                       Page::spaceForTuple(first), top >> 16));
+                lock.unlock();
+
+                // Fill the page while tuples fit, it is out of the free
+                // space map meanwhile as in insert.
+                page_id_t   pageId = top & 0xFFFF;
+                page_size_t freeBytes;
+                {
+                    BufferPool::BufferPoolPageGuard pageGuard;
+                    if (auto err = m_bufferPool->getPage(
+                            m_id, toFilePageId(pageId), LatchMode::EXCLUSIVE,
+                            pageGuard);
+                        err) {
+                        lock.lock();
+                        putPage(pageId, top >> 16);
+                        numInserted = done;
+                        return err;
+                    }
+                    auto heapPage = Page(pageId, pageGuard.getRawPage());
+                    for (; done < count; ++done) {
+                        auto t = Tuple(checksums[done], tuples[done], xmin);
+                        if (!heapPage.hasSpaceFor(t)) {
+                            break;
+                        }
+                        widenZoneMaps(pageId, tuples[done]);
+                        assignedTupleIds[done] =
+                            TupleId{pageId, heapPage.addTuple(t)};
+                    }
+                    freeBytes = heapPage.getFreeBytes();
+                    pageGuard.markDirty();
+                }
+
+                lock.lock();
+                putPage(pageId, freeBytes);
+            }
+            numInserted = count;
+            return EMPRY_ERR;
+        }
+
+        Error HeapFile::verify() {
+            std::optional<TupleId> corrupted;
+            auto                   err = scanIf(
+                [this](const Tuple &t) {
+                    return calculateChecksum(t.m_payload,
+                                             m_header.m_checksum) !=
+                           t.m_checksum;
+                },
+                [&corrupted](const TupleId &tupleId, iovec) {
+                    corrupted = tupleId;
+                    return false;
+                });
+            if (err) {
+                return err;
+            }
+            if (corrupted) {
+                SPDLOG_ERROR("Checksum mismatch on tuple {}:{}",
+                             corrupted->first, corrupted->second);
+                return MKERROR(ERR_CORRUPTED, "Tuple checksum mismatch");
+            }
+            return EMPRY_ERR;
+        }
+
+        Error HeapFile::viewTuple(const TupleId &tupleId, TupleView &view) {
+            return findTuple(nullptr, tupleId, view);
+        }
+
+        Error HeapFile::viewTuple(const Snapshot &snapshot,
+                                  const TupleId &tupleId, TupleView &view) {
+            return findTuple(&snapshot, tupleId, view);
+        }
+
+        Error HeapFile::getTuple(const TupleId              &tupleId,
+                                 std::vector<unsigned char> &payload) {
+            return copyTuple(nullptr, tupleId, payload);
+        }
+
+        Error HeapFile::getTuple(const Snapshot &snapshot,
+                                 const TupleId  &tupleId,
+                                 std::vector<unsigned char> &payload) {
+            return copyTuple(&snapshot, tupleId, payload);
+        }
+
+        Error HeapFile::findTuple(const Snapshot *snapshot,
+                                  const TupleId &tupleId, TupleView &view,
+                                  std::vector<unsigned char> *copy) {
+            auto [pageId, slot] = tupleId;
+            PIG_ASSERT(pageId < m_header.m_numPages,
+                       fmt::format("Invalid PageId {} requested", pageId));
+            // Not to hold two pins if the pool is small.
+            view.release();
+
+            for (uint32_t attempt = 0;; ++attempt) {
+                LatchMode mode = attempt < OPTIMISTIC_READ_ATTEMPTS
+                                     ? LatchMode::OPTIMISTIC
+                                     : LatchMode::SHARED;
+                BufferPool::BufferPoolPageGuard pageGuard;
+                if (auto err = m_bufferPool->getPage(
+                        m_id, toFilePageId(pageId), mode, pageGuard);
+                    err) {
+                    return err;
+                }
+                auto heapPage = Page(pageId, pageGuard.getRawPage());
+
+                ErrCode code = ERR_NOT_FOUND;
+                iovec   payload;
+                if (heapPage.hasTuple(slot)) {
+                    auto t = heapPage.tryGetTuple(slot);
+                    if (!t) {
+                        // A torn or just removed slot, only possible
+                        // while reading optimistically.
+                        PIG_ASSERT(mode == LatchMode::OPTIMISTIC,
+                                   "Tuple is out of page bounds");
+                        continue;
+                    }
+                    if (snapshot == nullptr ||
+                        snapshot->isVisible(t->m_xmin, t->m_xmax)) {
+                        payload = t->m_payload;
+                        code    = 0;
+                    }
+                }
+                if (code == 0 && copy != nullptr) {
+                    // Inside the page, so safe to copy before validating.
+                    auto bytes = static_cast<unsigned char *>(payload.iov_base);
+                    copy->assign(bytes, bytes + payload.iov_len);
+                } else if (code == 0) {
+                    // Held as viewed before validating, so a writer that
+                    // latches the page after the check leaves it in place.
+                    pageGuard.unlatch();
+                }
+                if (!pageGuard.validate()) {
+                    continue;
+                }
+                if (code != 0) {
+                    return MKERROR(code, "Tuple is not visible");
+                }
+                if (copy != nullptr) {
+                    return EMPRY_ERR;
+                }
+                view.m_guard.emplace(std::move(pageGuard));
+                view.m_payload = payload;
+                return EMPRY_ERR;
+            }
+        }
+
+        Error HeapFile::copyTuple(const Snapshot *snapshot,
+                                  const TupleId  &tupleId,
+                                  std::vector<unsigned char> &payload) {
+            TupleView view;
+            return findTuple(snapshot, tupleId, view, &payload);
+        }
+
+        Error HeapFile::deleteTuple(WriteTransaction &txn,
+                                    const TupleId    &tupleId) {
+            PIG_ASSERT(txn.isActive(), "Transaction is not active");
+            auto [pageId, slot] = tupleId;
+            PIG_ASSERT(pageId < m_header.m_numPages,
+                       fmt::format("Invalid PageId {} requested", pageId));
+
+            {
+                BufferPool::BufferPoolPageGuard pageGuard;
+                if (auto err = m_bufferPool->getPage(
+                        m_id, toFilePageId(pageId), LatchMode::EXCLUSIVE,
+                        pageGuard);
+                    err) {
+                    return err;
+                }
+                auto heapPage = Page(pageId, pageGuard.getRawPage());
+                if (!heapPage.hasTuple(slot)) {
+                    return MKERROR(ERR_NOT_FOUND, "Tuple does not exist");
+                }
+                Tuple t = heapPage.getTuple(slot);
+                if (!txn.getSnapshot().isVisible(t.m_xmin, t.m_xmax)) {
+                    return MKERROR(ERR_NOT_FOUND, "Tuple is not visible");
+                }
+                heapPage.setXmax(slot, txn.getId());
+                pageGuard.markDirty();
+            }
+            txn.onDelete(*this, tupleId);
+            return EMPRY_ERR;
+        }
+
+        Error HeapFile::deleteTuple(const TupleId &tupleId) {
+            auto [pageId, slot] = tupleId;
+            PIG_ASSERT(pageId < m_header.m_numPages,
+                       fmt::format("Invalid PageId {} requested", pageId));
+
+            BufferPool::BufferPoolPageGuard pageGuard;
+            if (auto err = m_bufferPool->getPage(m_id, toFilePageId(pageId),
+                                                 LatchMode::EXCLUSIVE,
+                                                 pageGuard);
+                err) {
+                return err;
+            }
+            auto heapPage = Page(pageId, pageGuard.getRawPage());
+            if (!heapPage.hasTuple(slot)) {
+                return MKERROR(ERR_NOT_FOUND, "Tuple does not exist");
+            }
+            heapPage.removeTuple(slot);
+            Metrics::global().add(Counter::HEAP_DELETES);
+            compactPage(pageGuard, heapPage);
+            pageGuard.markDirty();
+            return EMPRY_ERR;
+        }
+
+        Error HeapFile::vacuum(txn_id_t horizon, size_t &removed) {
+            auto isDead = [horizon](const Tuple &t) {
+                return t.m_xmin == INVALID_TXN_ID ||
+                       (t.m_xmax != INVALID_TXN_ID && t.m_xmax <= horizon);
+            };
+            auto hasDead = [&isDead](const Page &heapPage) {
+                for (PageSlot slot = 0; slot < heapPage.getNumSlots();
+                     ++slot) {
+                    if (heapPage.hasTuple(slot) &&
+                        isDead(heapPage.getTuple(slot))) {
+                        return true;
+                    }
+                }
+                return false;
+            };
+
+            removed = 0;
+            for (page_id_t pageId = 0; pageId < m_header.m_numPages;
+                 ++pageId) {
+                BufferPool::BufferPoolPageGuard pageGuard;
+                // Most pages have nothing to remove, so look first without
+                // holding up readers.
+                if (auto err = m_bufferPool->getPage(
+                        m_id, toFilePageId(pageId), LatchMode::SHARED,
+                        pageGuard);
+                    err) {
+                    Metrics::global().add(Counter::HEAP_DELETES, removed);
+                    return err;
+                }
+                if (!hasDead(Page(pageId, pageGuard.getRawPage()))) {
+                    continue;
+                }
+                pageGuard.release();
+                if (auto err = m_bufferPool->getPage(
+                        m_id, toFilePageId(pageId), LatchMode::EXCLUSIVE,
+                        pageGuard);
+                    err) {
+                    Metrics::global().add(Counter::HEAP_DELETES, removed);
+                    return err;
+                }
+                auto heapPage = Page(pageId, pageGuard.getRawPage());
+                for (PageSlot slot = 0; slot < heapPage.getNumSlots();
+                     ++slot) {
+                    if (heapPage.hasTuple(slot) &&
+                        isDead(heapPage.getTuple(slot))) {
+                        heapPage.removeTuple(slot);
+                        ++removed;
+                    }
+                }
+                compactPage(pageGuard, heapPage);
+                pageGuard.markDirty();
+            }
+            Metrics::global().add(Counter::HEAP_DELETES, removed);
+            return EMPRY_ERR;
+        }
+
+        uint32_t HeapFile::takeMostFreePage() {
+            for (;;) {
+                PIG_ASSERT(!m_freeSpaceMap.empty(),
+                           "Every page is taken by an insert");
+                const uint32_t top = m_freeSpaceMap.top();
+                m_freeSpaceMap.pop();
+                uint32_t &current = m_freeSpaceEntries[top & 0xFFFF];
+                if (current == top) {
+                    current = FREE_SPACE_TAKEN;
+                    return top;
+                }
+            }
+        }
+
+        uint32_t HeapFile::takePageFor(page_size_t spaceNeeded) {
+            if (k_zoneMapColumns > 0) {
+                if (spaceNeeded < m_minTupleSpace) {
+                    // Pages skipped as too full may fit it.
+                    m_minTupleSpace = spaceNeeded;
+                    m_fillCursor    = 0;
+                }
+                for (page_id_t pageId = m_fillCursor;
+                     pageId < m_header.m_numPages; ++pageId) {
+                    uint32_t &current = m_freeSpaceEntries[pageId];
+                    // Taken pages are being filled by other inserts and
+                    // move the cursor back when put, see putPage.
+                    bool taken = current == FREE_SPACE_TAKEN;
+                    if (!taken && (current >> 16) >= spaceNeeded) {
+                        // Its entry in the map is stale from now on.
+                        uint32_t entry = current;
+                        current        = FREE_SPACE_TAKEN;
+                        if (pageId == m_fillCursor) {
+                            ++m_fillCursor;
+                        }
+                        return entry;
+                    }
+                    // A page with room for smaller tuples holds the cursor.
+                    if (pageId == m_fillCursor &&
+                        (taken || (current >> 16) < m_minTupleSpace)) {
+                        ++m_fillCursor;
+                    }
+                }
+            }
+            return takeMostFreePage();
+        }
+
+        void HeapFile::widenZoneMaps(page_id_t pageId, iovec payload) {
+            for (uint16_t column = 0; column < k_zoneMapColumns;
+                 ++column) {
+                // Columns past the end of the tuple could be anything.
+                int32_t low  = INT32_MIN;
+                int32_t high = INT32_MAX;
+                if ((column + 1) * sizeof(int32_t) <= payload.iov_len) {
+                    memcpy(&low,
+                           static_cast<const unsigned char *>(
+                               payload.iov_base) +
+                               column * sizeof(int32_t),
+                           sizeof(low));
+                    high = low;
+                }
+                // Relaxed as scans read them racily, a scan that misses a
+                // store did not overlap the insert.
+                ZoneMap &zone = zoneMap(pageId, column);
+                if (low < zone.m_min) {
+                    __atomic_store_n(&zone.m_min, low, __ATOMIC_RELAXED);
+                }
+                if (high > zone.m_max) {
+                    __atomic_store_n(&zone.m_max, high, __ATOMIC_RELAXED);
+                }
+            }
+        }
+
+        void HeapFile::rebuildZoneMaps(Page &heapPage) {
+            std::vector<ZoneMap> zones(k_zoneMapColumns,
+                                       ZoneMap{INT32_MAX, INT32_MIN});
+            for (PageSlot slot = 0; slot < heapPage.getNumSlots(); ++slot) {
+                if (!heapPage.hasTuple(slot)) {
+                    continue;
+                }
+                iovec payload = heapPage.getTuple(slot).m_payload;
+                for (uint16_t column = 0; column < zones.size(); ++column) {
+                    if ((column + 1) * sizeof(int32_t) > payload.iov_len) {
+                        zones[column] = ZoneMap{INT32_MIN, INT32_MAX};
+                        continue;
+                    }
+                    int32_t value;
+                    memcpy(&value,
+                           static_cast<const unsigned char *>(
+                               payload.iov_base) +
+                               column * sizeof(int32_t),
+                           sizeof(value));
+                    zones[column].m_min = std::min(zones[column].m_min, value);
+                    zones[column].m_max = std::max(zones[column].m_max, value);
+                }
+            }
+            // Both bounds only narrow, so a scan that reads one old and one
+            // new still gets a range covering the tuples left.
+            page_id_t pageId = heapPage.getPageId();
+            for (uint16_t column = 0; column < zones.size(); ++column) {
+                ZoneMap &zone = zoneMap(pageId, column);
+                __atomic_store_n(&zone.m_min, zones[column].m_min,
+                                 __ATOMIC_RELAXED);
+                __atomic_store_n(&zone.m_max, zones[column].m_max,
+                                 __ATOMIC_RELAXED);
+            }
+        }
+
+        bool HeapFile::mayContain(page_id_t          pageId,
+                                  const ColumnRange &range) const {
+            if (range.m_column >= k_zoneMapColumns) {
+                return true;
+            }
+            const ZoneMap &zone = zoneMap(pageId, range.m_column);
+            return __atomic_load_n(&zone.m_min, __ATOMIC_RELAXED) <=
+                       range.m_max &&
+                   range.m_min <=
+                       __atomic_load_n(&zone.m_max, __ATOMIC_RELAXED);
+        }
+
+        void HeapFile::putPage(page_id_t pageId, page_size_t freeBytes) {
+            m_freeSpaceEntries[pageId] = freeBytes << 16 | pageId;
+            pushFreeSpace(m_freeSpaceEntries[pageId]);
+            rewindFillCursor(pageId, freeBytes);
+        }
+
+        void HeapFile::rewindFillCursor(page_id_t   pageId,
+                                        page_size_t freeBytes) {
+            if (pageId < m_fillCursor && freeBytes >= m_minTupleSpace) {
+                m_fillCursor = pageId;
+            }
+        }
+
+        void HeapFile::pushFreeSpace(uint32_t entry) {
+            // Pages filled in order are taken without popping their entry,
+            // so stale entries would pile up with every insert.
+            if (m_freeSpaceMap.size() >= 2 * m_freeSpaceEntries.size()) {
+                std::vector<uint32_t> current;
+                current.reserve(m_freeSpaceEntries.size());
+                for (uint32_t e : m_freeSpaceEntries) {
+                    if (e != FREE_SPACE_TAKEN) {
+                        current.push_back(e);
+                    }
+                }
+                m_freeSpaceMap = decltype(m_freeSpaceMap)(
+                    std::less<uint32_t>(), std::move(current));
+            }
+            m_freeSpaceMap.push(entry);
+        }
+
+        void HeapFile::compactPage(BufferPool::BufferPoolPageGuard &pageGuard,
+                                   Page                            &heapPage) {
+            if (!pageGuard.isViewed() && heapPage.compact() > 0) {
+                Metrics::global().add(Counter::PAGE_COMPACTIONS);
+            }
+            rebuildZoneMaps(heapPage);
+
+            // Still latched, so no insert can put the page back meanwhile.
+            page_id_t        pageId = heapPage.getPageId();
+            uint32_t         entry  = heapPage.getFreeBytes() << 16 | pageId;
+            std::unique_lock lock(m_freeSpaceLock);
+            uint32_t        &current = m_freeSpaceEntries[pageId];
+            if (current != FREE_SPACE_TAKEN && current != entry) {
+                current = entry;
+                pushFreeSpace(entry);
+                rewindFillCursor(pageId, heapPage.getFreeBytes());
+            }
+        }
+
+        void HeapFile::undoInsert(const TupleId &tupleId) {
+            BufferPool::BufferPoolPageGuard pageGuard;
+            auto err = m_bufferPool->getPage(m_id, toFilePageId(tupleId.first),
+                                             LatchMode::EXCLUSIVE, pageGuard);
+            PIG_ASSERT(!err, "Page of a change to undo can not be read");
+            Page(tupleId.first, pageGuard.getRawPage())
+                .setXmin(tupleId.second, INVALID_TXN_ID);
+            pageGuard.markDirty();
+        }
+
+        void HeapFile::undoDelete(const TupleId &tupleId) {
+            BufferPool::BufferPoolPageGuard pageGuard;
+            auto err = m_bufferPool->getPage(m_id, toFilePageId(tupleId.first),
+                                             LatchMode::EXCLUSIVE, pageGuard);
+            PIG_ASSERT(!err, "Page of a change to undo can not be read");
+            Page(tupleId.first, pageGuard.getRawPage())
+                .setXmax(tupleId.second, INVALID_TXN_ID);
+            pageGuard.markDirty();
+        }
+
     } // namespace Core
 } // namespace Pig
\ No newline at end of file
@@ -1,6 +1,7 @@
 #ifndef PIGDB_CORE_HEAP_H
 #define PIGDB_CORE_HEAP_H
 
+#include <algorithm>
 #include <bitset>
 #include <cstdint>
 #include <cstring>
@@ -8,59 +9,121 @@
 #include <iterator>
 #include <memory>
 #include <new>
+#include <optional>
 #include <queue>
 #include <shared_mutex>
 #include <sys/uio.h>
+#include <utility>
+#include <vector>
 
 #include "buffer_pool.h"
+#include "checksum.h"
 #include "core.h"
 #include "disk-manager.h"
 #include "error.h"
+#include "metrics.h"
+#include "transaction.h"
 #include "util.h"
 
 namespace Pig {
     namespace Core {
 
-        using PageSlot = uint16_t;
-        using TupleId  = std::pair<page_id_t, PageSlot>;
-
         class HeapFile {
           public:
+            // Pages before the first data page: header + 3 spacemap zones.
+            static constexpr page_id_t RESERVED_PAGES = 4;
+
             // Make sure fields are aligned.
             struct Header {
+                // Page size of the file, fixed at creation.
+                page_size_t m_pageSize = PAGE_SIZE_B;
+                // Number of data pages, excludes RESERVED_PAGES.
+                page_id_t m_numPages = MAX_PAGES;
                 // Compression type for pages, note that header is uncompressed.
                 CompressionType m_compression = CompressionType::NONE;
+                // Checksum of tuples and pages, 0(XXH32) in files created
+                // before it was recorded.
+                ChecksumType m_checksum = ChecksumType::XXHASH3;
+            };
+
+            // Inclusive range of an int32 column, empty if m_min > m_max.
+            struct ColumnRange {
+                uint16_t m_column;
+                int32_t  m_min;
+                int32_t  m_max;
             };
 
             // Make sure fields are aligned.
             struct Tuple {
                 uint32_t m_checksum;
+                // Transaction that inserted and deleted the tuple.
+                txn_id_t m_xmin;
+                txn_id_t m_xmax;
                 iovec    m_payload;
 
-                Tuple(uint32_t checksum, iovec payload)
-                    : m_checksum{checksum}, m_payload{payload} {}
+                Tuple(uint32_t checksum, iovec payload,
+                      txn_id_t xmin = FROZEN_TXN_ID,
+                      txn_id_t xmax = INVALID_TXN_ID)
+                    : m_checksum{checksum}, m_xmin{xmin}, m_xmax{xmax},
+                      m_payload{payload} {}
             };
 
             // Make sure fields are aligned.
             class Page {
 
               public:
+                /** PAGE HEADER OF LENGTH 2 + 2 + 2 + 2 + 4 = 12 bytes */
+                static constexpr page_size_t HEADER_BYTES =
+                    sizeof(page_id_t) + sizeof(PageSlot) + sizeof(uint16_t) +
+                    sizeof(PageSlot) + sizeof(uint32_t);
+
+                // Checksum of the whole page, set and verified by the buffer
+                // pool on write and read, see BufferPool::enablePageChecksums
+                static constexpr page_size_t CHECKSUM_OFFSET =
+                    HEADER_BYTES - sizeof(uint32_t);
+
+                // A slot is {16 bit offset, 16 bit length} of the tuple
+                // relative to the end of page header, 0 once the tuple is
+                // removed. This is wide enough for the largest page size, as
+                // are the 16 bits of free bytes in the header.
+                static constexpr page_size_t SLOT_BYTES = sizeof(uint32_t);
+                static_assert(MAX_PAGE_SIZE_B - HEADER_BYTES <= UINT16_MAX,
+                              "Slot can not address largest page");
+
+                static constexpr page_size_t
+                freeBytesFor(page_size_t pageSize) {
+                    return pageSize - HEADER_BYTES;
+                }
+
                 static constexpr page_size_t FREE_BYTES =
-                    PAGE_SIZE_KB * 1024 - sizeof(page_id_t) - sizeof(PageSlot) -
-                    sizeof(page_size_t);
+                    PAGE_SIZE_B - HEADER_BYTES;
+
+                // Tuple header is {checksum, xmin, xmax}, tuples are padded
+                // to 4 bytes so that the header can be accessed atomically.
+                static constexpr page_size_t TUPLE_HEADER_BYTES =
+                    sizeof(uint32_t) + 2 * sizeof(txn_id_t);
+                static constexpr page_size_t TUPLE_ALIGN = sizeof(txn_id_t);
 
                 // TODO: check if this should be used
-                explicit Page(page_id_t pageId)
-                    : k_pageId{pageId}, m_numSlots{0} {
+                explicit Page(page_id_t   pageId,
+                              page_size_t pageSize = PAGE_SIZE_B)
+                    : k_pageId{pageId}, k_pageSize{pageSize}, m_numSlots{0},
+                      m_freeBytes{freeBytesFor(pageSize)}, m_freeSlots{0},
+                      m_header{nullptr} {
+                    PIG_ASSERT(isValidPageSize(pageSize),
+                               "Unsupported page size");
                     m_buffer.iov_base = nullptr;
                     m_buffer.iov_len  = 0;
                 }
 
-                Page(page_id_t pageId, iovec pageBuf) : k_pageId{pageId} {
-                    PIG_ASSERT(pageBuf.iov_len == PAGE_SIZE_B,
-                               "Page buffer not equals PAGE_SIZE_B");
+                Page(page_id_t pageId, iovec pageBuf)
+                    : k_pageId{pageId},
+                      k_pageSize{static_cast<page_size_t>(pageBuf.iov_len)} {
+                    PIG_ASSERT(isValidPageSize(k_pageSize),
+                               "Page buffer is not a valid page size");
                     auto base =
                         reinterpret_cast<unsigned char *>(pageBuf.iov_base);
+                    m_header     = base;
                     auto page_id = reinterpret_cast<page_id_t *>(base);
                     PIG_ASSERT(
                         *page_id == k_pageId,
@@ -68,26 +131,37 @@ namespace Pig {
 
                     base += sizeof(k_pageId);
 
+                    // Pairs with syncHeader, slots upto numSlots are
+                    // complete even while a writer appends to the page.
                     auto numSlots = reinterpret_cast<PageSlot *>(base);
-                    m_numSlots    = *numSlots;
+                    m_numSlots    = __atomic_load_n(numSlots, __ATOMIC_ACQUIRE);
 
                     base += sizeof(m_numSlots);
 
-                    auto freeBytes = reinterpret_cast<page_size_t *>(base);
+                    auto freeBytes = reinterpret_cast<uint16_t *>(base);
                     m_freeBytes    = *freeBytes;
 
-                    base += sizeof(m_freeBytes);
+                    base += sizeof(uint16_t);
+
+                    // 0 in pages written before slots could be removed.
+                    auto freeSlots = reinterpret_cast<PageSlot *>(base);
+                    m_freeSlots    = *freeSlots;
+
+                    base += sizeof(m_freeSlots) + sizeof(uint32_t);
 
                     m_buffer.iov_base = reinterpret_cast<unsigned char *>(base);
-                    m_buffer.iov_len  = FREE_BYTES;
+                    m_buffer.iov_len  = freeBytesFor(k_pageSize);
                 }
 
                 void initPage(iovec pageBuf) {
                     PIG_ASSERT(m_buffer.iov_base == nullptr,
                                "Page to be inited has already set buffer");
+                    PIG_ASSERT(pageBuf.iov_len == k_pageSize,
+                               "Page buffer not equals page size");
 
                     auto base =
                         reinterpret_cast<unsigned char *>(pageBuf.iov_base);
+                    m_header     = base;
                     auto page_id = reinterpret_cast<page_id_t *>(base);
                     *page_id     = k_pageId;
 
@@ -98,51 +172,210 @@ namespace Pig {
 
                     base += sizeof(m_numSlots);
 
-                    auto freeBytes = reinterpret_cast<page_size_t *>(base);
-                    *freeBytes     = FREE_BYTES;
+                    auto freeBytes = reinterpret_cast<uint16_t *>(base);
+                    *freeBytes     = freeBytesFor(k_pageSize);
 
-                    base += sizeof(m_freeBytes);
+                    base += sizeof(uint16_t);
+
+                    auto freeSlots = reinterpret_cast<PageSlot *>(base);
+                    *freeSlots     = 0;
+
+                    base += sizeof(m_freeSlots);
+
+                    auto checksum = reinterpret_cast<uint32_t *>(base);
+                    *checksum     = 0;
+
+                    base += sizeof(uint32_t);
 
                     m_buffer.iov_base = reinterpret_cast<unsigned char *>(base);
-                    m_buffer.iov_len  = FREE_BYTES;
+                    m_buffer.iov_len  = freeBytesFor(k_pageSize);
                 }
 
+                static page_size_t tupleLength(const Tuple &tuple) {
+                    return TUPLE_HEADER_BYTES + tuple.m_payload.iov_len;
+                }
+
+                static constexpr page_size_t alignedLength(page_size_t length) {
+                    return (length + TUPLE_ALIGN - 1) / TUPLE_ALIGN *
+                           TUPLE_ALIGN;
+                }
+
+                // Space for the tuple with a new slot, an upper bound when
+                // a removed slot is reused.
                 static page_size_t spaceForTuple(const Tuple &tuple) {
-                    return sizeof(tuple.m_checksum) + tuple.m_payload.iov_len +
-                           sizeof(uint32_t) /*for slot*/;
+                    return alignedLength(tupleLength(tuple)) + SLOT_BYTES;
+                }
+
+                bool hasSpaceFor(const Tuple &t) const {
+                    page_size_t slotBytes = m_freeSlots > 0 ? 0 : SLOT_BYTES;
+                    return alignedLength(tupleLength(t)) + slotBytes <=
+                           m_freeBytes;
                 }
 
+                /**
+                 * Adds the tuple in the free bytes, reusing the first removed
+                 * slot if there is one.
+                 */
                 PageSlot addTuple(const Tuple &t) {
                     PIG_ASSERT(
-                        spaceForTuple(t) <= m_freeBytes,
+                        hasSpaceFor(t),
                         fmt::format("Not enough space in page for tuple"));
 
-                    page_size_t tupleLength =
-                        sizeof(t.m_checksum) + t.m_payload.iov_len;
-                    uint16_t tupleOffsetInPage = m_freeBytes - 1 - tupleLength;
+                    page_size_t length     = tupleLength(t);
+                    page_size_t tupleBytes = alignedLength(length);
+                    // Slots grow from the start of the buffer and tuples from
+                    // the end, so the lowest tuple starts right after free
+                    // bytes and the slot array.
+                    page_size_t tupleOffsetInPage =
+                        m_freeBytes + m_numSlots * SLOT_BYTES - tupleBytes;
                     unsigned char *tupleOffset =
                         static_cast<unsigned char *>(m_buffer.iov_base) +
                         tupleOffsetInPage;
-                    uint32_t *pageSlotOffset =
-                        reinterpret_cast<uint32_t *>(m_buffer.iov_base) +
-                        m_numSlots;
-                    *pageSlotOffset = static_cast<PageSlot>(tupleOffsetInPage)
-                                          << 16 |
-                                      tupleLength;
-                    // Copy the checksum
-                    memcpy(tupleOffset, &t.m_checksum, sizeof(t.m_checksum));
-                    memcpy(tupleOffset + sizeof(t.m_checksum),
+
+                    auto header = reinterpret_cast<uint32_t *>(tupleOffset);
+                    header[0]   = t.m_checksum;
+                    header[1]   = t.m_xmin;
+                    header[2]   = t.m_xmax;
+                    memcpy(tupleOffset + TUPLE_HEADER_BYTES,
                            t.m_payload.iov_base, t.m_payload.iov_len);
 
-                    m_freeBytes -= spaceForTuple(t);
+                    PageSlot slot = m_numSlots;
+                    if (m_freeSlots > 0) {
+                        for (slot = 0; slotEntry(slot) != 0; ++slot) {
+                        }
+                        --m_freeSlots;
+                    } else {
+                        m_freeBytes -= SLOT_BYTES;
+                        ++m_numSlots;
+                    }
+                    // A reused slot is published by its entry, a new one by
+                    // the slot count in syncHeader.
+                    __atomic_store_n(slots() + slot,
+                                     tupleOffsetInPage << 16 | length,
+                                     __ATOMIC_RELEASE);
+                    m_freeBytes -= tupleBytes;
+                    syncHeader();
+
+                    return slot;
+                }
+
+                // False for slots past the end and removed ones.
+                bool hasTuple(PageSlot slot) const {
+                    return slot < m_numSlots && slotEntry(slot) != 0;
+                }
+
+                /**
+                 * Removes the tuple, its slot is reused by a later add and
+                 * its bytes are reclaimed by compact.
+                 */
+                void removeTuple(PageSlot slot) {
+                    PIG_ASSERT(hasTuple(slot),
+                               fmt::format("No tuple in slot {}", slot));
+                    __atomic_store_n(slots() + slot, 0u, __ATOMIC_RELEASE);
+                    ++m_freeSlots;
+                    syncHeader();
+                }
+
+                /**
+                 * Moves the tuples together at the end of the page, so the
+                 * bytes of removed ones become free bytes, and drops removed
+                 * slots at the end of the slot array. Slots of the remaining
+                 * tuples do not change. Returns the bytes reclaimed.
+                 * Tuples move, so the page must be latched exclusively and
+                 * nobody may hold pointers into it, e.g a TupleView.
+                 */
+                page_size_t compact() {
+                    std::vector<uint32_t> entries;
+                    for (PageSlot slot = 0; slot < m_numSlots; ++slot) {
+                        if (uint32_t entry = slotEntry(slot); entry != 0) {
+                            // Offset in the high bits sorts by offset.
+                            entries.push_back((entry & 0xFFFF0000) | slot);
+                        }
+                    }
+                    // Highest first, each tuple only moves up so it never
+                    // overwrites one that is still to be moved.
+                    std::sort(entries.rbegin(), entries.rend());
+
+                    auto        base = static_cast<unsigned char *>(
+                        m_buffer.iov_base);
+                    page_size_t end  = freeBytesFor(k_pageSize);
+                    for (uint32_t sorted : entries) {
+                        PageSlot    slot   = sorted & 0xFFFF;
+                        page_size_t offset = sorted >> 16;
+                        page_size_t length = slotEntry(slot) & 0xFFFF;
+                        end -= alignedLength(length);
+                        if (end != offset) {
+                            memmove(base + end, base + offset, length);
+                            __atomic_store_n(slots() + slot,
+                                             end << 16 | length,
+                                             __ATOMIC_RELEASE);
+                        }
+                    }
+
+                    for (; m_numSlots > 0 && slotEntry(m_numSlots - 1) == 0;
+                         --m_numSlots) {
+                        --m_freeSlots;
+                    }
+                    page_size_t before = m_freeBytes;
+                    m_freeBytes        = end - m_numSlots * SLOT_BYTES;
+                    syncHeader();
+                    return m_freeBytes - before;
+                }
+
+                /**
+                 * Returns the tuple at slot, payload points into the page
+                 * buffer and is valid as long as the buffer is.
+                 * xmin and xmax are read atomically as the writer can change
+                 * them while the page is read.
+                 */
+                Tuple getTuple(PageSlot slot) const {
+                    PIG_ASSERT(slot < m_numSlots,
+                               fmt::format("Invalid slot {} requested", slot));
+                    return tupleAt(slotEntry(slot));
+                }
 
-                    return m_numSlots++;
+                /**
+                 * As getTuple for optimistic readers, which can see a slot
+                 * entry that is being removed or moved, or a slot count
+                 * from a later page. Empty unless the entry describes a
+                 * tuple inside the page, whose bytes are then safe to read
+                 * but still have to be validated.
+                 */
+                std::optional<Tuple> tryGetTuple(PageSlot slot) const {
+                    if (slot >= m_numSlots ||
+                        (slot + 1u) * SLOT_BYTES > m_buffer.iov_len) {
+                        return std::nullopt;
+                    }
+                    uint32_t    entry  = slotEntry(slot);
+                    page_size_t offset = entry >> 16;
+                    page_size_t length = entry & 0xFFFF;
+                    if (length < TUPLE_HEADER_BYTES ||
+                        offset % TUPLE_ALIGN != 0 ||
+                        offset + length > m_buffer.iov_len) {
+                        return std::nullopt;
+                    }
+                    return tupleAt(entry);
+                }
+
+                void setXmin(PageSlot slot, txn_id_t xmin) {
+                    __atomic_store_n(&tupleHeader(slot)[1], xmin,
+                                     __ATOMIC_RELEASE);
+                }
+
+                void setXmax(PageSlot slot, txn_id_t xmax) {
+                    __atomic_store_n(&tupleHeader(slot)[2], xmax,
+                                     __ATOMIC_RELEASE);
                 }
 
                 page_id_t getPageId() const { return k_pageId; }
 
+                page_size_t getPageSize() const { return k_pageSize; }
+
                 PageSlot getNumSlots() const { return m_numSlots; }
 
+                // Removed slots below getNumSlots.
+                PageSlot getFreeSlots() const { return m_freeSlots; }
+
                 page_size_t getFreeBytes() const { return m_freeBytes; }
 
 #ifdef UNIT_TEST
@@ -151,16 +384,110 @@ namespace Pig {
 #endif
 
               private:
-                /** PAGE HEADER OF LENGTH 2 + 2 + 2 = 6 bytes */
-                const page_id_t k_pageId;
-                PageSlot        m_numSlots;
-                page_size_t     m_freeBytes = FREE_BYTES;
+                uint32_t *slots() const {
+                    return static_cast<uint32_t *>(m_buffer.iov_base);
+                }
 
+                // Entries change under optimistic readers on reuse and
+                // compaction.
+                uint32_t slotEntry(PageSlot slot) const {
+                    return __atomic_load_n(slots() + slot, __ATOMIC_ACQUIRE);
+                }
+
+                // The tuple a slot entry describes, loaded once as it may
+                // change meanwhile.
+                Tuple tupleAt(uint32_t entry) const {
+                    auto header = reinterpret_cast<uint32_t *>(
+                        static_cast<unsigned char *>(m_buffer.iov_base) +
+                        (entry >> 16));
+
+                    iovec payload;
+                    payload.iov_base =
+                        reinterpret_cast<unsigned char *>(header) +
+                        TUPLE_HEADER_BYTES;
+                    payload.iov_len = (entry & 0xFFFF) - TUPLE_HEADER_BYTES;
+                    return Tuple(header[0], payload,
+                                 __atomic_load_n(&header[1], __ATOMIC_ACQUIRE),
+                                 __atomic_load_n(&header[2], __ATOMIC_ACQUIRE));
+                }
+
+                uint32_t *tupleHeader(PageSlot slot) const {
+                    PIG_ASSERT(slot < m_numSlots,
+                               fmt::format("Invalid slot {} requested", slot));
+                    return reinterpret_cast<uint32_t *>(
+                        static_cast<unsigned char *>(m_buffer.iov_base) +
+                        (slotEntry(slot) >> 16));
+                }
+
+                // Writes back the mutable header fields to page buffer, the
+                // slot count last so that readers never see a partial tuple.
+                void syncHeader() {
+                    auto     base      = m_header + sizeof(k_pageId);
+                    uint16_t freeBytes = m_freeBytes;
+                    memcpy(base + sizeof(m_numSlots), &freeBytes,
+                           sizeof(freeBytes));
+                    memcpy(base + sizeof(m_numSlots) + sizeof(freeBytes),
+                           &m_freeSlots, sizeof(m_freeSlots));
+                    __atomic_store_n(reinterpret_cast<PageSlot *>(base),
+                                     m_numSlots, __ATOMIC_RELEASE);
+                }
+
+                const page_id_t   k_pageId;
+                const page_size_t k_pageSize;
+                PageSlot          m_numSlots;
+                page_size_t       m_freeBytes;
+                PageSlot          m_freeSlots;
+
+                // Start of page buffer where header lives.
+                unsigned char *m_header;
                 // In m_freeBytes, the slots occupy 4 bytes(offset + length)
                 // The tuples are stored in the end.
                 iovec m_buffer;
             };
 
+            // The header page has its checksum where data pages do.
+            static_assert(sizeof(Header) <= Page::CHECKSUM_OFFSET,
+                          "Header overlaps the page checksum");
+
+            /**
+             * Payload of a tuple read in place from its frame. The view pins
+             * the page, so the payload stays valid till the view is released
+             * or destroyed, but holds no latch. The bytes of a tuple never
+             * change once added, writers only set xmin and xmax, which are
+             * not part of the view for that reason, and pages are not
+             * compacted while someone else pins them.
+             */
+            class TupleView {
+              public:
+                TupleView() = default;
+
+                const unsigned char *data() const noexcept {
+                    return static_cast<const unsigned char *>(
+                        m_payload.iov_base);
+                }
+
+                size_t size() const noexcept { return m_payload.iov_len; }
+
+                iovec getPayload() const noexcept { return m_payload; }
+
+                // False if empty, released or moved from.
+                bool holdsTuple() const noexcept {
+                    return m_guard && m_guard->holdsPage();
+                }
+
+                // Unpins the page, safe to call more than once.
+                void release() {
+                    m_guard.reset();
+                    m_payload = iovec{};
+                }
+
+              private:
+                friend class HeapFile;
+
+                std::optional<BufferPool::BufferPoolPageGuard> m_guard;
+                iovec                                          m_payload{};
+            };
+
           private:
             IoId_t m_id;
             Header m_header;
@@ -176,9 +503,113 @@ namespace Pig {
                                 std::less<uint32_t>>
                 m_freeSpaceMap;
 
+            // Entry of a page taken out of the map by an insert.
+            static constexpr uint32_t FREE_SPACE_TAKEN = UINT32_MAX;
+
+            /*
+                Current entry of every page, or FREE_SPACE_TAKEN. Compaction
+                can not update an entry inside the queue, so it pushes a new
+                one, and entries in the queue that are not current are
+                skipped when they reach the top, or dropped when the queue
+                gets to twice the pages, see pushFreeSpace.
+            */
+            std::vector<uint32_t> m_freeSpaceEntries;
+
             std::shared_mutex m_freeSpaceLock;
 
-            HeapFile(std::shared_ptr<DiskManager> diskManager);
+            // Pages before it are taken or have no room for the smallest
+            // tuple inserted so far, so inserts filling pages in order start
+            // from it. Both must hold m_freeSpaceLock.
+            page_id_t   m_fillCursor    = 0;
+            page_size_t m_minTupleSpace = UINT16_MAX;
+
+            // Range of values of a column over the tuples of a page,
+            // empty(m_min > m_max) if the page has none.
+            struct ZoneMap {
+                int32_t m_min;
+                int32_t m_max;
+            };
+
+            /*
+                m_zoneMapColumns entries per page, next to the free space
+                entries and like them in memory only, they are rebuilt from
+                the pages. Only widened by the insert holding the page, under
+                its latch, before the tuple lands, so a scan that skips a
+                page could not have seen the tuple in it either.
+            */
+            std::unique_ptr<ZoneMap[]> m_zoneMaps;
+            // Leading int32 columns of tuples with zone maps, known to the
+            // owner of the schema and not to the file.
+            const uint16_t k_zoneMapColumns;
+
+            // Inserts are cheap compared to reading the clock.
+            static constexpr uint32_t INSERT_LATENCY_SAMPLE_EVERY = 64;
+
+            static constexpr uint32_t OPTIMISTIC_READ_ATTEMPTS = 4;
+
+            HeapFile(std::shared_ptr<DiskManager> diskManager,
+                     std::shared_ptr<BufferPool>  bufferPool,
+                     page_size_t pageSize, page_id_t numPages,
+                     ChecksumType checksum, uint16_t zoneMapColumns);
+
+            // Files from before the checksum type was recorded have XXH32
+            // tuple checksums but XXH3 page checksums.
+            ChecksumType pageChecksumType() const noexcept {
+                return m_header.m_checksum == ChecksumType::XXHASH32
+                           ? ChecksumType::XXHASH3
+                           : m_header.m_checksum;
+            }
+
+            // Takes the page with most free space out of the map for an
+            // insert. Must hold m_freeSpaceLock.
+            uint32_t takeMostFreePage();
+
+            /*
+                Takes a page for an insert of a tuple of spaceNeeded bytes.
+                Files with zone maps fill pages in order, so that values
+                appended in order give pages narrow ranges, and fall back to
+                the page with most free space once the last page is full.
+                Must hold m_freeSpaceLock.
+            */
+            uint32_t takePageFor(page_size_t spaceNeeded);
+
+            // Must hold the page latched exclusively.
+            void widenZoneMaps(page_id_t pageId, iovec payload);
+
+            // Recomputes the zone maps from the tuples left in the page,
+            // latched exclusively.
+            void rebuildZoneMaps(Page &heapPage);
+
+            ZoneMap &zoneMap(page_id_t pageId, uint16_t column) const {
+                return m_zoneMaps[static_cast<size_t>(pageId) *
+                                      k_zoneMapColumns +
+                                  column];
+            }
+
+            // Puts a taken page back. Must hold m_freeSpaceLock.
+            void putPage(page_id_t pageId, page_size_t freeBytes);
+
+            // Moves m_fillCursor back to a page that got room for the
+            // smallest tuple. Must hold m_freeSpaceLock.
+            void rewindFillCursor(page_id_t pageId, page_size_t freeBytes);
+
+            // Pushes the current entry of a page, dropping the stale ones
+            // once they outnumber the pages. Must hold m_freeSpaceLock.
+            void pushFreeSpace(uint32_t entry);
+
+            /*
+                Compacts a page latched exclusively, unless someone else
+                pins it as they may point into it, then the page keeps the
+                dead bytes till it is compacted next. Publishes the free
+                bytes unless an insert has the page, which does it.
+            */
+            void compactPage(BufferPool::BufferPoolPageGuard &pageGuard,
+                             Page                            &heapPage);
+
+            // Data pages are stored after the reserved pages in the file.
+            static page_id_t toFilePageId(page_id_t pageId) {
+                return pageId + RESERVED_PAGES;
+            }
 
           public:
             HeapFile(const HeapFile &) = delete;
@@ -190,13 +621,34 @@ namespace Pig {
             /**
              *
              * Create a uniquely owned HeapFile.
+             * The page size of the file must match the frames of bufferPool.
              * Note that current it does not grow.
              */
             [[nodiscard]] static std::unique_ptr<HeapFile>
-            create(std::shared_ptr<DiskManager> diskManager);
+            create(std::shared_ptr<DiskManager> diskManager,
+                   std::shared_ptr<BufferPool>  bufferPool,
+                   page_size_t                  pageSize = PAGE_SIZE_B,
+                   page_id_t                    numPages = MAX_PAGES,
+                   ChecksumType checksum       = ChecksumType::XXHASH3,
+                   uint16_t     zoneMapColumns = 0);
+
+            const Header &getHeader() const noexcept { return m_header; }
+
+            IoId_t getIoId() const noexcept { return m_id; }
+
+            uint16_t getZoneMapColumns() const noexcept {
+                return k_zoneMapColumns;
+            }
 
             Page *getPage(page_id_t pageId) const noexcept;
 
+            /**
+             * False if no tuple of the page has the column in range, from
+             * the zone map of the page without reading it. True for columns
+             * without zone maps.
+             */
+            bool mayContain(page_id_t pageId, const ColumnRange &range) const;
+
             /**
              * Assigns a tuple to a page slot in heap.
              * The heap file owns the logic to a page based on free space
@@ -206,6 +658,246 @@ namespace Pig {
              * In future, if there are no page,it would trigger growth.
              */
             Error addTuple(iovec tuple, TupleId &assignedTupleId);
+
+            /**
+             * Inserts a tuple version created by txn, it is visible to
+             * snapshots taken after txn commits.
+             */
+            Error addTuple(WriteTransaction &txn, iovec tuple,
+                           TupleId &assignedTupleId);
+
+            /**
+             * Inserts count tuples, assigning their ids in order, for bulk
+             * loads. Checksums are computed in one batch and each page is
+             * latched once for all the tuples that fit in it.
+             */
+            Error addTuples(const iovec *tuples, size_t count,
+                            TupleId *assignedTupleIds);
+
+            // As above, as versions created by txn. If it fails midway the
+            // tuples already inserted are undone with txn.
+            Error addTuples(WriteTransaction &txn, const iovec *tuples,
+                            size_t count, TupleId *assignedTupleIds);
+
+            /**
+             * Deletes the tuple version visible to txn by setting its xmax,
+             * the space is kept as older snapshots may still read it.
+             * ERR_NOT_FOUND if txn does not see the tuple.
+             */
+            Error deleteTuple(WriteTransaction &txn, const TupleId &tupleId);
+
+            /**
+             * Removes a tuple written outside transactions, or one that no
+             * snapshot can see any more, and compacts its page. The slot is
+             * reused by a later insert. ERR_NOT_FOUND if there is no tuple.
+             */
+            Error deleteTuple(const TupleId &tupleId);
+
+            /**
+             * Removes the tuples no snapshot at or after horizon can see,
+             * deletes by transactions upto horizon and aborted inserts, and
+             * compacts their pages. horizon must not be later than the
+             * oldest snapshot still in use. removed is set to the number
+             * removed, also when a page can not be read.
+             */
+            Error vacuum(txn_id_t horizon, size_t &removed);
+
+            /**
+             * Points view at the payload of the tuple without copying it,
+             * the page stays pinned while the view holds it.
+             */
+            Error viewTuple(const TupleId &tupleId, TupleView &view);
+
+            /**
+             * As above for the version visible in snapshot, ERR_NOT_FOUND if
+             * there is none.
+             */
+            Error viewTuple(const Snapshot &snapshot, const TupleId &tupleId,
+                            TupleView &view);
+
+            /**
+             * Copies payload of the tuple into payload, resizing it.
+             */
+            Error getTuple(const TupleId              &tupleId,
+                           std::vector<unsigned char> &payload);
+
+            /**
+             * As above for the version visible in snapshot, ERR_NOT_FOUND if
+             * there is none.
+             */
+            Error getTuple(const Snapshot &snapshot, const TupleId &tupleId,
+                           std::vector<unsigned char> &payload);
+
+            /**
+             * Checks the checksum of every tuple, ERR_CORRUPTED on the first
+             * that does not match.
+             */
+            Error verify();
+
+            /**
+             * Visits all tuples in page order, visitor is called with
+             * (const TupleId &, iovec payload) and the payload is valid only
+             * for the duration of the call as the page stays pinned till then.
+             * Returning false from visitor stops the scan.
+             * All versions are visited, see scan with Snapshot.
+             */
+            template <typename Visitor> Error scan(Visitor &&visitor) {
+                return scanIf([](const Tuple &) { return true; },
+                              std::forward<Visitor>(visitor));
+            }
+
+            /**
+             * Visits tuples visible in snapshot, tuples inserted after the
+             * snapshot are skipped. Pages are read optimistically as in
+             * viewTuple, so readers never hold up the writer. They only wait
+             * out a write in progress on the page read, and take the shared
+             * latch if the page keeps changing. The visitor runs with the
+             * page only pinned.
+             */
+            template <typename Visitor>
+            Error scan(const Snapshot &snapshot, Visitor &&visitor) {
+                return scan(snapshot, 0, m_header.m_numPages,
+                            std::forward<Visitor>(visitor));
+            }
+
+            /**
+             * As above over pages [firstPage, endPage) only, so that ranges
+             * of pages, morsels, can be scanned by different threads.
+             */
+            template <typename Visitor>
+            Error scan(const Snapshot &snapshot, page_id_t firstPage,
+                       page_id_t endPage, Visitor &&visitor) {
+                return scanIf(
+                    [&snapshot](const Tuple &t) {
+                        return snapshot.isVisible(t.m_xmin, t.m_xmax);
+                    },
+                    std::forward<Visitor>(visitor), firstPage, endPage);
+            }
+
+            /**
+             * As above, skipping the pages whose zone map rules out range
+             * without pinning them. Tuples of the pages read are visited
+             * whether in range or not, the visitor still filters.
+             */
+            template <typename Visitor>
+            Error scan(const Snapshot &snapshot, page_id_t firstPage,
+                       page_id_t endPage, const ColumnRange &range,
+                       Visitor &&visitor) {
+                return scanIf(
+                    [&snapshot](const Tuple &t) {
+                        return snapshot.isVisible(t.m_xmin, t.m_xmax);
+                    },
+                    std::forward<Visitor>(visitor), firstPage, endPage,
+                    &range);
+            }
+
+          private:
+            friend class WriteTransaction;
+
+            Error insert(iovec tuple, txn_id_t xmin, TupleId &assignedTupleId);
+
+            // On error the first numInserted tuples stay inserted.
+            Error insertBatch(const iovec *tuples, size_t count, txn_id_t xmin,
+                              TupleId *assignedTupleIds, size_t &numInserted);
+
+            // Reads the page optimistically and retries if a writer changed
+            // it, falls back to the shared latch after a few attempts. The
+            // view keeps only the pin either way. With copy, the payload is
+            // copied out before validating instead and view stays empty, so
+            // the page is not held as viewed.
+            Error findTuple(const Snapshot *snapshot, const TupleId &tupleId,
+                            TupleView                  &view,
+                            std::vector<unsigned char> *copy = nullptr);
+
+            Error copyTuple(const Snapshot *snapshot, const TupleId &tupleId,
+                            std::vector<unsigned char> &payload);
+
+            // Called on abort, the writer lock is still held. Aborts can not
+            // fail halfway, so a page that can not be read again is fatal.
+            void undoInsert(const TupleId &tupleId);
+            void undoDelete(const TupleId &tupleId);
+
+            using SlotPayloads = std::vector<std::pair<PageSlot, iovec>>;
+
+            // Collects the slots and payloads of the tuples of the page that
+            // pass filter. Read optimistically and retried if a writer changed
+            // the page as in findTuple, the guard is left holding the page as
+            // viewed so the payloads stay in place.
+            template <typename Filter>
+            Error readTuplesIf(page_id_t pageId, Filter &filter,
+                               BufferPool::BufferPoolPageGuard &pageGuard,
+                               SlotPayloads                    &visible) {
+                for (uint32_t attempt = 0;; ++attempt) {
+                    LatchMode mode = attempt < OPTIMISTIC_READ_ATTEMPTS
+                                         ? LatchMode::OPTIMISTIC
+                                         : LatchMode::SHARED;
+                    pageGuard.release();
+                    if (auto err = m_bufferPool->getPage(
+                            m_id, toFilePageId(pageId), mode, pageGuard);
+                        err) {
+                        return err;
+                    }
+                    auto     heapPage = Page(pageId, pageGuard.getRawPage());
+                    PageSlot numSlots = heapPage.getNumSlots();
+                    // A slot count from a later page can overrun it.
+                    bool torn = static_cast<size_t>(numSlots) *
+                                    Page::SLOT_BYTES >
+                                pageGuard.getRawPage().iov_len;
+                    visible.clear();
+                    for (PageSlot slot = 0; !torn && slot < numSlots; ++slot) {
+                        if (!heapPage.hasTuple(slot)) {
+                            continue;
+                        }
+                        auto t = heapPage.tryGetTuple(slot);
+                        if (!t) {
+                            torn = true;
+                        } else if (filter(*t)) {
+                            visible.emplace_back(slot, t->m_payload);
+                        }
+                    }
+                    PIG_ASSERT(!torn || mode == LatchMode::OPTIMISTIC,
+                               "Tuple is out of page bounds");
+                    pageGuard.unlatch();
+                    if (!torn && pageGuard.validate()) {
+                        return EMPRY_ERR;
+                    }
+                }
+            }
+
+            template <typename Filter, typename Visitor>
+            Error scanIf(Filter &&filter, Visitor &&visitor,
+                         page_id_t          firstPage = 0,
+                         page_id_t          endPage   = MAX_PAGES,
+                         const ColumnRange *range     = nullptr) {
+                endPage          = std::min(endPage, m_header.m_numPages);
+                uint64_t skipped = 0;
+                SlotPayloads     visible;
+                for (page_id_t pageId = firstPage; pageId < endPage;
+                     ++pageId) {
+                    if (range != nullptr && !mayContain(pageId, *range)) {
+                        ++skipped;
+                        continue;
+                    }
+                    BufferPool::BufferPoolPageGuard pageGuard;
+                    if (auto err = readTuplesIf(pageId, filter, pageGuard,
+                                                visible);
+                        err) {
+                        Metrics::global().add(
+                            Counter::ZONE_MAP_SKIPPED_PAGES, skipped);
+                        return err;
+                    }
+                    for (const auto &[slot, payload] : visible) {
+                        if (!visitor(TupleId{pageId, slot}, payload)) {
+                            Metrics::global().add(
+                                Counter::ZONE_MAP_SKIPPED_PAGES, skipped);
+                            return EMPRY_ERR;
+                        }
+                    }
+                }
+                Metrics::global().add(Counter::ZONE_MAP_SKIPPED_PAGES,
+                                      skipped);
+                return EMPRY_ERR;
+            }
         };
     } // namespace Core
 } // namespace Pig
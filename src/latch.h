@@ -0,0 +1,91 @@
+#ifndef PIG_CORE_LATCH_H
+#define PIG_CORE_LATCH_H
+
+#include <atomic>
+#include <cstdint>
+#include <shared_mutex>
+#include <thread>
+
+namespace Pig {
+    namespace Core {
+
+        // What a page guard intends to do with the page.
+        enum class LatchMode : uint8_t {
+            // Read without latching, must validate after reading.
+            OPTIMISTIC = 0,
+            SHARED,
+            EXCLUSIVE
+        };
+
+        /**
+        Hybrid latch, a reader writer latch with a version counter.
+
+        Exclusive holders make the version odd on lock and even again on
+        unlock, so optimistic readers only load the version before and after
+        reading and retry if it changed, they never write to the latch and
+        never block a writer. Shared mode is for readers that can not retry,
+        e.g when they hand out pointers into the page.
+         */
+        class HybridLatch {
+          public:
+            // Waits out a writer, returns the version to validate against.
+            uint64_t readOptimistic() const noexcept {
+                uint64_t version;
+                while ((version = m_version.load(std::memory_order_acquire)) &
+                       1) {
+                    std::this_thread::yield();
+                }
+                return version;
+            }
+
+            // True if no writer held the latch since readOptimistic.
+            bool validate(uint64_t version) const noexcept {
+                // Reads of the page are ordered before the version check.
+                std::atomic_thread_fence(std::memory_order_acquire);
+                return m_version.load(std::memory_order_relaxed) == version;
+            }
+
+            void lockShared() { m_mutex.lock_shared(); }
+
+            bool tryLockShared() { return m_mutex.try_lock_shared(); }
+
+            void unlockShared() { m_mutex.unlock_shared(); }
+
+            void lockExclusive() {
+                m_mutex.lock();
+                m_version.store(m_version.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+                // Page writes are ordered after the version turns odd.
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+
+            // For the buffer pool, which must not wait on a latch.
+            bool tryLockExclusive() {
+                if (!m_mutex.try_lock()) {
+                    return false;
+                }
+                m_version.store(m_version.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+                return true;
+            }
+
+            void unlockExclusive() {
+                m_version.store(m_version.load(std::memory_order_relaxed) + 1,
+                                std::memory_order_release);
+                m_mutex.unlock();
+            }
+
+            uint64_t getVersion() const noexcept {
+                return m_version.load(std::memory_order_acquire);
+            }
+
+          private:
+            // Odd while exclusively latched, only changed under m_mutex.
+            std::atomic_uint64_t m_version{0};
+            std::shared_mutex    m_mutex;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -37,6 +37,9 @@ namespace Pig {
                 // Okay to fail at allocation.
                 auto     n            = std::make_unique<Node>(std::move(e));
                 uint64_t pointerValue = reinterpret_cast<uint64_t>(n.get());
+                // Log before publishing, once pushed the node can be popped
+                // and freed by another thread.
+                SPDLOG_TRACE("Pushing {} to stack", n->m_val);
 
                 // get copy of top
                 uint64_t top = m_top;
@@ -61,8 +64,6 @@ namespace Pig {
                     n->m_prev = reinterpret_cast<Node *>(top & 0xFFFFFFFFFFFF);
                 }
 
-                spdlog::debug("Pushed {} to stack and prev is {}", e,
-                              n->m_prev == 0 ? 0 : n->m_prev->m_val);
                 n.release(); // Managed by stack now
             }
 
@@ -102,10 +103,7 @@ namespace Pig {
                 // we have popped, hence no allocation.
                 // Note that copy assignment cant throw here
                 *e = pointerValue->m_val;
-                spdlog::debug("Popped {} from stack and top is now {}", *e,
-                              pointerValue->m_prev == 0
-                                  ? 0
-                                  : pointerValue->m_prev->m_val);
+                SPDLOG_TRACE("Popped {} from stack", *e);
                 delete pointerValue;
                 return true;
             }
@@ -1,4 +1,5 @@
 // TDODO: remove this
+#include "buffer_pool.h"
 #include "disk-manager.h"
 #include "heap.h"
 #include <memory>
@@ -6,7 +7,9 @@
 int main() {
     std::shared_ptr<Pig::Core::DiskManager> diskManager =
         std::make_shared<Pig::Core::DiskManager>();
-    volatile auto x = Pig::Core::HeapFile::create(diskManager);
+    std::shared_ptr<Pig::Core::BufferPool> bufferPool =
+        std::make_shared<Pig::Core::BufferPool>(1024, diskManager);
+    volatile auto x = Pig::Core::HeapFile::create(diskManager, bufferPool);
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "metrics.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace Pig {
+    namespace Core {
+
+        namespace {
+            constexpr std::array<const char *,
+                                 static_cast<size_t>(Counter::NUM_COUNTERS)>
+                COUNTER_NAMES = {
+                    "buffer_pool_hits", "buffer_pool_misses",
+                    "buffer_pool_evictions", "disk_reads", "disk_read_bytes",
+                    "disk_writes", "disk_write_bytes", "heap_inserts",
+                    "heap_deletes", "page_compactions", "checkpoints",
+                    "checkpoint_pages", "plan_cache_hits",
+                    "plan_cache_misses", "zone_map_skipped_pages"};
+
+            constexpr std::array<const char *,
+                                 static_cast<size_t>(Histogram::NUM_HISTOGRAMS)>
+                HISTOGRAM_NAMES = {"buffer_pool_miss_latency_ns",
+                                   "heap_insert_latency_ns"};
+
+            // Value at quantile q from merged bucket counts.
+            uint64_t
+            valueAt(const std::array<uint64_t, Metrics::NUM_BUCKETS> &buckets,
+                    uint64_t count, double q) {
+                auto     rank = static_cast<uint64_t>(q * (count - 1)) + 1;
+                uint64_t seen = 0;
+                for (uint32_t b = 0; b < Metrics::NUM_BUCKETS; ++b) {
+                    seen += buckets[b];
+                    if (seen >= rank) {
+                        return Metrics::bucketLowerBound(b);
+                    }
+                }
+                return 0;
+            }
+        } // namespace
+
+        Metrics &Metrics::global() {
+            static Metrics metrics;
+            return metrics;
+        }
+
+        Metrics::Shard *Metrics::leaseShard() {
+            thread_local ShardLease lease;
+            return lease.m_shard;
+        }
+
+        Metrics::Shard *Metrics::acquireShard() {
+            std::lock_guard lk{m_shardsLock};
+            for (auto &shard : m_shards) {
+                if (!shard->m_owned.load(std::memory_order_acquire)) {
+                    shard->m_owned.store(true, std::memory_order_relaxed);
+                    return shard.get();
+                }
+            }
+            m_shards.push_back(std::make_unique<Shard>());
+            m_shards.back()->m_owned.store(true, std::memory_order_relaxed);
+            return m_shards.back().get();
+        }
+
+        MetricsSnapshot Metrics::snapshot() const {
+            MetricsSnapshot snap;
+            std::lock_guard lk{m_shardsLock};
+            for (const auto &shard : m_shards) {
+                for (size_t c = 0; c < snap.m_counters.size(); ++c) {
+                    snap.m_counters[c] +=
+                        shard->m_counters[c].load(std::memory_order_relaxed);
+                }
+            }
+
+            for (size_t h = 0; h < snap.m_histograms.size(); ++h) {
+                std::array<uint64_t, NUM_BUCKETS> merged{};
+                for (const auto &shard : m_shards) {
+                    for (uint32_t b = 0; b < NUM_BUCKETS; ++b) {
+                        merged[b] += shard->m_histograms[h][b].load(
+                            std::memory_order_relaxed);
+                    }
+                }
+
+                auto &summary = snap.m_histograms[h];
+                summary.m_min = std::numeric_limits<uint64_t>::max();
+                for (uint32_t b = 0; b < NUM_BUCKETS; ++b) {
+                    if (merged[b] == 0) {
+                        continue;
+                    }
+                    uint64_t value = bucketLowerBound(b);
+                    summary.m_count += merged[b];
+                    summary.m_sum += merged[b] * value;
+                    summary.m_min = std::min(summary.m_min, value);
+                    summary.m_max = std::max(summary.m_max, value);
+                }
+                if (summary.m_count == 0) {
+                    summary.m_min = 0;
+                    continue;
+                }
+                summary.m_p50  = valueAt(merged, summary.m_count, 0.5);
+                summary.m_p90  = valueAt(merged, summary.m_count, 0.9);
+                summary.m_p99  = valueAt(merged, summary.m_count, 0.99);
+                summary.m_p999 = valueAt(merged, summary.m_count, 0.999);
+            }
+            return snap;
+        }
+
+        void Metrics::reset() noexcept {
+            std::lock_guard lk{m_shardsLock};
+            for (auto &shard : m_shards) {
+                for (auto &c : shard->m_counters) {
+                    c.store(0, std::memory_order_relaxed);
+                }
+                for (auto &h : shard->m_histograms) {
+                    for (auto &b : h) {
+                        b.store(0, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+
+        double MetricsSnapshot::bufferPoolHitRatio() const {
+            uint64_t hits     = get(Counter::BUFFER_POOL_HITS);
+            uint64_t accesses = hits + get(Counter::BUFFER_POOL_MISSES);
+            return accesses == 0 ? 0 : static_cast<double>(hits) / accesses;
+        }
+
+        std::string MetricsSnapshot::toText() const {
+            fmt::memory_buffer out;
+            for (size_t c = 0; c < m_counters.size(); ++c) {
+                fmt::format_to(std::back_inserter(out), "{} {}\n",
+                               COUNTER_NAMES[c], m_counters[c]);
+            }
+            fmt::format_to(std::back_inserter(out),
+                           "buffer_pool_hit_ratio {:.4f}\n",
+                           bufferPoolHitRatio());
+            for (size_t h = 0; h < m_histograms.size(); ++h) {
+                const auto &s = m_histograms[h];
+                fmt::format_to(std::back_inserter(out),
+                               "{} count={} min={} p50={} p90={} p99={} "
+                               "p999={} max={}\n",
+                               HISTOGRAM_NAMES[h], s.m_count, s.m_min, s.m_p50,
+                               s.m_p90, s.m_p99, s.m_p999, s.m_max);
+            }
+            return fmt::to_string(out);
+        }
+
+        std::string MetricsSnapshot::toJson() const {
+            fmt::memory_buffer out;
+            fmt::format_to(std::back_inserter(out), "{{\"counters\":{{");
+            for (size_t c = 0; c < m_counters.size(); ++c) {
+                fmt::format_to(std::back_inserter(out), "{}\"{}\":{}",
+                               c == 0 ? "" : ",", COUNTER_NAMES[c],
+                               m_counters[c]);
+            }
+            fmt::format_to(std::back_inserter(out),
+                           "}},\"buffer_pool_hit_ratio\":{:.4f},"
+                           "\"histograms\":{{",
+                           bufferPoolHitRatio());
+            for (size_t h = 0; h < m_histograms.size(); ++h) {
+                const auto &s = m_histograms[h];
+                fmt::format_to(std::back_inserter(out),
+                               "{}\"{}\":{{\"count\":{},\"sum\":{},\"min\":{},"
+                               "\"p50\":{},\"p90\":{},\"p99\":{},\"p999\":{},"
+                               "\"max\":{}}}",
+                               h == 0 ? "" : ",", HISTOGRAM_NAMES[h], s.m_count,
+                               s.m_sum, s.m_min, s.m_p50, s.m_p90, s.m_p99,
+                               s.m_p999, s.m_max);
+            }
+            fmt::format_to(std::back_inserter(out), "}}}}");
+            return fmt::to_string(out);
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
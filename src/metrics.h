@@ -0,0 +1,258 @@
+#ifndef PIG_CORE_METRICS_H
+#define PIG_CORE_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        enum class Counter : uint8_t {
+            BUFFER_POOL_HITS = 0,
+            BUFFER_POOL_MISSES,
+            BUFFER_POOL_EVICTIONS,
+            DISK_READS,
+            DISK_READ_BYTES,
+            DISK_WRITES,
+            DISK_WRITE_BYTES,
+            HEAP_INSERTS,
+            HEAP_DELETES,
+            PAGE_COMPACTIONS,
+            CHECKPOINTS,
+            CHECKPOINT_PAGES,
+            PLAN_CACHE_HITS,
+            PLAN_CACHE_MISSES,
+            ZONE_MAP_SKIPPED_PAGES,
+            NUM_COUNTERS
+        };
+
+        enum class Histogram : uint8_t {
+            BUFFER_POOL_MISS_LATENCY = 0,
+            HEAP_INSERT_LATENCY,
+            NUM_HISTOGRAMS
+        };
+
+        /**
+            Point in time view of all metrics, summed over shards.
+            Histogram values are in nanoseconds.
+         */
+        struct MetricsSnapshot {
+            struct HistogramSummary {
+                uint64_t m_count = 0;
+                uint64_t m_sum   = 0;
+                uint64_t m_min   = 0;
+                uint64_t m_max   = 0;
+                uint64_t m_p50   = 0;
+                uint64_t m_p90   = 0;
+                uint64_t m_p99   = 0;
+                uint64_t m_p999  = 0;
+            };
+
+            std::array<uint64_t, static_cast<size_t>(Counter::NUM_COUNTERS)>
+                m_counters{};
+            std::array<HistogramSummary,
+                       static_cast<size_t>(Histogram::NUM_HISTOGRAMS)>
+                m_histograms{};
+
+            uint64_t get(Counter c) const {
+                return m_counters[static_cast<size_t>(c)];
+            }
+
+            const HistogramSummary &get(Histogram h) const {
+                return m_histograms[static_cast<size_t>(h)];
+            }
+
+            // Hits over all accesses, 0 if there was none.
+            double bufferPoolHitRatio() const;
+
+            std::string toText() const;
+
+            std::string toJson() const;
+        };
+
+        /**
+            Process wide counters and latency histograms of the storage engine.
+
+            Every thread owns a cache line aligned shard while it lives, so
+            recording is a plain load and store with no lock prefix or
+            contention. Shards of exited threads are reused by new threads
+            and keep their counts. Readers pay for it by summing all shards on
+            snapshot.
+
+            Histograms are log linear like HDR histograms, each power of 2 is
+            split in 16 buckets which bounds the error to ~6%.
+            Reading the clock costs more than the rest of recording, so
+            cheap operations only time every Nth call per thread.
+
+            Metrics can be turned off at runtime, and compiled out entirely
+            with PIGDB_NO_METRICS.
+         */
+        class Metrics {
+          public:
+            static constexpr uint32_t SUB_BUCKET_BITS = 4;
+            static constexpr uint32_t SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+            static constexpr uint32_t NUM_BUCKETS =
+                (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+            static Metrics &global();
+
+            void setEnabled(bool enabled) noexcept {
+                m_enabled.store(enabled, std::memory_order_relaxed);
+            }
+
+            bool isEnabled() const noexcept {
+#ifdef PIGDB_NO_METRICS
+                return false;
+#else
+                return m_enabled.load(std::memory_order_relaxed);
+#endif
+            }
+
+            void add(Counter c, uint64_t n = 1) noexcept {
+                if (isEnabled()) {
+                    increment(shard().m_counters[static_cast<size_t>(c)], n);
+                }
+            }
+
+            void record(Histogram h, uint64_t valueNs) noexcept {
+                if (isEnabled()) {
+                    increment(shard().m_histograms[static_cast<size_t>(h)]
+                                                  [bucketFor(valueNs)],
+                              1);
+                }
+            }
+
+            // True for every sampleEvery-th call on calling thread.
+            bool sample(uint32_t sampleEvery) noexcept {
+                return sampleEvery <= 1 ||
+                       shard().m_sampleTick++ % sampleEvery == 0;
+            }
+
+            MetricsSnapshot snapshot() const;
+
+            // Zeroes all metrics, racing writers may be partially lost.
+            void reset() noexcept;
+
+            static uint32_t bucketFor(uint64_t value) noexcept {
+                if (value < SUB_BUCKETS) {
+                    return static_cast<uint32_t>(value);
+                }
+                uint32_t msb   = 63 - __builtin_clzll(value);
+                uint32_t shift = msb - SUB_BUCKET_BITS;
+                return (shift + 1) * SUB_BUCKETS +
+                       static_cast<uint32_t>((value >> shift) &
+                                             (SUB_BUCKETS - 1));
+            }
+
+            // Smallest value that falls in bucket.
+            static uint64_t bucketLowerBound(uint32_t bucket) noexcept {
+                if (bucket < SUB_BUCKETS) {
+                    return bucket;
+                }
+                uint32_t shift = bucket / SUB_BUCKETS - 1;
+                return (static_cast<uint64_t>(SUB_BUCKETS) +
+                        bucket % SUB_BUCKETS)
+                       << shift;
+            }
+
+          private:
+            struct alignas(64) Shard {
+                std::array<std::atomic_uint64_t,
+                           static_cast<size_t>(Counter::NUM_COUNTERS)>
+                    m_counters{};
+                std::array<std::array<std::atomic_uint64_t, NUM_BUCKETS>,
+                           static_cast<size_t>(Histogram::NUM_HISTOGRAMS)>
+                    m_histograms{};
+                // Only touched by owner.
+                uint32_t         m_sampleTick = 0;
+                std::atomic_bool m_owned{false};
+            };
+
+            // Holds a shard for the lifetime of a thread.
+            struct ShardLease {
+                Shard *m_shard;
+
+                ShardLease() : m_shard{Metrics::global().acquireShard()} {}
+
+                ~ShardLease() {
+                    m_shard->m_owned.store(false, std::memory_order_release);
+                }
+            };
+
+            Metrics() = default;
+
+            // Single writer, so no need for an atomic read modify write.
+            static void increment(std::atomic_uint64_t &value,
+                                  uint64_t              n) noexcept {
+                value.store(value.load(std::memory_order_relaxed) + n,
+                            std::memory_order_relaxed);
+            }
+
+            // Plain pointer as a thread_local with a destructor is reached
+            // through a call that checks it is constructed on every use.
+            Shard &shard() noexcept {
+                if (t_shard == nullptr) [[unlikely]] {
+                    t_shard = leaseShard();
+                }
+                return *t_shard;
+            }
+
+            static Shard *leaseShard();
+
+            Shard *acquireShard();
+
+            static inline thread_local Shard *t_shard = nullptr;
+
+            std::atomic_bool m_enabled{true};
+
+            mutable std::mutex                  m_shardsLock;
+            std::vector<std::unique_ptr<Shard>> m_shards;
+        };
+
+        /**
+            Records time from construction to destruction in h for every
+            sampleEvery-th call on a thread, the clock is not read otherwise
+            or when metrics are disabled.
+         */
+        class ScopedLatency {
+          public:
+            explicit ScopedLatency(Histogram h,
+                                   uint32_t  sampleEvery = 1) noexcept
+                : m_histogram{h},
+                  m_enabled{Metrics::global().isEnabled() &&
+                            Metrics::global().sample(sampleEvery)} {
+                if (m_enabled) {
+                    m_start = std::chrono::steady_clock::now();
+                }
+            }
+
+            ScopedLatency(const ScopedLatency &)            = delete;
+            ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+            ~ScopedLatency() {
+                if (m_enabled) {
+                    auto elapsed = std::chrono::steady_clock::now() - m_start;
+                    Metrics::global().record(
+                        m_histogram,
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            elapsed)
+                            .count());
+                }
+            }
+
+          private:
+            const Histogram                       m_histogram;
+            const bool                            m_enabled;
+            std::chrono::steady_clock::time_point m_start;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#ifndef PIG_CORE_PAGE_TABLE_H
+#define PIG_CORE_PAGE_TABLE_H
+
+#include "util.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace Pig {
+
+    namespace Core {
+
+        /**
+            Maps buffer pool keys to frame ids for BufferPool.
+
+            It is an open addressing table with Robin Hood probing, keys and
+            frame ids are stored inline in a flat array of 16 byte entries, so
+            a hit is one hash and usually one cache line.
+            It is sized from the number of frames with load factor <= 0.5 and
+            hence only rehashes when the pool is resized.
+
+            Deletion uses backward shift so there are no tombstones and probe
+            lengths stay short under eviction churn.
+
+            Not thread safe, BufferPool guards it with its lock.
+         */
+        template <typename K, typename V> class PageTable {
+            static_assert(std::is_unsigned_v<K>, "K must be unsigned int");
+
+          public:
+            static constexpr K EMPTY_KEY = std::numeric_limits<K>::max();
+
+            explicit PageTable(size_t maxEntries = 0) { reserve(maxEntries); }
+
+            PageTable(const PageTable &)            = delete;
+            PageTable &operator=(const PageTable &) = delete;
+
+            /**
+                Makes room for maxEntries without further rehashing.
+                Never shrinks.
+             */
+            void reserve(size_t maxEntries) {
+                size_t capacity = MIN_CAPACITY;
+                while (capacity < maxEntries * 2) {
+                    capacity <<= 1;
+                }
+                if (capacity <= m_capacity) {
+                    return;
+                }
+
+                auto   oldEntries  = std::move(m_entries);
+                size_t oldCapacity = m_capacity;
+
+                m_entries  = std::make_unique<Entry[]>(capacity);
+                m_capacity = capacity;
+                m_mask     = capacity - 1;
+                m_shift    = 64 - log2(capacity);
+                m_size     = 0;
+                for (size_t i = 0; i < oldCapacity; ++i) {
+                    if (oldEntries[i].m_key != EMPTY_KEY) {
+                        insert(oldEntries[i].m_key, oldEntries[i].m_value);
+                    }
+                }
+            }
+
+            bool find(K key, V &value) const noexcept {
+                size_t   pos  = home(key);
+                uint32_t dist = 0;
+                while (true) {
+                    const Entry &e = m_entries[pos];
+                    // Robin Hood invariant: key would have displaced any
+                    // entry closer to its home, so we can stop early.
+                    if (e.m_key == EMPTY_KEY || e.m_dist < dist) {
+                        return false;
+                    }
+                    if (e.m_key == key) {
+                        value = e.m_value;
+                        return true;
+                    }
+                    pos = (pos + 1) & m_mask;
+                    ++dist;
+                }
+            }
+
+            // Key must not be present already.
+            void insert(K key, V value) {
+                PIG_ASSERT(key != EMPTY_KEY, "Can not insert reserved key");
+                PIG_ASSERT((m_size + 1) * 2 <= m_capacity,
+                           "Page table is over its load factor");
+
+                Entry  cur{key, value, 0};
+                size_t pos = home(key);
+                while (true) {
+                    Entry &e = m_entries[pos];
+                    if (e.m_key == EMPTY_KEY) {
+                        e = cur;
+                        ++m_size;
+                        return;
+                    }
+                    // Take from the rich, entries closer to home give up
+                    // their place.
+                    if (e.m_dist < cur.m_dist) {
+                        std::swap(e, cur);
+                    }
+                    pos = (pos + 1) & m_mask;
+                    ++cur.m_dist;
+                }
+            }
+
+            bool erase(K key) noexcept {
+                size_t   pos  = home(key);
+                uint32_t dist = 0;
+                while (true) {
+                    Entry &e = m_entries[pos];
+                    if (e.m_key == EMPTY_KEY || e.m_dist < dist) {
+                        return false;
+                    }
+                    if (e.m_key == key) {
+                        break;
+                    }
+                    pos = (pos + 1) & m_mask;
+                    ++dist;
+                }
+
+                // Shift following entries back till one is at its home.
+                size_t next = (pos + 1) & m_mask;
+                while (m_entries[next].m_key != EMPTY_KEY &&
+                       m_entries[next].m_dist > 0) {
+                    m_entries[pos] = m_entries[next];
+                    --m_entries[pos].m_dist;
+                    pos  = next;
+                    next = (next + 1) & m_mask;
+                }
+                m_entries[pos] = Entry{};
+                --m_size;
+                return true;
+            }
+
+            size_t size() const noexcept { return m_size; }
+
+            size_t capacity() const noexcept { return m_capacity; }
+
+          private:
+            static constexpr size_t MIN_CAPACITY = 16;
+
+            struct Entry {
+                K        m_key   = EMPTY_KEY;
+                V        m_value = V{};
+                uint32_t m_dist  = 0; // distance from home slot
+            };
+
+            static uint32_t log2(size_t n) {
+                uint32_t r = 0;
+                while (n >>= 1) {
+                    ++r;
+                }
+                return r;
+            }
+
+            // Fibonacci hashing, spreads io id in high bits and sequential
+            // page ids in low bits across the table.
+            size_t home(K key) const noexcept {
+                return static_cast<size_t>(
+                    (static_cast<uint64_t>(key) * 0x9E3779B97F4A7C15ull) >>
+                    m_shift);
+            }
+
+            std::unique_ptr<Entry[]> m_entries;
+            size_t                   m_capacity = 0;
+            size_t                   m_mask     = 0;
+            uint32_t                 m_shift    = 64;
+            size_t                   m_size     = 0;
+        };
+    } // namespace Core
+
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -0,0 +1,61 @@
+#ifndef PIG_CORE_SWIP_H
+#define PIG_CORE_SWIP_H
+
+#include "core.h"
+#include "util.h"
+#include <atomic>
+#include <cstdint>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Swizzlable reference from one page to another, e.g index node to its
+        child, stored inside the referencing page.
+
+        On disk it holds the page id. While the child is resident the buffer
+        pool swizzles it to the address of the frame, so following it skips
+        the page table and pool lock, see BufferPool::fix. It is unswizzled
+        before the child is evicted and whenever the parent is written out.
+
+        The low bit tells them apart as frames are aligned.
+        Code that moves or drops swips in a page must hold the page
+        exclusively and unswizzle them first, see BufferPool::unswizzle.
+         */
+        class Swip {
+          public:
+            explicit Swip(page_id_t pageId) : m_word{encode(pageId)} {}
+
+            Swip(const Swip &)            = delete;
+            Swip &operator=(const Swip &) = delete;
+
+            bool isSwizzled() const noexcept { return (load() & 1) == 0; }
+
+            // Only for unswizzled swips.
+            page_id_t getPageId() const noexcept {
+                uint64_t word = load();
+                PIG_ASSERT(word & 1, "Swip is swizzled");
+                return static_cast<page_id_t>(word >> 1);
+            }
+
+            static uint64_t encode(page_id_t pageId) noexcept {
+                return static_cast<uint64_t>(pageId) << 1 | 1;
+            }
+
+          private:
+            friend class BufferPool;
+
+            // Sequentially consistent, pairs with pin count of the frame.
+            uint64_t load() const noexcept { return m_word.load(); }
+
+            void store(uint64_t word) noexcept { m_word.store(word); }
+
+            std::atomic_uint64_t m_word;
+        };
+
+        static_assert(sizeof(Swip) == sizeof(uint64_t),
+                      "Swip must fit a page slot of 8 bytes");
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
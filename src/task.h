@@ -0,0 +1,216 @@
+#ifndef PIG_CORE_TASK_H
+#define PIG_CORE_TASK_H
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Lazily started coroutine returning T, e.g a page fetch that suspends
+        on a miss.
+
+        It starts when awaited and runs inline on the stack of the awaiter.
+        If it finishes without suspending, the awaiter carries on without
+        suspending either, so a loop awaiting tasks does not grow the stack
+        even where symmetric transfer is not compiled as a tail call, e.g
+        at -O0. Otherwise it resumes the awaiter when it finishes.
+        An exception escaping the coroutine is rethrown to the awaiter.
+        Top level tasks run on an EventLoop, see EventLoop::spawn.
+         */
+        template <typename T> class Task;
+
+        namespace Detail {
+            struct TaskPromiseBase {
+                struct FinalAwaiter {
+                    bool await_ready() const noexcept { return false; }
+
+                    template <typename Promise>
+                    std::coroutine_handle<>
+                    await_suspend(std::coroutine_handle<Promise> h) noexcept {
+                        auto &promise = h.promise();
+                        // Still inside start, which resumes the awaiter.
+                        if (promise.m_inline) {
+                            promise.m_finishedInline = true;
+                            return std::noop_coroutine();
+                        }
+                        auto continuation = promise.m_continuation;
+                        return continuation ? continuation
+                                            : std::noop_coroutine();
+                    }
+
+                    void await_resume() const noexcept {}
+                };
+
+                std::suspend_always initial_suspend() const noexcept {
+                    return {};
+                }
+
+                FinalAwaiter final_suspend() const noexcept { return {}; }
+
+                void unhandled_exception() noexcept {
+                    m_error = std::current_exception();
+                }
+
+                /**
+                    Runs the task till it suspends or finishes, true if it
+                    suspended, in which case it resumes awaiter when done.
+                    Tasks are only resumed by the thread of their loop, so
+                    it can not finish before this returns.
+                 */
+                template <typename Promise>
+                static bool start(std::coroutine_handle<Promise> task,
+                                  std::coroutine_handle<> awaiter) noexcept {
+                    auto &promise          = task.promise();
+                    promise.m_continuation = awaiter;
+                    promise.m_inline       = true;
+                    task.resume();
+                    promise.m_inline = false;
+                    return !promise.m_finishedInline;
+                }
+
+                std::coroutine_handle<> m_continuation;
+                std::exception_ptr      m_error;
+                bool                    m_inline         = false;
+                bool                    m_finishedInline = false;
+            };
+        } // namespace Detail
+
+        template <typename T> class [[nodiscard]] Task {
+          public:
+            struct promise_type : Detail::TaskPromiseBase {
+                Task get_return_object() noexcept {
+                    return Task(
+                        std::coroutine_handle<promise_type>::from_promise(
+                            *this));
+                }
+
+                template <typename U> void return_value(U &&value) {
+                    m_value.emplace(std::forward<U>(value));
+                }
+
+                std::optional<T> m_value;
+            };
+
+            Task(Task &&other) noexcept
+                : m_handle{std::exchange(other.m_handle, nullptr)} {}
+
+            Task &operator=(Task &&other) noexcept {
+                if (this != &other) {
+                    destroy();
+                    m_handle = std::exchange(other.m_handle, nullptr);
+                }
+                return *this;
+            }
+
+            Task(const Task &)            = delete;
+            Task &operator=(const Task &) = delete;
+
+            ~Task() { destroy(); }
+
+            auto operator co_await() && noexcept {
+                struct Awaiter {
+                    bool await_ready() const noexcept { return false; }
+
+                    bool
+                    await_suspend(std::coroutine_handle<> awaiter) noexcept {
+                        return Detail::TaskPromiseBase::start(m_handle,
+                                                              awaiter);
+                    }
+
+                    T await_resume() {
+                        auto &promise = m_handle.promise();
+                        if (promise.m_error) {
+                            std::rethrow_exception(promise.m_error);
+                        }
+                        return std::move(*promise.m_value);
+                    }
+
+                    std::coroutine_handle<promise_type> m_handle;
+                };
+                return Awaiter{m_handle};
+            }
+
+          private:
+            explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+                : m_handle{handle} {}
+
+            void destroy() noexcept {
+                if (m_handle) {
+                    m_handle.destroy();
+                    m_handle = nullptr;
+                }
+            }
+
+            std::coroutine_handle<promise_type> m_handle;
+        };
+
+        template <> class [[nodiscard]] Task<void> {
+          public:
+            struct promise_type : Detail::TaskPromiseBase {
+                Task get_return_object() noexcept {
+                    return Task(
+                        std::coroutine_handle<promise_type>::from_promise(
+                            *this));
+                }
+
+                void return_void() const noexcept {}
+            };
+
+            Task(Task &&other) noexcept
+                : m_handle{std::exchange(other.m_handle, nullptr)} {}
+
+            Task &operator=(Task &&other) noexcept {
+                if (this != &other) {
+                    destroy();
+                    m_handle = std::exchange(other.m_handle, nullptr);
+                }
+                return *this;
+            }
+
+            Task(const Task &)            = delete;
+            Task &operator=(const Task &) = delete;
+
+            ~Task() { destroy(); }
+
+            auto operator co_await() && noexcept {
+                struct Awaiter {
+                    bool await_ready() const noexcept { return false; }
+
+                    bool
+                    await_suspend(std::coroutine_handle<> awaiter) noexcept {
+                        return Detail::TaskPromiseBase::start(m_handle,
+                                                              awaiter);
+                    }
+
+                    void await_resume() {
+                        if (m_handle.promise().m_error) {
+                            std::rethrow_exception(m_handle.promise().m_error);
+                        }
+                    }
+
+                    std::coroutine_handle<promise_type> m_handle;
+                };
+                return Awaiter{m_handle};
+            }
+
+          private:
+            explicit Task(std::coroutine_handle<promise_type> handle) noexcept
+                : m_handle{handle} {}
+
+            void destroy() noexcept {
+                if (m_handle) {
+                    m_handle.destroy();
+                    m_handle = nullptr;
+                }
+            }
+
+            std::coroutine_handle<promise_type> m_handle;
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
@@ -0,0 +1,161 @@
+#include "task_scheduler.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace Pig {
+    namespace Core {
+
+        struct TaskScheduler::Job {
+            // Morsels [m_next, m_end) not taken yet, the owner takes from the
+            // front and thieves from the back.
+            struct Block {
+                std::mutex m_mutex;
+                size_t     m_next = 0;
+                size_t     m_end  = 0;
+            };
+
+            Job(size_t numMorsels, uint32_t numWorkers, const MorselFn &fn)
+                : m_fn{fn}, m_blocks{std::make_unique<Block[]>(numWorkers)},
+                  k_numBlocks{numWorkers}, m_pending{numMorsels} {
+                for (uint32_t w = 0; w < numWorkers; ++w) {
+                    m_blocks[w].m_next = numMorsels * w / numWorkers;
+                    m_blocks[w].m_end  = numMorsels * (w + 1) / numWorkers;
+                }
+            }
+
+            bool take(uint32_t worker, size_t &morsel) {
+                {
+                    Block           &own = m_blocks[worker];
+                    std::lock_guard lock(own.m_mutex);
+                    if (own.m_next < own.m_end) {
+                        morsel = own.m_next++;
+                        return true;
+                    }
+                }
+                for (uint32_t i = 1; i < k_numBlocks; ++i) {
+                    Block &victim = m_blocks[(worker + i) % k_numBlocks];
+                    std::lock_guard lock(victim.m_mutex);
+                    if (victim.m_next < victim.m_end) {
+                        morsel = --victim.m_end;
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            const MorselFn          &m_fn;
+            std::unique_ptr<Block[]> m_blocks;
+            const uint32_t           k_numBlocks;
+            std::atomic<size_t>      m_pending;
+            std::atomic<bool>        m_failed{false};
+
+            std::mutex              m_mutex;
+            std::condition_variable m_done;
+            std::exception_ptr      m_error;
+        };
+
+        TaskScheduler::TaskScheduler(uint32_t numWorkers, bool pinWorkers)
+            : k_numWorkers{std::max<uint32_t>(1, numWorkers)} {
+            for (uint32_t w = 0; w < k_numWorkers; ++w) {
+                m_workers.emplace_back([this, w] { run(w); });
+#if defined(__linux__)
+                if (pinWorkers) {
+                    cpu_set_t cpus;
+                    CPU_ZERO(&cpus);
+                    CPU_SET(w % defaultNumWorkers(), &cpus);
+                    pthread_setaffinity_np(m_workers.back().native_handle(),
+                                           sizeof(cpus), &cpus);
+                }
+#else
+                (void)pinWorkers;
+#endif
+            }
+        }
+
+        TaskScheduler::~TaskScheduler() {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stopping = true;
+            }
+            m_hasJobs.notify_all();
+            for (auto &worker : m_workers) {
+                worker.join();
+            }
+        }
+
+        uint32_t TaskScheduler::defaultNumWorkers() noexcept {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        void TaskScheduler::parallelFor(size_t numMorsels, const MorselFn &fn) {
+            if (numMorsels == 0) {
+                return;
+            }
+            // Not worth waking a worker for.
+            if (numMorsels == 1) {
+                fn(0, 0);
+                return;
+            }
+            auto job = std::make_shared<Job>(numMorsels, k_numWorkers, fn);
+            {
+                std::lock_guard lock(m_mutex);
+                m_jobs.push_back(job);
+            }
+            m_hasJobs.notify_all();
+
+            std::unique_lock lock(job->m_mutex);
+            job->m_done.wait(lock, [&job] { return job->m_pending == 0; });
+            if (job->m_error) {
+                std::rethrow_exception(job->m_error);
+            }
+        }
+
+        void TaskScheduler::run(uint32_t worker) {
+            std::unique_lock lock(m_mutex);
+            while (true) {
+                m_hasJobs.wait(
+                    lock, [this] { return m_stopping || !m_jobs.empty(); });
+                if (m_stopping) {
+                    return;
+                }
+                auto job = m_jobs.front();
+                lock.unlock();
+                work(*job, worker);
+                lock.lock();
+                // Every morsel is taken, workers done with their own move
+                // on to the next job.
+                if (!m_jobs.empty() && m_jobs.front() == job) {
+                    m_jobs.pop_front();
+                }
+            }
+        }
+
+        void TaskScheduler::work(Job &job, uint32_t worker) {
+            size_t morsel;
+            while (job.take(worker, morsel)) {
+                if (!job.m_failed.load(std::memory_order_relaxed)) {
+                    try {
+                        job.m_fn(worker, morsel);
+                    } catch (...) {
+                        std::lock_guard lock(job.m_mutex);
+                        if (!job.m_error) {
+                            job.m_error = std::current_exception();
+                        }
+                        job.m_failed.store(true, std::memory_order_relaxed);
+                    }
+                }
+                if (job.m_pending.fetch_sub(1, std::memory_order_acq_rel) ==
+                    1) {
+                    std::lock_guard lock(job.m_mutex);
+                    job.m_done.notify_all();
+                }
+            }
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
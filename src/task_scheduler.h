@@ -0,0 +1,77 @@
+#ifndef PIG_CORE_TASK_SCHEDULER_H
+#define PIG_CORE_TASK_SCHEDULER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        /**
+        Pool of worker threads running morsel driven jobs, shared by all the
+        queries of a database.
+
+        A job is a number of morsels, e.g ranges of 64 pages of a heap.
+        They are dealt to workers in contiguous blocks, so a worker reads
+        adjacent pages and its partial results stay in its cache. A worker
+        that runs out of its own steals from the end of the block of the
+        next busy worker, taking the morsels the owner would reach last.
+        Workers are pinned to cores when asked, so that with a block per
+        core the pages of a block stay on the socket that read them.
+
+        Several jobs may run at once, workers take them in arrival order.
+         */
+        class TaskScheduler {
+          public:
+            // Called with the worker index, below getNumWorkers, and the
+            // morsel.
+            using MorselFn = std::function<void(uint32_t, size_t)>;
+
+            explicit TaskScheduler(uint32_t numWorkers = defaultNumWorkers(),
+                                   bool     pinWorkers = false);
+
+            TaskScheduler(const TaskScheduler &)            = delete;
+            TaskScheduler &operator=(const TaskScheduler &) = delete;
+
+            ~TaskScheduler();
+
+            uint32_t getNumWorkers() const noexcept { return k_numWorkers; }
+
+            /**
+                Runs fn for every morsel in [0, numMorsels) once and returns
+                when all are done. The first exception thrown by fn is
+                rethrown here, morsels not started by then are skipped.
+                fn must not call parallelFor, the worker would wait on
+                morsels queued behind its own.
+             */
+            void parallelFor(size_t numMorsels, const MorselFn &fn);
+
+            static uint32_t defaultNumWorkers() noexcept;
+
+          private:
+            struct Job;
+
+            void run(uint32_t worker);
+
+            // Runs morsels of job till none are left to take.
+            void work(Job &job, uint32_t worker);
+
+            const uint32_t           k_numWorkers;
+            std::vector<std::thread> m_workers;
+
+            std::mutex                       m_mutex;
+            std::condition_variable          m_hasJobs;
+            std::deque<std::shared_ptr<Job>> m_jobs;
+            bool                             m_stopping{false};
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
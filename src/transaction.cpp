@@ -0,0 +1,69 @@
+#include "transaction.h"
+#include "heap.h"
+#include "util.h"
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+namespace Pig {
+    namespace Core {
+
+        WriteTransaction::WriteTransaction(
+            TransactionManager &manager,
+            std::unique_lock<std::mutex> writerLock, Snapshot snapshot)
+            : m_manager{&manager}, m_writerLock{std::move(writerLock)},
+              m_snapshot{snapshot} {}
+
+        WriteTransaction::~WriteTransaction() {
+            if (isActive()) {
+                abort();
+            }
+        }
+
+        void WriteTransaction::commit() {
+            PIG_ASSERT(isActive(), "Transaction is not active");
+            // Tuple writes happen before the counter is seen by readers.
+            m_manager->m_committed.store(getId(), std::memory_order_release);
+            m_undo.clear();
+            m_writerLock.unlock();
+        }
+
+        void WriteTransaction::abort() {
+            PIG_ASSERT(isActive(), "Transaction is not active");
+            // Undone before the id is handed to the next writer.
+            for (auto it = m_undo.rbegin(); it != m_undo.rend(); ++it) {
+                if (it->m_isInsert) {
+                    it->m_heap->undoInsert(it->m_tupleId);
+                } else {
+                    it->m_heap->undoDelete(it->m_tupleId);
+                }
+            }
+            m_undo.clear();
+            m_writerLock.unlock();
+        }
+
+        void WriteTransaction::onInsert(HeapFile      &heap,
+                                        const TupleId &tupleId) {
+            m_undo.push_back(UndoEntry{&heap, tupleId, true});
+        }
+
+        void WriteTransaction::onDelete(HeapFile      &heap,
+                                        const TupleId &tupleId) {
+            m_undo.push_back(UndoEntry{&heap, tupleId, false});
+        }
+
+        WriteTransaction TransactionManager::beginWrite() {
+            std::unique_lock lock(m_writerLock);
+            Snapshot         snapshot;
+            snapshot.m_committed = m_committed.load(std::memory_order_relaxed);
+            PIG_ASSERT(snapshot.m_committed < UINT32_MAX,
+                       "Transaction ids exhausted");
+            // Aborted ids are reused, their changes are undone by now.
+            snapshot.m_self = snapshot.m_committed + 1;
+            return WriteTransaction(*this, std::move(lock), snapshot);
+        }
+    } // namespace Core
+} // namespace Pig
\ No newline at end of file
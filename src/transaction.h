@@ -0,0 +1,126 @@
+#ifndef PIG_CORE_TRANSACTION_H
+#define PIG_CORE_TRANSACTION_H
+
+#include "core.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace Pig {
+    namespace Core {
+
+        class HeapFile;
+        class TransactionManager;
+
+        // As xmin the tuple is never visible(aborted insert), as xmax the
+        // tuple is not deleted.
+        constexpr txn_id_t INVALID_TXN_ID = 0;
+        // Committed before any snapshot, tuples written outside transactions.
+        constexpr txn_id_t FROZEN_TXN_ID = 1;
+
+        /**
+        What a transaction sees of the tuple versions.
+
+        There is a single writer at a time and it commits in id order, so
+        every id upto m_committed is committed and any later one is not.
+        This makes a snapshot a single id instead of an in progress list.
+         */
+        struct Snapshot {
+            txn_id_t m_committed = FROZEN_TXN_ID;
+            // The writer sees its own changes, INVALID_TXN_ID for readers.
+            txn_id_t m_self = INVALID_TXN_ID;
+
+            bool sees(txn_id_t id) const noexcept {
+                return id != INVALID_TXN_ID &&
+                       (id <= m_committed || id == m_self);
+            }
+
+            // Visible if the insert is seen and the delete is not.
+            bool isVisible(txn_id_t xmin, txn_id_t xmax) const noexcept {
+                return sees(xmin) && !sees(xmax);
+            }
+        };
+
+        /**
+        The writer transaction, holds the writer lock till commit or abort.
+
+        HeapFile records what the transaction changed, on abort inserts are
+        marked invisible and deletes are reverted before the next writer can
+        start. A transaction dropped without commit is aborted.
+         */
+        class WriteTransaction {
+          public:
+            WriteTransaction(WriteTransaction &&)            = default;
+            WriteTransaction &operator=(WriteTransaction &&) = delete;
+            ~WriteTransaction();
+
+            txn_id_t getId() const noexcept { return m_snapshot.m_self; }
+
+            const Snapshot &getSnapshot() const noexcept { return m_snapshot; }
+
+            bool isActive() const noexcept { return m_writerLock.owns_lock(); }
+
+            // Publishes all changes to snapshots taken after it.
+            void commit();
+
+            void abort();
+
+            // Called by HeapFile for each change to undo it on abort.
+            void onInsert(HeapFile &heap, const TupleId &tupleId);
+            void onDelete(HeapFile &heap, const TupleId &tupleId);
+
+          private:
+            friend class TransactionManager;
+
+            struct UndoEntry {
+                HeapFile *m_heap;
+                TupleId   m_tupleId;
+                bool      m_isInsert;
+            };
+
+            WriteTransaction(TransactionManager          &manager,
+                             std::unique_lock<std::mutex> writerLock,
+                             Snapshot                     snapshot);
+
+            TransactionManager          *m_manager;
+            std::unique_lock<std::mutex> m_writerLock;
+            Snapshot                     m_snapshot;
+            std::vector<UndoEntry>       m_undo;
+        };
+
+        /**
+        Hands out snapshots and the writer transaction.
+
+        The commit counter is the id of the last committed transaction.
+        Readers only load it, so they never block on or contend with the
+        writer, and the writer bumps it once per commit.
+         */
+        class TransactionManager {
+          public:
+            TransactionManager() = default;
+
+            TransactionManager(const TransactionManager &)            = delete;
+            TransactionManager &operator=(const TransactionManager &) = delete;
+
+            // Lock free, the snapshot stays valid for any number of reads.
+            Snapshot snapshot() const noexcept {
+                return Snapshot{m_committed.load(std::memory_order_acquire)};
+            }
+
+            // Blocks while another writer is active.
+            WriteTransaction beginWrite();
+
+            txn_id_t getCommitted() const noexcept {
+                return m_committed.load(std::memory_order_acquire);
+            }
+
+          private:
+            friend class WriteTransaction;
+
+            std::mutex            m_writerLock;
+            std::atomic<txn_id_t> m_committed{FROZEN_TXN_ID};
+        };
+    } // namespace Core
+} // namespace Pig
+
+#endif
\ No newline at end of file
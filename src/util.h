@@ -4,7 +4,6 @@
 #include "error.h"
 #include "fmt/core.h"
 #include "fmt/format.h"
-#include "xxhash.h" // Include the xxhash header
 #include <cstddef>
 #include <cstring>
 #include <iostream>
@@ -40,7 +39,7 @@ namespace Pig {
             Error read(uint64_t offset, iovec outBuffer) {
                 PIG_ASSERT(outBuffer.iov_base != nullptr,
                            "Read buffer sent to OwningIovec is null");
-                PIG_ASSERT(offset + outBuffer.iov_len < m_len,
+                PIG_ASSERT(offset + outBuffer.iov_len <= m_len,
                            "Attempt to read beyond OwningVec buffer");
                 memcpy(outBuffer.iov_base, m_base.get() + offset,
                        outBuffer.iov_len);
@@ -50,8 +49,8 @@ namespace Pig {
             Error write(uint64_t offset, iovec writeBuffer) {
                 PIG_ASSERT(writeBuffer.iov_base != nullptr,
                            "Write buffer sent to OwningIovec is null");
-                PIG_ASSERT(offset + writeBuffer.iov_len < m_len,
-                           "Attempt to read beyond OwningVec buffer");
+                PIG_ASSERT(offset + writeBuffer.iov_len <= m_len,
+                           "Attempt to write beyond OwningVec buffer");
                 memcpy(m_base.get() + offset, writeBuffer.iov_base,
                        writeBuffer.iov_len);
                 return EMPRY_ERR;
@@ -62,11 +61,6 @@ namespace Pig {
             size_t                           m_len;
         };
 
-        inline uint32_t calculateChecksum(iovec data) {
-            return XXH32(data.iov_base, data.iov_len,
-                         0); // 0 is the seed, change as needed
-        }
-
     } // namespace Core
 } // namespace Pig
 
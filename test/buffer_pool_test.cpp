@@ -0,0 +1,430 @@
+#include "buffer_pool.h"
+#include "buffer_pool_manager.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "event_loop.h"
+#include "metrics.h"
+#include "task.h"
+#include "util.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class BufferPoolTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    diskManager = std::make_shared<DiskManager>();
+    ioId = diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B);
+  }
+
+  // Writes the page id in first bytes of each page through the pool.
+  void writePages(BufferPool &pool) {
+    for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+      auto guard = pool.GetPage(ioId, p, LatchMode::EXCLUSIVE);
+      memcpy(guard.getRawPage().iov_base, &p, sizeof(p));
+      guard.markDirty();
+    }
+  }
+
+  void verifyPages(BufferPool &pool) {
+    for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+      auto guard = pool.GetPage(ioId, p);
+      page_id_t stored;
+      memcpy(&stored, guard.getRawPage().iov_base, sizeof(stored));
+      EXPECT_EQ(p, stored);
+    }
+  }
+
+  static constexpr page_id_t NUM_PAGES = 64;
+  std::shared_ptr<DiskManager> diskManager;
+  IoId_t ioId;
+};
+
+TEST_F(BufferPoolTest, EvictsAndFlushesDirtyPages) {
+  BufferPool pool(8, diskManager);
+  writePages(pool);
+  verifyPages(pool);
+  EXPECT_EQ(8u, pool.getNumFrames());
+}
+
+TEST_F(BufferPoolTest, RandomEvictionKeepsPages) {
+  BufferPool pool(8, diskManager, PAGE_SIZE_B, EvictionPolicy::RANDOM);
+  writePages(pool);
+  verifyPages(pool);
+
+  // Falls back to the one unpinned frame when probes miss it.
+  BufferPool small(2, diskManager, PAGE_SIZE_B, EvictionPolicy::RANDOM);
+  auto pinned = small.GetPage(ioId, 0);
+  for (page_id_t p = 1; p < NUM_PAGES; ++p) {
+    small.GetPage(ioId, p);
+  }
+}
+
+TEST_F(BufferPoolTest, AllPinnedFails) {
+  BufferPool pool(1, diskManager);
+  auto guard = pool.GetPage(ioId, 0);
+  BufferPool::BufferPoolPageGuard other;
+  EXPECT_EQ(ERR_NO_FREE_FRAME,
+            pool.getPage(ioId, 1, LatchMode::SHARED, other).code());
+  EXPECT_FALSE(other.holdsPage());
+  EXPECT_THROW(pool.GetPage(ioId, 1), std::runtime_error);
+}
+
+TEST_F(BufferPoolTest, RejectsBadFiles) {
+  BufferPool pool(2, diskManager);
+  IoId_t large = diskManager->registerFile(4 * 16 * 1024, 16 * 1024);
+  BufferPool::BufferPoolPageGuard guard;
+  EXPECT_EQ(ERR_INVALID_ARG,
+            pool.getPage(large, 0, LatchMode::SHARED, guard).code());
+  EXPECT_FALSE(guard.holdsPage());
+  EXPECT_EQ(ERR_INVALID_ARG,
+            pool.getPage(MAX_TABLES, 0, LatchMode::SHARED, guard).code());
+  EXPECT_FALSE(pool.getPage(ioId, 0, LatchMode::SHARED, guard));
+}
+
+TEST_F(BufferPoolTest, GrowAndShrinkOnline) {
+  BufferPool pool(4, diskManager);
+  writePages(pool);
+
+  EXPECT_FALSE(pool.resize(NUM_PAGES));
+  EXPECT_EQ(NUM_PAGES, pool.getNumFrames());
+  verifyPages(pool);
+
+  // Shrinking evicts pages but keeps their contents on disk.
+  EXPECT_FALSE(pool.resize(2));
+  EXPECT_EQ(2u, pool.getNumFrames());
+  verifyPages(pool);
+}
+
+TEST_F(BufferPoolTest, ShrinkStopsAtPinnedFrames) {
+  BufferPool pool(4, diskManager);
+  auto first = pool.GetPage(ioId, 0);
+  auto second = pool.GetPage(ioId, 1);
+
+  auto err = pool.resize(0);
+  EXPECT_TRUE(err);
+  EXPECT_EQ(ERR_NO_FREE_FRAME, err.code());
+  EXPECT_EQ(2u, pool.getNumFrames());
+}
+
+TEST_F(BufferPoolTest, GuardIsMovable) {
+  BufferPool pool(1, diskManager);
+  auto guard = pool.GetPage(ioId, 0, LatchMode::EXCLUSIVE);
+  auto moved = std::move(guard);
+  EXPECT_FALSE(guard.holdsPage());
+  EXPECT_TRUE(moved.holdsPage());
+  EXPECT_EQ(LatchMode::EXCLUSIVE, moved.getMode());
+
+  // Releasing unpins, so the only frame can be reused.
+  moved.release();
+  EXPECT_FALSE(moved.holdsPage());
+  auto other = pool.GetPage(ioId, 1);
+  EXPECT_TRUE(other.holdsPage());
+}
+
+TEST_F(BufferPoolTest, OptimisticReadFailsAfterWrite) {
+  BufferPool pool(4, diskManager);
+  auto reader = pool.GetPage(ioId, 0, LatchMode::OPTIMISTIC);
+  EXPECT_TRUE(reader.validate());
+  {
+    // Optimistic readers do not hold writers off.
+    auto writer = pool.GetPage(ioId, 0, LatchMode::EXCLUSIVE);
+    writer.markDirty();
+  }
+  EXPECT_FALSE(reader.validate());
+
+  auto again = pool.GetPage(ioId, 0, LatchMode::OPTIMISTIC);
+  EXPECT_TRUE(again.validate());
+}
+
+TEST_F(BufferPoolTest, ExclusiveLatchWaitsForSharedReaders) {
+  BufferPool pool(4, diskManager);
+  std::atomic_bool written{false};
+  auto reader = pool.GetPage(ioId, 0, LatchMode::SHARED);
+  std::thread writer([&] {
+    auto guard = pool.GetPage(ioId, 0, LatchMode::EXCLUSIVE);
+    written = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  EXPECT_FALSE(written);
+  reader.release();
+  writer.join();
+  EXPECT_TRUE(written);
+}
+
+TEST_F(BufferPoolTest, ConcurrentMissesLoadPageOnce) {
+  // Fewer frames than pages, so pages are evicted dirty and read back while
+  // other threads miss on them.
+  BufferPool pool(5, diskManager);
+  pool.enablePageChecksums(ioId, 4);
+  writePages(pool);
+  constexpr page_id_t PAGES = 8;
+  constexpr int THREADS = 4;
+  constexpr int INCREMENTS = 20000;
+  auto counter = [](BufferPool::BufferPoolPageGuard &guard) {
+    return static_cast<unsigned char *>(guard.getRawPage().iov_base) +
+           PAGE_SIZE_B / 2;
+  };
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < INCREMENTS; ++i) {
+        auto guard = pool.GetPage(ioId, (t + i) % PAGES, LatchMode::EXCLUSIVE);
+        uint64_t count;
+        memcpy(&count, counter(guard), sizeof(count));
+        ++count;
+        memcpy(counter(guard), &count, sizeof(count));
+        guard.markDirty();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  uint64_t total = 0;
+  for (page_id_t p = 0; p < PAGES; ++p) {
+    auto guard = pool.GetPage(ioId, p);
+    uint64_t count;
+    memcpy(&count, counter(guard), sizeof(count));
+    total += count;
+  }
+  EXPECT_EQ(uint64_t{THREADS} * INCREMENTS, total);
+}
+
+TEST_F(BufferPoolTest, SwipIsSwizzledWhileChildIsResident) {
+  BufferPool pool(2, diskManager);
+  constexpr size_t swipOffset = 8;
+  {
+    // Page 0 references page 1.
+    auto parent = pool.GetPage(ioId, 0, LatchMode::EXCLUSIVE);
+    new (static_cast<unsigned char *>(parent.getRawPage().iov_base) +
+         swipOffset) Swip(1);
+    parent.markDirty();
+  }
+  // Only pinned, so that eviction can unswizzle.
+  auto parent = pool.GetPage(ioId, 0, LatchMode::OPTIMISTIC);
+  auto swip = reinterpret_cast<Swip *>(
+      static_cast<unsigned char *>(parent.getRawPage().iov_base) + swipOffset);
+  EXPECT_FALSE(swip->isSwizzled());
+  BufferPool::BufferPoolPageGuard child;
+  ASSERT_FALSE(pool.fix(parent, ioId, *swip, LatchMode::SHARED, child));
+  EXPECT_TRUE(child.holdsPage());
+  EXPECT_TRUE(swip->isSwizzled());
+  child.release();
+  ASSERT_FALSE(pool.fix(parent, ioId, *swip, LatchMode::SHARED, child));
+  EXPECT_TRUE(child.holdsPage());
+  child.release();
+
+  // Disk keeps the page id.
+  EXPECT_FALSE(pool.flushPage(ioId, 0));
+  std::vector<unsigned char> onDisk(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = onDisk.data();
+  buf.iov_len = PAGE_SIZE_B;
+  EXPECT_FALSE(diskManager->read(ioId, 0, buf));
+  uint64_t word;
+  memcpy(&word, onDisk.data() + swipOffset, sizeof(word));
+  EXPECT_EQ(Swip::encode(1), word);
+
+  // Evicting the child turns the swip back to a page id.
+  { auto other = pool.GetPage(ioId, 2); }
+  EXPECT_FALSE(swip->isSwizzled());
+  EXPECT_EQ(1, swip->getPageId());
+  ASSERT_FALSE(pool.fix(parent, ioId, *swip, LatchMode::SHARED, child));
+  EXPECT_TRUE(child.holdsPage());
+}
+
+TEST(BufferPoolManagerTest, AssignsFilesToNamedPools) {
+  auto diskManager = std::make_shared<DiskManager>();
+  BufferPoolManager manager(diskManager);
+
+  EXPECT_FALSE(manager.createPool("index", 4));
+  EXPECT_FALSE(manager.createPool("heap", 16, 16 * 1024));
+  EXPECT_EQ(ERR_ALREADY_EXISTS, manager.createPool("heap", 16).code());
+
+  IoId_t indexFile = diskManager->registerFile(4 * PAGE_SIZE_B);
+  IoId_t heapFile = diskManager->registerFile(4 * 16 * 1024, 16 * 1024);
+
+  EXPECT_FALSE(manager.assign(indexFile, "index"));
+  EXPECT_FALSE(manager.assign(heapFile, "heap"));
+  EXPECT_EQ(ERR_INVALID_ARG, manager.assign(indexFile, "heap").code());
+  EXPECT_EQ(ERR_NOT_FOUND, manager.assign(indexFile, "missing").code());
+
+  EXPECT_EQ(manager.getPool("index"), manager.getPoolFor(indexFile));
+  EXPECT_EQ(manager.getPool("heap"), manager.getPoolFor(heapFile));
+  EXPECT_EQ(16 * 1024u, manager.getPoolFor(heapFile)->getPageSize());
+
+  EXPECT_FALSE(manager.resizePool("heap", 32));
+  EXPECT_EQ(32u, manager.getPool("heap")->getNumFrames());
+
+  // Other pools, also ones created later, refuse assigned files.
+  EXPECT_FALSE(manager.createPool("cold", 4));
+  BufferPool::BufferPoolPageGuard guard;
+  for (const char *name : {"heap", "cold"}) {
+    EXPECT_EQ(ERR_INVALID_ARG,
+              manager.getPool(name)
+                  ->getPage(indexFile, 0, LatchMode::SHARED, guard)
+                  .code());
+  }
+  EXPECT_FALSE(manager.getPoolFor(indexFile)->getPage(
+      indexFile, 0, LatchMode::SHARED, guard));
+}
+
+// Overwrites the second half of a page on disk as a crash mid write would.
+void tearPage(DiskManager &diskManager, IoId_t ioId, page_id_t p) {
+  std::vector<unsigned char> page(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = page.data();
+  buf.iov_len = PAGE_SIZE_B;
+  ASSERT_FALSE(diskManager.read(ioId, p * PAGE_SIZE_B, buf));
+  memset(page.data() + PAGE_SIZE_B / 2, 0xAB, PAGE_SIZE_B / 2);
+  ASSERT_FALSE(diskManager.write(ioId, p * PAGE_SIZE_B, buf));
+}
+
+TEST_F(BufferPoolTest, ChecksumCatchesTornPage) {
+  BufferPool pool(2, diskManager);
+  pool.enablePageChecksums(ioId, 4);
+  writePages(pool);
+  tearPage(*diskManager, ioId, 1);
+
+  BufferPool::BufferPoolPageGuard torn;
+  EXPECT_EQ(ERR_CORRUPTED,
+            pool.getPage(ioId, 1, LatchMode::SHARED, torn).code());
+  auto guard = pool.GetPage(ioId, 2);
+  page_id_t stored;
+  memcpy(&stored, guard.getRawPage().iov_base, sizeof(stored));
+  EXPECT_EQ(2, stored);
+}
+
+TEST_F(BufferPoolTest, DoubleWriteRestoresTornPage) {
+  BufferPool pool(2, diskManager);
+  pool.enablePageChecksums(ioId, 4);
+  pool.enableDoubleWrite(8);
+  {
+    auto guard = pool.GetPage(ioId, 1, LatchMode::EXCLUSIVE);
+    memset(guard.getRawPage().iov_base, 7, PAGE_SIZE_B);
+    guard.markDirty();
+  }
+  ASSERT_FALSE(pool.flushPage(ioId, 1));
+  tearPage(*diskManager, ioId, 1);
+  // Evict the page, it is clean so it is not written again.
+  for (page_id_t p : {2, 3}) {
+    auto guard = pool.GetPage(ioId, p);
+  }
+
+  auto guard = pool.GetPage(ioId, 1);
+  auto page = static_cast<unsigned char *>(guard.getRawPage().iov_base);
+  EXPECT_EQ(7, page[0]);
+  EXPECT_EQ(7, page[PAGE_SIZE_B - 1]);
+}
+
+TEST_F(BufferPoolTest, RecoveryRewritesTornPages) {
+  BufferPool pool(NUM_PAGES, diskManager);
+  pool.enablePageChecksums(ioId, 4);
+  pool.enableDoubleWrite(4);
+  writePages(pool);
+  auto dirty = pool.getDirtyPages();
+  ASSERT_FALSE(pool.flushPages(dirty.data(), dirty.size()));
+  // The last batch is pages 60-63.
+  tearPage(*diskManager, ioId, NUM_PAGES - 1);
+
+  ASSERT_FALSE(pool.recoverTornPages());
+  std::vector<unsigned char> page(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = page.data();
+  buf.iov_len = PAGE_SIZE_B;
+  ASSERT_FALSE(diskManager->read(ioId, (NUM_PAGES - 1) * PAGE_SIZE_B, buf));
+  EXPECT_TRUE(verifyPageChecksum(buf, 4));
+}
+
+TEST_F(BufferPoolTest, AsyncFetchesOverlapMisses) {
+  BufferPool pool(16, diskManager);
+  writePages(pool);
+  EXPECT_FALSE(pool.resize(0));
+  EXPECT_FALSE(pool.resize(NUM_PAGES));
+  diskManager->setReadLatency(std::chrono::milliseconds(20));
+
+  // Every fetch misses, all of them are read in the same 20ms.
+  EventLoop loop;
+  std::vector<page_id_t> stored(NUM_PAGES);
+  for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+    loop.spawn([](BufferPool &pool, IoId_t ioId, page_id_t p,
+                  page_id_t &stored) -> Task<void> {
+      BufferPool::BufferPoolPageGuard guard;
+      EXPECT_FALSE(
+          co_await pool.getPageAsync(ioId, p, LatchMode::SHARED, guard));
+      memcpy(&stored, guard.getRawPage().iov_base, sizeof(stored));
+    }(pool, ioId, p, stored[p]));
+  }
+  auto start = std::chrono::steady_clock::now();
+  loop.run();
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(20 * NUM_PAGES / 4));
+  for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+    EXPECT_EQ(p, stored[p]);
+  }
+
+  // Hits do not suspend.
+  loop.spawn([](BufferPool &pool, IoId_t ioId) -> Task<void> {
+    BufferPool::BufferPoolPageGuard guard;
+    EXPECT_FALSE(
+        co_await pool.getPageAsync(ioId, 3, LatchMode::EXCLUSIVE, guard));
+    EXPECT_EQ(0u, EventLoop::current()->getNumInFlight());
+  }(pool, ioId));
+  loop.run();
+}
+
+TEST_F(BufferPoolTest, AsyncMissesOnSamePageReadItOnce) {
+  BufferPool pool(4, diskManager);
+  writePages(pool);
+  EXPECT_FALSE(pool.resize(0));
+  EXPECT_FALSE(pool.resize(4));
+  diskManager->setReadLatency(std::chrono::milliseconds(5));
+
+  uint64_t reads = Metrics::global().snapshot().get(Counter::DISK_READS);
+  EventLoop loop;
+  std::vector<page_id_t> stored(4);
+  for (auto &s : stored) {
+    loop.spawn([](BufferPool &pool, IoId_t ioId,
+                  page_id_t &stored) -> Task<void> {
+      BufferPool::BufferPoolPageGuard guard;
+      EXPECT_FALSE(
+          co_await pool.getPageAsync(ioId, 7, LatchMode::SHARED, guard));
+      memcpy(&stored, guard.getRawPage().iov_base, sizeof(stored));
+    }(pool, ioId, s));
+  }
+  loop.run();
+  for (page_id_t s : stored) {
+    EXPECT_EQ(7, s);
+  }
+  EXPECT_EQ(reads + 1, Metrics::global().snapshot().get(Counter::DISK_READS));
+}
+
+TEST_F(BufferPoolTest, AsyncFetchReturnsError) {
+  BufferPool pool(1, diskManager);
+  auto pinned = pool.GetPage(ioId, 0);
+  EventLoop loop;
+  loop.spawn([](BufferPool &pool, IoId_t ioId) -> Task<void> {
+    BufferPool::BufferPoolPageGuard guard;
+    Error err = co_await pool.getPageAsync(ioId, 1, LatchMode::SHARED, guard);
+    EXPECT_EQ(ERR_NO_FREE_FRAME, err.code());
+    EXPECT_FALSE(guard.holdsPage());
+  }(pool, ioId));
+  loop.run();
+}
+
+} // namespace Core
+} // namespace Pig
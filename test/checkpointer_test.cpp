@@ -0,0 +1,110 @@
+#include "buffer_pool.h"
+#include "checkpointer.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "metrics.h"
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class CheckpointerTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Metrics::global().setEnabled(true);
+    Metrics::global().reset();
+    diskManager = std::make_shared<DiskManager>();
+    ioId = diskManager->registerFile(NUM_PAGES * PAGE_SIZE_B);
+    pool = std::make_shared<BufferPool>(NUM_PAGES, diskManager);
+  }
+
+  void writePage(page_id_t p, uint32_t value) {
+    auto guard = pool->GetPage(ioId, p, LatchMode::EXCLUSIVE);
+    memcpy(guard.getRawPage().iov_base, &value, sizeof(value));
+    guard.markDirty();
+  }
+
+  uint32_t readFromDisk(page_id_t p) {
+    std::vector<unsigned char> page(PAGE_SIZE_B);
+    iovec buf;
+    buf.iov_base = page.data();
+    buf.iov_len = PAGE_SIZE_B;
+    EXPECT_FALSE(diskManager->read(ioId, p * PAGE_SIZE_B, buf));
+    uint32_t value;
+    memcpy(&value, page.data(), sizeof(value));
+    return value;
+  }
+
+  static constexpr page_id_t NUM_PAGES = 16;
+  std::shared_ptr<DiskManager> diskManager;
+  IoId_t ioId;
+  std::shared_ptr<BufferPool> pool;
+};
+
+TEST_F(CheckpointerTest, DirtyPageTableKeepsFirstChange) {
+  writePage(5, 1);
+  writePage(2, 1);
+  lsn_t afterFirst = pool->getCurrentLsn();
+  writePage(5, 2);
+
+  auto dirty = pool->getDirtyPages();
+  ASSERT_EQ(2u, dirty.size());
+  EXPECT_EQ(2, dirty[0].m_pageId);
+  EXPECT_EQ(5, dirty[1].m_pageId);
+  EXPECT_LT(dirty[1].m_recLsn, dirty[0].m_recLsn);
+  EXPECT_EQ(afterFirst, pool->getCurrentLsn());
+}
+
+TEST_F(CheckpointerTest, WritesAdjacentPagesTogether) {
+  for (page_id_t p : {4, 3, 5, 9}) {
+    writePage(p, p + 100);
+  }
+  Checkpointer checkpointer(pool);
+  ASSERT_FALSE(checkpointer.checkpoint());
+
+  EXPECT_TRUE(pool->getDirtyPages().empty());
+  for (page_id_t p : {3, 4, 5, 9}) {
+    EXPECT_EQ(p + 100u, readFromDisk(p));
+  }
+  auto metrics = Metrics::global().snapshot();
+  // Pages 3-5 in one write and 9 in another.
+  EXPECT_EQ(2u, metrics.get(Counter::DISK_WRITES));
+  EXPECT_EQ(4u, metrics.get(Counter::CHECKPOINT_PAGES));
+  EXPECT_EQ(pool->getCurrentLsn() + 1, checkpointer.getCheckpointLsn());
+}
+
+TEST_F(CheckpointerTest, BackgroundCheckpointsAreRateLimited) {
+  for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+    writePage(p, p);
+  }
+  CheckpointerOptions options;
+  options.m_interval = std::chrono::milliseconds(1);
+  options.m_pagesPerSecond = 200;
+  options.m_batchPages = 4;
+  Checkpointer checkpointer(pool, options);
+
+  auto start = std::chrono::steady_clock::now();
+  checkpointer.start();
+  while (checkpointer.getCheckpointLsn() == 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  checkpointer.stop();
+
+  // 16 pages at 200 per second.
+  EXPECT_GE(elapsed, std::chrono::milliseconds(80));
+  EXPECT_TRUE(pool->getDirtyPages().empty());
+  for (page_id_t p = 0; p < NUM_PAGES; ++p) {
+    EXPECT_EQ(p, readFromDisk(p));
+  }
+}
+
+} // namespace Core
+} // namespace Pig
@@ -0,0 +1,104 @@
+#include "buffer_pool.h"
+#include "checksum.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/uio.h>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class ChecksumTest : public ::testing::TestWithParam<ChecksumType> {};
+
+TEST(ChecksumTest, Crc32cMatchesReference) {
+  const char *data = "123456789";
+  iovec buf;
+  buf.iov_base = const_cast<char *>(data);
+  buf.iov_len = strlen(data);
+  EXPECT_EQ(0xE3069283u, calculateChecksum(buf, ChecksumType::CRC32C));
+}
+
+TEST_P(ChecksumTest, BatchMatchesSingle) {
+  // Lengths that are not multiples of 8 and differ within a batch.
+  std::vector<std::vector<unsigned char>> payloads;
+  for (size_t len = 0; len < 67; ++len) {
+    payloads.emplace_back(len);
+    for (size_t i = 0; i < len; ++i) {
+      payloads.back()[i] = static_cast<unsigned char>(len * 31 + i);
+    }
+  }
+  std::vector<iovec> bufs;
+  for (auto &payload : payloads) {
+    bufs.push_back(iovec{payload.data(), payload.size()});
+  }
+
+  std::vector<uint32_t> checksums(bufs.size());
+  calculateChecksums(bufs.data(), bufs.size(), GetParam(), checksums.data());
+  for (size_t i = 0; i < bufs.size(); ++i) {
+    EXPECT_EQ(calculateChecksum(bufs[i], GetParam()), checksums[i]);
+  }
+}
+
+TEST_P(ChecksumTest, PageChecksumSkipsItself) {
+  std::vector<unsigned char> page(PAGE_SIZE_B, 3);
+  iovec buf{page.data(), page.size()};
+  setPageChecksum(buf, 8, GetParam());
+  EXPECT_TRUE(verifyPageChecksum(buf, 8, GetParam()));
+
+  page[PAGE_SIZE_B - 1] ^= 1;
+  EXPECT_FALSE(verifyPageChecksum(buf, 8, GetParam()));
+}
+
+TEST_P(ChecksumTest, HeapFileVerifiesWithItsType) {
+  auto diskManager = std::make_shared<DiskManager>();
+  auto pool = std::make_shared<BufferPool>(64, diskManager);
+  auto heap =
+      HeapFile::create(diskManager, pool, PAGE_SIZE_B, 32, GetParam());
+  EXPECT_EQ(GetParam(), heap->getHeader().m_checksum);
+
+  std::vector<uint64_t> values(1000);
+  std::vector<iovec> tuples;
+  for (size_t i = 0; i < values.size(); ++i) {
+    values[i] = i;
+    tuples.push_back(iovec{&values[i], sizeof(values[i])});
+  }
+  std::vector<TupleId> ids(tuples.size());
+  ASSERT_FALSE(heap->addTuples(tuples.data(), tuples.size(), ids.data()));
+  EXPECT_FALSE(heap->verify());
+
+  std::vector<unsigned char> payload;
+  ASSERT_FALSE(heap->getTuple(ids[999], payload));
+  uint64_t value;
+  memcpy(&value, payload.data(), sizeof(value));
+  EXPECT_EQ(999u, value);
+
+  {
+    // Flip a bit of the payload behind the heap's back.
+    auto guard = pool->GetPage(heap->getIoId(),
+                               HeapFile::RESERVED_PAGES + ids[999].first,
+                               LatchMode::EXCLUSIVE);
+    auto page = static_cast<unsigned char *>(guard.getRawPage().iov_base);
+    auto found = std::search(page, page + PAGE_SIZE_B, payload.begin(),
+                             payload.end());
+    ASSERT_NE(page + PAGE_SIZE_B, found);
+    *found ^= 1;
+    guard.markDirty();
+  }
+  auto err = heap->verify();
+  ASSERT_TRUE(err);
+  EXPECT_EQ(ERR_CORRUPTED, err.code());
+}
+
+INSTANTIATE_TEST_SUITE_P(AllTypes, ChecksumTest,
+                         ::testing::Values(ChecksumType::XXHASH32,
+                                           ChecksumType::XXHASH3,
+                                           ChecksumType::CRC32C));
+
+} // namespace Core
+} // namespace Pig
@@ -0,0 +1,275 @@
+#include "pigdb/db.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+
+class DbTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    DatabaseOptions options;
+    options.m_poolFrames = 64;
+    options.m_pagesPerTable = 8;
+    options.m_planCacheSize = 4;
+    ASSERT_TRUE(Database::open(options, db).ok());
+    ASSERT_TRUE(
+        db->execute("CREATE TABLE t (id INT PRIMARY KEY, a INT, b INT)").ok());
+  }
+
+  void insert(int32_t id, int32_t a, int32_t b) {
+    auto status = db->execute("INSERT INTO t VALUES (" + std::to_string(id) +
+                              ", " + std::to_string(a) + ", " +
+                              std::to_string(b) + ")");
+    ASSERT_TRUE(status.ok()) << status.message();
+  }
+
+  std::vector<int64_t> column(const ResultSet &result, size_t col) {
+    std::vector<int64_t> values;
+    for (size_t row = 0; row < result.getNumRows(); ++row) {
+      values.push_back(result.get(row, col));
+    }
+    return values;
+  }
+
+  std::unique_ptr<Database> db;
+};
+
+TEST_F(DbTest, CreateInsertSelect) {
+  insert(1, 10, 100);
+  insert(2, 20, 200);
+
+  ResultSet result;
+  ASSERT_TRUE(db->execute("select * from t where id = 2;", result).ok());
+  ASSERT_EQ(1u, result.getNumRows());
+  EXPECT_EQ((std::vector<std::string>{"id", "a", "b"}), result.getColumns());
+  EXPECT_EQ(2, result.get(0, 0));
+  EXPECT_EQ(20, result.get(0, 1));
+  EXPECT_EQ(200, result.get(0, 2));
+
+  ASSERT_TRUE(db->execute("SELECT b, id FROM t", result).ok());
+  EXPECT_EQ((std::vector<std::string>{"b", "id"}), result.getColumns());
+  EXPECT_EQ(2u, result.getNumRows());
+
+  ASSERT_TRUE(db->execute("SELECT * FROM t WHERE id = 3", result).ok());
+  EXPECT_EQ(0u, result.getNumRows());
+}
+
+TEST_F(DbTest, WhereOnKeyAndOtherColumns) {
+  for (int32_t id = 0; id < 10; ++id) {
+    insert(id, id % 3, -id);
+  }
+  ResultSet result;
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE id < 3", result).ok());
+  EXPECT_EQ((std::vector<int64_t>{0, 1, 2}), column(result, 0));
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE id >= 8", result).ok());
+  EXPECT_EQ((std::vector<int64_t>{8, 9}), column(result, 0));
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE id <> 5", result).ok());
+  EXPECT_EQ(9u, result.getNumRows());
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE a = 2", result).ok());
+  EXPECT_EQ(3u, result.getNumRows());
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE b <= -7", result).ok());
+  EXPECT_EQ(3u, result.getNumRows());
+}
+
+TEST_F(DbTest, Aggregates) {
+  ResultSet result;
+  ASSERT_TRUE(
+      db->execute("SELECT COUNT(*), SUM(a), MIN(b), MAX(b) FROM t", result)
+          .ok());
+  EXPECT_EQ((std::vector<std::string>{"COUNT(*)", "SUM(a)", "MIN(b)",
+                                      "MAX(b)"}),
+            result.getColumns());
+  ASSERT_EQ(1u, result.getNumRows());
+  EXPECT_EQ(0, result.get(0, 0));
+  EXPECT_EQ(0, result.get(0, 2));
+
+  for (int32_t id = 0; id < 100; ++id) {
+    insert(id, INT32_MAX, id % 10 - 5);
+  }
+  ASSERT_TRUE(db->execute("select count(a), sum(a), min(b), max(b) from t "
+                          "where b >= 0",
+                          result)
+                  .ok());
+  EXPECT_EQ(50, result.get(0, 0));
+  // Sums do not overflow 32 bits.
+  EXPECT_EQ(50LL * INT32_MAX, result.get(0, 1));
+  EXPECT_EQ(0, result.get(0, 2));
+  EXPECT_EQ(4, result.get(0, 3));
+
+  // Through the index.
+  ASSERT_TRUE(
+      db->execute("SELECT COUNT(*), MAX(id) FROM t WHERE id < 30", result)
+          .ok());
+  EXPECT_EQ(30, result.get(0, 0));
+  EXPECT_EQ(29, result.get(0, 1));
+
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR,
+            db->execute("SELECT id, COUNT(*) FROM t", result).code());
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR,
+            db->execute("SELECT SUM(*) FROM t", result).code());
+  EXPECT_EQ(StatusCode::NOT_FOUND,
+            db->execute("SELECT MIN(c) FROM t", result).code());
+}
+
+TEST(DbScanTest, ParallelScanMatchesSerial) {
+  std::unique_ptr<Database> dbs[2];
+  for (uint32_t threads : {1u, 4u}) {
+    DatabaseOptions options;
+    options.m_pagesPerTable = 256;
+    options.m_scanThreads = threads;
+    options.m_morselPages = 8;
+    auto &db = dbs[threads == 1 ? 0 : 1];
+    ASSERT_TRUE(Database::open(options, db).ok());
+    ASSERT_TRUE(db->execute("CREATE TABLE t (id INT PRIMARY KEY, a INT)").ok());
+    Statement insert;
+    ASSERT_TRUE(db->prepare("INSERT INTO t VALUES (?, ?)", insert).ok());
+    ResultSet result;
+    for (int32_t id = 0; id < 20000; ++id) {
+      ASSERT_TRUE(insert.bind(0, id).ok());
+      ASSERT_TRUE(insert.bind(1, (id * 7919) % 1000).ok());
+      ASSERT_TRUE(insert.execute(result).ok());
+    }
+  }
+
+  for (const char *sql :
+       {"SELECT * FROM t WHERE a < 100", "SELECT id FROM t WHERE a = 7",
+        "SELECT COUNT(*), SUM(a), MIN(id), MAX(id) FROM t WHERE a > 500"}) {
+    ResultSet serial;
+    ResultSet parallel;
+    ASSERT_TRUE(dbs[0]->execute(sql, serial).ok());
+    ASSERT_TRUE(dbs[1]->execute(sql, parallel).ok());
+    ASSERT_GT(serial.getNumRows(), 0u);
+    ASSERT_EQ(serial.getNumRows(), parallel.getNumRows()) << sql;
+    for (size_t row = 0; row < serial.getNumRows(); ++row) {
+      for (size_t col = 0; col < serial.getColumns().size(); ++col) {
+        ASSERT_EQ(serial.get(row, col), parallel.get(row, col)) << sql;
+      }
+    }
+  }
+}
+
+TEST_F(DbTest, PreparedStatementsBindParams) {
+  Statement insertStmt;
+  ASSERT_TRUE(db->prepare("INSERT INTO t VALUES (?, ?, 7)", insertStmt).ok());
+  EXPECT_EQ(2u, insertStmt.getNumParams());
+  ResultSet result;
+  EXPECT_EQ(StatusCode::INVALID_ARG, insertStmt.execute(result).code());
+  for (int32_t id = 0; id < 100; ++id) {
+    ASSERT_TRUE(insertStmt.bind(0, id).ok());
+    ASSERT_TRUE(insertStmt.bind(1, id * 2).ok());
+    ASSERT_TRUE(insertStmt.execute(result).ok());
+  }
+  EXPECT_EQ(StatusCode::INVALID_ARG, insertStmt.bind(2, 0).code());
+
+  Statement select;
+  ASSERT_TRUE(db->prepare("SELECT a, b FROM t WHERE id = ?", select).ok());
+  for (int32_t id = 0; id < 100; ++id) {
+    ASSERT_TRUE(select.bind(0, id).ok());
+    ASSERT_TRUE(select.execute(result).ok());
+    ASSERT_EQ(1u, result.getNumRows());
+    EXPECT_EQ(id * 2, result.get(0, 0));
+    EXPECT_EQ(7, result.get(0, 1));
+  }
+  EXPECT_EQ(StatusCode::INVALID_ARG,
+            db->execute("SELECT * FROM t WHERE id = ?", result).code());
+}
+
+TEST_F(DbTest, PlansAreCached) {
+  ResultSet result;
+  ASSERT_TRUE(db->execute("SELECT * FROM t WHERE id = 1", result).ok());
+  ASSERT_TRUE(db->execute("SELECT * FROM t WHERE id = 1", result).ok());
+  EXPECT_EQ(1u, db->getNumCachedPlans());
+
+  // Prepared statements share plans with ad-hoc ones.
+  Statement statement;
+  ASSERT_TRUE(db->prepare("SELECT * FROM t WHERE id = 1", statement).ok());
+  EXPECT_EQ(1u, db->getNumCachedPlans());
+
+  // The cache holds upto 4 plans, statements keep theirs when it is full.
+  for (int32_t id = 2; id < 10; ++id) {
+    ASSERT_TRUE(db->execute("SELECT * FROM t WHERE id = " +
+                                std::to_string(id),
+                            result)
+                    .ok());
+    EXPECT_LE(db->getNumCachedPlans(), 4u);
+  }
+  insert(1, 2, 3);
+  ASSERT_TRUE(statement.execute(result).ok());
+  EXPECT_EQ(1u, result.getNumRows());
+}
+
+TEST_F(DbTest, Errors) {
+  ResultSet result;
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR, db->execute("DROP TABLE t").code());
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR,
+            db->execute("SELECT * FROM t WHERE", result).code());
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR,
+            db->execute("INSERT INTO t VALUES (1, 2, 99999999999)").code());
+  EXPECT_EQ(StatusCode::SYNTAX_ERROR,
+            db->execute("SELECT * FROM t garbage", result).code());
+  EXPECT_EQ(StatusCode::NOT_FOUND,
+            db->execute("SELECT * FROM u", result).code());
+  EXPECT_EQ(StatusCode::NOT_FOUND,
+            db->execute("SELECT c FROM t", result).code());
+  EXPECT_EQ(StatusCode::INVALID_ARG,
+            db->execute("INSERT INTO t VALUES (1, 2)").code());
+  EXPECT_EQ(StatusCode::INVALID_ARG,
+            db->execute("CREATE TABLE u (a INT, b INT)").code());
+  EXPECT_EQ(StatusCode::ALREADY_EXISTS,
+            db->execute("CREATE TABLE t (id INT PRIMARY KEY)").code());
+
+  insert(1, 2, 3);
+  EXPECT_EQ(StatusCode::ALREADY_EXISTS,
+            db->execute("INSERT INTO t VALUES (1, 5, 6)").code());
+  ASSERT_TRUE(db->execute("SELECT a FROM t WHERE id = 1", result).ok());
+  EXPECT_EQ(2, result.get(0, 0));
+}
+
+TEST_F(DbTest, FullTableRejectsInserts) {
+  Statement statement;
+  ASSERT_TRUE(db->prepare("INSERT INTO t VALUES (?, 0, 0)", statement).ok());
+  ResultSet result;
+  int32_t id = 0;
+  for (;; ++id) {
+    ASSERT_TRUE(statement.bind(0, id).ok());
+    auto status = statement.execute(result);
+    if (!status.ok()) {
+      EXPECT_EQ(StatusCode::INVALID_ARG, status.code());
+      break;
+    }
+  }
+  ASSERT_TRUE(db->execute("SELECT id FROM t", result).ok());
+  EXPECT_EQ(static_cast<size_t>(id), result.getNumRows());
+}
+
+TEST_F(DbTest, ReadersRunWithWriters) {
+  std::thread writer([this] {
+    Statement statement;
+    ASSERT_TRUE(db->prepare("INSERT INTO t VALUES (?, ?, 0)", statement).ok());
+    ResultSet result;
+    for (int32_t id = 0; id < 500; ++id) {
+      ASSERT_TRUE(statement.bind(0, id).ok());
+      ASSERT_TRUE(statement.bind(1, id).ok());
+      ASSERT_TRUE(statement.execute(result).ok());
+    }
+  });
+  Statement select;
+  ASSERT_TRUE(db->prepare("SELECT a FROM t WHERE id = ?", select).ok());
+  ResultSet result;
+  for (int32_t id = 0; id < 500; ++id) {
+    ASSERT_TRUE(select.bind(0, id).ok());
+    ASSERT_TRUE(select.execute(result).ok());
+    if (result.getNumRows() == 1) {
+      EXPECT_EQ(id, result.get(0, 0));
+    }
+  }
+  writer.join();
+  ASSERT_TRUE(db->execute("SELECT id FROM t WHERE id >= 0", result).ok());
+  EXPECT_EQ(500u, result.getNumRows());
+}
+
+} // namespace Pig
@@ -0,0 +1,81 @@
+#include "core.h"
+#include "disk-manager.h"
+#include "event_loop.h"
+#include "task.h"
+#include <chrono>
+#include <cstring>
+#include <gtest/gtest.h>
+#include <memory>
+#include <stdexcept>
+#include <sys/uio.h>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+Task<int> square(int value) { co_return value * value; }
+
+Task<int> countSquares(int count) {
+  int sum = 0;
+  for (int i = 0; i < count; ++i) {
+    sum += co_await square(1);
+  }
+  co_return sum;
+}
+
+TEST(EventLoopTest, RunsNestedTasks) {
+  EventLoop loop;
+  int result = 0;
+  loop.spawn([](int &result) -> Task<void> {
+    // Deep enough to overflow the stack if every await nested a frame.
+    result = co_await countSquares(1000000);
+  }(result));
+  loop.run();
+  EXPECT_EQ(1000000, result);
+}
+
+TEST(EventLoopTest, ReadsCompleteWhenDue) {
+  auto diskManager = std::make_shared<DiskManager>();
+  auto id = diskManager->registerFile(4 * PAGE_SIZE_B);
+  std::vector<unsigned char> page(PAGE_SIZE_B, 7);
+  iovec buffer{page.data(), page.size()};
+  ASSERT_FALSE(diskManager->write(id, PAGE_SIZE_B, buffer));
+  diskManager->setReadLatency(std::chrono::milliseconds(5));
+
+  EventLoop loop;
+  std::vector<int> order;
+  for (int t = 0; t < 3; ++t) {
+    loop.spawn([](DiskManager &diskManager, IoId_t id, int t,
+                  std::vector<int> &order) -> Task<void> {
+      std::vector<unsigned char> read(PAGE_SIZE_B);
+      iovec buffer{read.data(), read.size()};
+      EXPECT_FALSE(co_await diskManager.readAsync(id, PAGE_SIZE_B, buffer));
+      EXPECT_EQ(7, read[0]);
+      order.push_back(t);
+    }(*diskManager, id, t, order));
+  }
+  EXPECT_EQ(nullptr, EventLoop::current());
+  loop.run();
+  EXPECT_EQ((std::vector<int>{0, 1, 2}), order);
+}
+
+TEST(EventLoopTest, RethrowsAfterOtherTasksFinish) {
+  EventLoop loop;
+  bool finished = false;
+  loop.spawn([]() -> Task<void> {
+    co_await square(1);
+    throw std::runtime_error("task");
+  }());
+  loop.spawn([](bool &finished) -> Task<void> {
+    co_await square(2);
+    finished = true;
+  }(finished));
+  EXPECT_THROW(loop.run(), std::runtime_error);
+  EXPECT_TRUE(finished);
+  // Usable afterwards.
+  loop.spawn([]() -> Task<void> { co_return; }());
+  loop.run();
+}
+
+} // namespace Core
+} // namespace Pig
@@ -11,6 +11,7 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <string>
 #include <sys/uio.h> // For iovec
 #include <vector>
 
@@ -111,4 +112,208 @@ TEST(PageTest, AddTuplesTillFull) {
   // Attempt to add one more tuple, expect an assertion failure (optional)
   // Note: Since PIG_ASSERT uses assert, it will terminate the program.
   // Therefore, we won't attempt to add another tuple here.
-}
\ No newline at end of file
+}
+
+TEST(PageTest, GetTupleAfterAdd) {
+  HeapFile::Page page = getEmptyPage(7);
+
+  const char *first = "first";
+  const char *second = "second tuple";
+  iovec payload;
+  payload.iov_base = const_cast<char *>(first);
+  payload.iov_len = strlen(first);
+  EXPECT_EQ(0, page.addTuple(HeapFile::Tuple(1, payload)));
+  payload.iov_base = const_cast<char *>(second);
+  payload.iov_len = strlen(second);
+  EXPECT_EQ(1, page.addTuple(HeapFile::Tuple(2, payload)));
+
+  HeapFile::Tuple t0 = page.getTuple(0);
+  EXPECT_EQ(1u, t0.m_checksum);
+  EXPECT_EQ(std::string(first),
+            std::string(static_cast<char *>(t0.m_payload.iov_base),
+                        t0.m_payload.iov_len));
+
+  HeapFile::Tuple t1 = page.getTuple(1);
+  EXPECT_EQ(2u, t1.m_checksum);
+  EXPECT_EQ(std::string(second),
+            std::string(static_cast<char *>(t1.m_payload.iov_base),
+                        t1.m_payload.iov_len));
+}
+
+TEST(PageTest, HeaderIsWrittenToBuffer) {
+  iovec buf;
+  std::vector<unsigned char> mem(PAGE_SIZE_B);
+  buf.iov_base = mem.data();
+  buf.iov_len = PAGE_SIZE_B;
+
+  HeapFile::Page page(3);
+  page.initPage(buf);
+
+  uint32_t value = 42;
+  iovec payload;
+  payload.iov_base = &value;
+  payload.iov_len = sizeof(value);
+  page.addTuple(HeapFile::Tuple(0, payload));
+
+  // A page rebuilt from the same buffer sees the new tuple.
+  HeapFile::Page reread(3, buf);
+  EXPECT_EQ(1, reread.getNumSlots());
+  EXPECT_EQ(page.getFreeBytes(), reread.getFreeBytes());
+  EXPECT_EQ(value,
+            *static_cast<uint32_t *>(reread.getTuple(0).m_payload.iov_base));
+}
+
+TEST(PageTest, RemovedSlotIsReused) {
+  std::vector<unsigned char> mem(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = mem.data();
+  buf.iov_len = PAGE_SIZE_B;
+  HeapFile::Page page(3);
+  page.initPage(buf);
+
+  uint32_t value = 0;
+  iovec payload;
+  payload.iov_base = &value;
+  payload.iov_len = sizeof(value);
+  for (value = 0; value < 3; ++value) {
+    page.addTuple(HeapFile::Tuple(0, payload));
+  }
+  page.removeTuple(1);
+  EXPECT_FALSE(page.hasTuple(1));
+  EXPECT_TRUE(page.hasTuple(2));
+  EXPECT_EQ(1, page.getFreeSlots());
+
+  // The removed slot survives a reread of the page.
+  HeapFile::Page reread(3, buf);
+  EXPECT_EQ(1, reread.getFreeSlots());
+
+  value = 7;
+  page_size_t freeBytes = page.getFreeBytes();
+  EXPECT_EQ(1, page.addTuple(HeapFile::Tuple(0, payload)));
+  EXPECT_EQ(3, page.getNumSlots());
+  EXPECT_EQ(0, page.getFreeSlots());
+  EXPECT_EQ(freeBytes - HeapFile::Page::spaceForTuple(
+                            HeapFile::Tuple(0, payload)) +
+                HeapFile::Page::SLOT_BYTES,
+            page.getFreeBytes());
+  EXPECT_EQ(7u, *static_cast<uint32_t *>(page.getTuple(1).m_payload.iov_base));
+}
+
+TEST(PageTest, CompactReclaimsRemovedTuples) {
+  std::vector<unsigned char> mem(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = mem.data();
+  buf.iov_len = PAGE_SIZE_B;
+  HeapFile::Page page(3);
+  page.initPage(buf);
+
+  // Tuples of different lengths so that moved ones have to be realigned.
+  std::vector<std::string> values = {"a", "bbbbb", "cc", "ddddddddd", "e"};
+  for (auto &value : values) {
+    iovec payload;
+    payload.iov_base = value.data();
+    payload.iov_len = value.size();
+    page.addTuple(HeapFile::Tuple(0, payload));
+  }
+  page_size_t full = page.getFreeBytes();
+  EXPECT_EQ(0, page.compact());
+
+  page.removeTuple(1);
+  page.removeTuple(4);
+  page_size_t reclaimed = page.compact();
+  // Both tuples and the slot at the end come back.
+  EXPECT_EQ(HeapFile::Page::alignedLength(
+                HeapFile::Page::TUPLE_HEADER_BYTES + 5) +
+                HeapFile::Page::alignedLength(
+                    HeapFile::Page::TUPLE_HEADER_BYTES + 1) +
+                HeapFile::Page::SLOT_BYTES,
+            reclaimed);
+  EXPECT_EQ(full + reclaimed, page.getFreeBytes());
+  EXPECT_EQ(4, page.getNumSlots());
+  EXPECT_EQ(1, page.getFreeSlots());
+
+  for (PageSlot slot : {0, 2, 3}) {
+    auto t = page.getTuple(slot);
+    EXPECT_EQ(values[slot],
+              std::string(static_cast<char *>(t.m_payload.iov_base),
+                          t.m_payload.iov_len));
+  }
+
+  // New tuples go in the reclaimed bytes without touching the others.
+  HeapFile::Page reread(3, buf);
+  std::string value = "fff";
+  iovec payload;
+  payload.iov_base = value.data();
+  payload.iov_len = value.size();
+  EXPECT_EQ(1, reread.addTuple(HeapFile::Tuple(0, payload)));
+  EXPECT_EQ(4, reread.addTuple(HeapFile::Tuple(0, payload)));
+  auto t = reread.getTuple(3);
+  EXPECT_EQ(values[3], std::string(static_cast<char *>(t.m_payload.iov_base),
+                                   t.m_payload.iov_len));
+}
+
+TEST(PageTest, TornSlotEntryIsRejected) {
+  std::vector<unsigned char> mem(PAGE_SIZE_B);
+  iovec buf;
+  buf.iov_base = mem.data();
+  buf.iov_len = PAGE_SIZE_B;
+  HeapFile::Page page(3);
+  page.initPage(buf);
+  uint32_t value = 42;
+  iovec payload;
+  payload.iov_base = &value;
+  payload.iov_len = sizeof(value);
+  page.addTuple(HeapFile::Tuple(0, payload));
+  ASSERT_TRUE(page.tryGetTuple(0));
+  EXPECT_FALSE(page.tryGetTuple(1));
+
+  // Entries an optimistic reader can see while the slot is rewritten.
+  auto setEntry = [&](uint32_t entry) {
+    memcpy(mem.data() + HeapFile::Page::HEADER_BYTES, &entry, sizeof(entry));
+  };
+  uint32_t tupleEnd = HeapFile::Page::freeBytesFor(PAGE_SIZE_B);
+  for (uint32_t entry :
+       {0u, 8u << 16 | 4, (tupleEnd - 8) << 16 | 16, 10u << 16 | 16}) {
+    setEntry(entry);
+    EXPECT_FALSE(page.tryGetTuple(0)) << entry;
+  }
+  setEntry((tupleEnd - 16) << 16 | 16);
+  EXPECT_TRUE(page.tryGetTuple(0));
+}
+
+class PageSizeTest : public ::testing::TestWithParam<page_size_t> {};
+
+TEST_P(PageSizeTest, AddTuplesTillFull) {
+  page_size_t pageSize = GetParam();
+  std::vector<unsigned char> mem(pageSize);
+  iovec buf;
+  buf.iov_base = mem.data();
+  buf.iov_len = pageSize;
+
+  HeapFile::Page page(1, pageSize);
+  page.initPage(buf);
+  EXPECT_EQ(HeapFile::Page::freeBytesFor(pageSize), page.getFreeBytes());
+
+  uint32_t value = 0;
+  iovec payload;
+  payload.iov_base = &value;
+  payload.iov_len = sizeof(value);
+  HeapFile::Tuple tuple(0, payload);
+
+  size_t maxTuples =
+      page.getFreeBytes() / HeapFile::Page::spaceForTuple(tuple);
+  for (value = 0; value < maxTuples; ++value) {
+    EXPECT_EQ(value, page.addTuple(tuple));
+  }
+  EXPECT_LT(page.getFreeBytes(), HeapFile::Page::spaceForTuple(tuple));
+
+  // Tuples do not overlap each other or the slot array.
+  for (uint32_t slot = 0; slot < maxTuples; ++slot) {
+    EXPECT_EQ(slot,
+              *static_cast<uint32_t *>(page.getTuple(slot).m_payload.iov_base));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(AllPageSizes, PageSizeTest,
+                         ::testing::Values(4 * 1024, 8 * 1024, 16 * 1024,
+                                           32 * 1024, 64 * 1024));
@@ -0,0 +1,218 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class HeapTest : public ::testing::Test {
+protected:
+  void SetUp() override { create(0); }
+
+  void create(uint16_t zoneMapColumns) {
+    auto diskManager = std::make_shared<DiskManager>();
+    auto pool = std::make_shared<BufferPool>(
+        NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+    heap = HeapFile::create(diskManager, pool, PAGE_SIZE_B, NUM_PAGES,
+                            ChecksumType::XXHASH3, zoneMapColumns);
+  }
+
+  // Adds count tuples with values from first, in as few pages as possible.
+  std::vector<TupleId> fill(size_t count, uint32_t first = 0) {
+    std::vector<uint32_t> values(count);
+    std::vector<iovec> tuples(count);
+    for (size_t i = 0; i < count; ++i) {
+      values[i] = first + i;
+      tuples[i].iov_base = &values[i];
+      tuples[i].iov_len = sizeof(values[i]);
+    }
+    std::vector<TupleId> ids(count);
+    EXPECT_FALSE(heap->addTuples(tuples.data(), count, ids.data()));
+    return ids;
+  }
+
+  uint32_t get(const TupleId &id) {
+    std::vector<unsigned char> payload;
+    EXPECT_FALSE(heap->getTuple(id, payload));
+    uint32_t value = 0;
+    memcpy(&value, payload.data(), sizeof(value));
+    return value;
+  }
+
+  static constexpr page_id_t NUM_PAGES = 4;
+  static constexpr size_t TUPLES_PER_PAGE =
+      HeapFile::Page::FREE_BYTES /
+      (HeapFile::Page::alignedLength(HeapFile::Page::TUPLE_HEADER_BYTES +
+                                     sizeof(uint32_t)) +
+       HeapFile::Page::SLOT_BYTES);
+  std::unique_ptr<HeapFile> heap;
+};
+
+TEST_F(HeapTest, DeleteMakesSpaceForInserts) {
+  auto ids = fill(NUM_PAGES * TUPLES_PER_PAGE);
+  EXPECT_FALSE(heap->deleteTuple(ids[5]));
+  EXPECT_EQ(ERR_NOT_FOUND, heap->deleteTuple(ids[5]).code());
+
+  // The heap is full but for the deleted tuple, the free space map has to
+  // know its page has space again.
+  uint32_t value = 42;
+  iovec tuple;
+  tuple.iov_base = &value;
+  tuple.iov_len = sizeof(value);
+  TupleId id;
+  ASSERT_FALSE(heap->addTuple(tuple, id));
+  EXPECT_EQ(ids[5], id);
+  EXPECT_EQ(42u, get(id));
+  EXPECT_EQ(6u, get(ids[6]));
+}
+
+TEST_F(HeapTest, ViewedPageIsNotCompacted) {
+  auto ids = fill(4);
+  ASSERT_EQ(ids[0].first, ids[3].first);
+
+  HeapFile::TupleView view;
+  ASSERT_FALSE(heap->viewTuple(ids[3], view));
+  const unsigned char *data = view.data();
+  EXPECT_FALSE(heap->deleteTuple(ids[2]));
+  EXPECT_EQ(data, view.data());
+  EXPECT_EQ(3u, *reinterpret_cast<const uint32_t *>(view.data()));
+  view.release();
+
+  // Compacted by the next delete, ids do not change.
+  EXPECT_FALSE(heap->deleteTuple(ids[0]));
+  EXPECT_EQ(1u, get(ids[1]));
+  EXPECT_EQ(3u, get(ids[3]));
+  ASSERT_FALSE(heap->viewTuple(ids[3], view));
+  EXPECT_NE(data, view.data());
+}
+
+TEST_F(HeapTest, ReadersSeeTuplesMovedByCompaction) {
+  // Fill all pages but the first, so that every insert goes there.
+  fill((NUM_PAGES - 1) * TUPLES_PER_PAGE);
+
+  // Deleting the oldest tuple moves up every newer one, all of value 7.
+  std::atomic_bool stop{false};
+  std::thread writer([&] {
+    uint32_t value = 7;
+    iovec tuple;
+    tuple.iov_base = &value;
+    tuple.iov_len = sizeof(value);
+    std::deque<TupleId> live;
+    for (int i = 0; i < 5000; ++i) {
+      TupleId id;
+      EXPECT_FALSE(heap->addTuple(tuple, id));
+      EXPECT_EQ(0, id.first);
+      live.push_back(id);
+      if (live.size() > 3) {
+        EXPECT_FALSE(heap->deleteTuple(live.front()));
+        live.pop_front();
+      }
+    }
+    stop = true;
+  });
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 2; ++r) {
+    readers.emplace_back([&] {
+      std::vector<unsigned char> payload;
+      while (!stop) {
+        for (PageSlot slot = 0; slot < 4; ++slot) {
+          if (!heap->getTuple(TupleId{0, slot}, payload)) {
+            uint32_t value;
+            memcpy(&value, payload.data(), sizeof(value));
+            EXPECT_EQ(7u, value);
+          }
+        }
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+}
+
+TEST_F(HeapTest, ZoneMapsSkipPages) {
+  create(1);
+  // Pages fill in order, one insert at a time as well as in batches.
+  std::vector<TupleId> ids;
+  for (uint32_t v = 0; v < TUPLES_PER_PAGE; ++v) {
+    iovec tuple;
+    tuple.iov_base = &v;
+    tuple.iov_len = sizeof(v);
+    TupleId id;
+    ASSERT_FALSE(heap->addTuple(tuple, id));
+    ids.push_back(id);
+  }
+  auto more = fill(2 * TUPLES_PER_PAGE, TUPLES_PER_PAGE);
+  ids.insert(ids.end(), more.begin(), more.end());
+  for (size_t i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(i / TUPLES_PER_PAGE, ids[i].first);
+  }
+
+  const int32_t perPage = TUPLES_PER_PAGE;
+  HeapFile::ColumnRange second{0, perPage + 1, 2 * perPage - 1};
+  EXPECT_FALSE(heap->mayContain(0, second));
+  EXPECT_TRUE(heap->mayContain(1, second));
+  EXPECT_FALSE(heap->mayContain(2, second));
+  EXPECT_FALSE(heap->mayContain(3, second));
+  EXPECT_FALSE(heap->mayContain(1, HeapFile::ColumnRange{0, 5, 4}));
+  // No zone map for the second column.
+  EXPECT_TRUE(heap->mayContain(0, HeapFile::ColumnRange{1, -1, -1}));
+
+  // Pages not read are visited as a whole.
+  std::vector<page_id_t> pages;
+  ASSERT_FALSE(heap->scan(Snapshot{}, 0, NUM_PAGES, second,
+                          [&](const TupleId &id, iovec) {
+                            pages.push_back(id.first);
+                            return true;
+                          }));
+  EXPECT_EQ(TUPLES_PER_PAGE, pages.size());
+  for (page_id_t page : pages) {
+    EXPECT_EQ(1, page);
+  }
+}
+
+TEST_F(HeapTest, LargeTupleDoesNotSkipPagesWithRoom) {
+  create(1);
+  // Over half a page, so the second does not fit next to the first.
+  std::vector<unsigned char> large(HeapFile::Page::FREE_BYTES * 3 / 5, 1);
+  iovec tuple;
+  tuple.iov_base = large.data();
+  tuple.iov_len = large.size();
+  TupleId first;
+  TupleId second;
+  ASSERT_FALSE(heap->addTuple(tuple, first));
+  ASSERT_FALSE(heap->addTuple(tuple, second));
+  EXPECT_EQ(0, first.first);
+  EXPECT_EQ(1, second.first);
+
+  // Small tuples still fill the room left on the first page.
+  auto ids = fill(2);
+  EXPECT_EQ(0, ids[0].first);
+  EXPECT_EQ(0, ids[1].first);
+}
+
+TEST_F(HeapTest, CompactionNarrowsZoneMaps) {
+  create(1);
+  auto ids = fill(TUPLES_PER_PAGE);
+  HeapFile::ColumnRange low{0, 0, 1};
+  EXPECT_TRUE(heap->mayContain(0, low));
+  EXPECT_FALSE(heap->deleteTuple(ids[0]));
+  EXPECT_FALSE(heap->deleteTuple(ids[1]));
+  EXPECT_FALSE(heap->mayContain(0, low));
+  EXPECT_TRUE(heap->mayContain(0, HeapFile::ColumnRange{0, 2, 2}));
+}
+
+} // namespace Core
+} // namespace Pig
@@ -0,0 +1,99 @@
+#include "buffer_pool.h"
+#include "disk-manager.h"
+#include "metrics.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class MetricsTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    Metrics::global().setEnabled(true);
+    Metrics::global().reset();
+  }
+};
+
+TEST_F(MetricsTest, BucketsBoundRelativeError) {
+  for (uint64_t v : {0ull, 1ull, 15ull, 16ull, 17ull, 1000ull, 123456789ull,
+                     ~0ull}) {
+    uint32_t b = Metrics::bucketFor(v);
+    ASSERT_LT(b, Metrics::NUM_BUCKETS);
+    uint64_t low = Metrics::bucketLowerBound(b);
+    EXPECT_LE(low, v);
+    EXPECT_LE(v - low, v / Metrics::SUB_BUCKETS);
+  }
+}
+
+TEST_F(MetricsTest, CountersAreSummedOverThreads) {
+  constexpr int numThreads = 8;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < numThreads; ++i) {
+    threads.emplace_back([] {
+      for (int j = 0; j < 1000; ++j) {
+        Metrics::global().add(Counter::HEAP_INSERTS);
+      }
+    });
+  }
+  for (auto &t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(numThreads * 1000u,
+            Metrics::global().snapshot().get(Counter::HEAP_INSERTS));
+}
+
+TEST_F(MetricsTest, HistogramPercentiles) {
+  for (uint64_t v = 1; v <= 10000; ++v) {
+    Metrics::global().record(Histogram::HEAP_INSERT_LATENCY, v);
+  }
+  auto s = Metrics::global().snapshot().get(Histogram::HEAP_INSERT_LATENCY);
+  EXPECT_EQ(10000u, s.m_count);
+  EXPECT_EQ(1u, s.m_min);
+  EXPECT_NEAR(5000, s.m_p50, 5000 / Metrics::SUB_BUCKETS);
+  EXPECT_NEAR(9900, s.m_p99, 9900 / Metrics::SUB_BUCKETS);
+  EXPECT_NEAR(10000, s.m_max, 10000 / Metrics::SUB_BUCKETS);
+}
+
+TEST_F(MetricsTest, DisabledRecordsNothing) {
+  Metrics::global().setEnabled(false);
+  Metrics::global().add(Counter::DISK_READS);
+  Metrics::global().record(Histogram::HEAP_INSERT_LATENCY, 10);
+  Metrics::global().setEnabled(true);
+
+  auto snap = Metrics::global().snapshot();
+  EXPECT_EQ(0u, snap.get(Counter::DISK_READS));
+  EXPECT_EQ(0u, snap.get(Histogram::HEAP_INSERT_LATENCY).m_count);
+}
+
+TEST_F(MetricsTest, BufferPoolAndDiskAreInstrumented) {
+  auto diskManager = std::make_shared<DiskManager>();
+  IoId_t id = diskManager->registerFile(4 * PAGE_SIZE_B);
+  BufferPool pool(2, diskManager);
+
+  { auto guard = pool.GetPage(id, 0); }
+  { auto guard = pool.GetPage(id, 0); }
+  { auto guard = pool.GetPage(id, 1); }
+  { auto guard = pool.GetPage(id, 2); }
+
+  auto snap = Metrics::global().snapshot();
+  EXPECT_EQ(1u, snap.get(Counter::BUFFER_POOL_HITS));
+  EXPECT_EQ(3u, snap.get(Counter::BUFFER_POOL_MISSES));
+  EXPECT_EQ(1u, snap.get(Counter::BUFFER_POOL_EVICTIONS));
+  EXPECT_EQ(3u, snap.get(Counter::DISK_READS));
+  EXPECT_EQ(3u * PAGE_SIZE_B, snap.get(Counter::DISK_READ_BYTES));
+  EXPECT_EQ(3u, snap.get(Histogram::BUFFER_POOL_MISS_LATENCY).m_count);
+  EXPECT_DOUBLE_EQ(0.25, snap.bufferPoolHitRatio());
+
+  std::string json = snap.toJson();
+  EXPECT_NE(std::string::npos, json.find("\"buffer_pool_hits\":1"));
+  EXPECT_NE(std::string::npos, json.find("\"buffer_pool_miss_latency_ns\""));
+  EXPECT_NE(std::string::npos,
+            snap.toText().find("buffer_pool_hit_ratio 0.2500"));
+}
+
+} // namespace Core
+} // namespace Pig
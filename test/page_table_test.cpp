@@ -0,0 +1,83 @@
+#include "page_table.h"
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <random>
+#include <unordered_map>
+
+namespace Pig {
+namespace Core {
+
+using Table = PageTable<uint64_t, uint32_t>;
+
+TEST(PageTableTest, InsertFindErase) {
+  Table table(8);
+  uint32_t value;
+
+  EXPECT_FALSE(table.find(1, value));
+  table.insert(1, 10);
+  table.insert(uint64_t{1} << 48 | 1, 11);
+  EXPECT_EQ(2u, table.size());
+
+  ASSERT_TRUE(table.find(1, value));
+  EXPECT_EQ(10u, value);
+  ASSERT_TRUE(table.find(uint64_t{1} << 48 | 1, value));
+  EXPECT_EQ(11u, value);
+
+  EXPECT_TRUE(table.erase(1));
+  EXPECT_FALSE(table.erase(1));
+  EXPECT_FALSE(table.find(1, value));
+  EXPECT_EQ(1u, table.size());
+}
+
+TEST(PageTableTest, SizedFromEntriesAndGrowsOnReserve) {
+  Table table(100);
+  size_t capacity = table.capacity();
+  EXPECT_GE(capacity, 200u);
+
+  for (uint32_t i = 0; i < 100; ++i) {
+    table.insert(i, i);
+  }
+  EXPECT_EQ(capacity, table.capacity());
+
+  table.reserve(1000);
+  EXPECT_GE(table.capacity(), 2000u);
+  uint32_t value;
+  for (uint32_t i = 0; i < 100; ++i) {
+    ASSERT_TRUE(table.find(i, value));
+    EXPECT_EQ(i, value);
+  }
+}
+
+// Mirrors random inserts and erases against std::unordered_map, as in a
+// buffer pool under eviction churn.
+TEST(PageTableTest, MatchesUnorderedMapUnderChurn) {
+  constexpr size_t NUM_FRAMES = 512;
+  Table table(NUM_FRAMES);
+  std::unordered_map<uint64_t, uint32_t> expected;
+  std::mt19937_64 rng(7);
+
+  for (uint32_t op = 0; op < 100000; ++op) {
+    uint64_t key = (rng() % 4) << 48 | (rng() % 2048);
+    uint32_t value;
+    if (expected.count(key)) {
+      ASSERT_TRUE(table.find(key, value));
+      ASSERT_EQ(expected[key], value);
+      ASSERT_TRUE(table.erase(key));
+      expected.erase(key);
+    } else if (expected.size() < NUM_FRAMES) {
+      ASSERT_FALSE(table.find(key, value));
+      table.insert(key, op);
+      expected[key] = op;
+    }
+    ASSERT_EQ(expected.size(), table.size());
+  }
+
+  for (auto [key, v] : expected) {
+    uint32_t value;
+    ASSERT_TRUE(table.find(key, value));
+    EXPECT_EQ(v, value);
+  }
+}
+
+} // namespace Core
+} // namespace Pig
@@ -0,0 +1,80 @@
+#include "task_scheduler.h"
+#include <atomic>
+#include <chrono>
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+TEST(TaskSchedulerTest, RunsEveryMorselOnce) {
+  TaskScheduler scheduler(4);
+  for (size_t numMorsels : {0, 1, 3, 4, 1000}) {
+    std::vector<std::atomic<int>> runs(numMorsels);
+    scheduler.parallelFor(numMorsels, [&](uint32_t worker, size_t morsel) {
+      EXPECT_LT(worker, scheduler.getNumWorkers());
+      runs[morsel].fetch_add(1);
+    });
+    for (auto &r : runs) {
+      EXPECT_EQ(1, r.load());
+    }
+  }
+}
+
+TEST(TaskSchedulerTest, IdleWorkersSteal) {
+  TaskScheduler scheduler(2);
+  // Worker 0 is dealt morsels [0, 8) and stalls on the first one, so the
+  // rest of its block must be stolen for the job to finish early.
+  std::atomic<bool> stolen{false};
+  std::vector<uint32_t> ranBy(16);
+  scheduler.parallelFor(16, [&](uint32_t worker, size_t morsel) {
+    ranBy[morsel] = worker;
+    if (morsel == 0) {
+      while (!stolen.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    } else if (morsel < 8 && worker == 1) {
+      stolen = true;
+    }
+  });
+  EXPECT_TRUE(stolen.load());
+  EXPECT_EQ(1u, ranBy[7]);
+}
+
+TEST(TaskSchedulerTest, ConcurrentJobs) {
+  TaskScheduler scheduler(3);
+  std::vector<std::thread> callers;
+  std::atomic<size_t> total{0};
+  for (int c = 0; c < 4; ++c) {
+    callers.emplace_back([&] {
+      for (int job = 0; job < 50; ++job) {
+        scheduler.parallelFor(
+            10, [&](uint32_t, size_t morsel) { total.fetch_add(morsel); });
+      }
+    });
+  }
+  for (auto &c : callers) {
+    c.join();
+  }
+  EXPECT_EQ(4u * 50 * 45, total.load());
+}
+
+TEST(TaskSchedulerTest, RethrowsFirstException) {
+  TaskScheduler scheduler(2);
+  EXPECT_THROW(scheduler.parallelFor(100,
+                                     [](uint32_t, size_t morsel) {
+                                       if (morsel == 42) {
+                                         throw std::runtime_error("morsel");
+                                       }
+                                     }),
+               std::runtime_error);
+  // Still usable afterwards.
+  std::atomic<size_t> runs{0};
+  scheduler.parallelFor(10, [&](uint32_t, size_t) { runs.fetch_add(1); });
+  EXPECT_EQ(10u, runs.load());
+}
+
+} // namespace Core
+} // namespace Pig
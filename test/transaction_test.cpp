@@ -0,0 +1,272 @@
+#include "buffer_pool.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include "transaction.h"
+#include <atomic>
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <memory>
+#include <sys/uio.h>
+#include <thread>
+#include <vector>
+
+namespace Pig {
+namespace Core {
+
+class TransactionTest : public ::testing::Test {
+protected:
+  void SetUp() override {
+    auto diskManager = std::make_shared<DiskManager>();
+    auto pool = std::make_shared<BufferPool>(
+        NUM_PAGES + HeapFile::RESERVED_PAGES, diskManager);
+    heap = HeapFile::create(diskManager, pool, PAGE_SIZE_B, NUM_PAGES);
+  }
+
+  TupleId insert(WriteTransaction &txn, int32_t value) {
+    iovec buf;
+    buf.iov_base = &value;
+    buf.iov_len = sizeof(value);
+    TupleId id;
+    EXPECT_FALSE(heap->addTuple(txn, buf, id));
+    return id;
+  }
+
+  // Sum of values visible in snapshot.
+  int64_t sum(const Snapshot &snapshot) {
+    int64_t total = 0;
+    auto err = heap->scan(snapshot, [&total](const TupleId &, iovec payload) {
+      total += *static_cast<int32_t *>(payload.iov_base);
+      return true;
+    });
+    EXPECT_FALSE(err);
+    return total;
+  }
+
+  static constexpr page_id_t NUM_PAGES = 16;
+  TransactionManager txnManager;
+  std::unique_ptr<HeapFile> heap;
+};
+
+TEST_F(TransactionTest, SnapshotDoesNotSeeLaterCommits) {
+  auto before = txnManager.snapshot();
+  auto txn = txnManager.beginWrite();
+  TupleId id = insert(txn, 7);
+
+  // Writer sees its own insert, readers do not till commit.
+  EXPECT_EQ(7, sum(txn.getSnapshot()));
+  EXPECT_EQ(0, sum(txnManager.snapshot()));
+  txn.commit();
+
+  EXPECT_EQ(0, sum(before));
+  EXPECT_EQ(7, sum(txnManager.snapshot()));
+
+  std::vector<unsigned char> payload;
+  EXPECT_EQ(ERR_NOT_FOUND, heap->getTuple(before, id, payload).code());
+  EXPECT_FALSE(heap->getTuple(txnManager.snapshot(), id, payload));
+}
+
+TEST_F(TransactionTest, DeleteHidesTupleFromLaterSnapshots) {
+  auto txn = txnManager.beginWrite();
+  TupleId id = insert(txn, 3);
+  insert(txn, 4);
+  txn.commit();
+
+  auto before = txnManager.snapshot();
+  auto del = txnManager.beginWrite();
+  EXPECT_FALSE(heap->deleteTuple(del, id));
+  EXPECT_EQ(ERR_NOT_FOUND, heap->deleteTuple(del, id).code());
+  EXPECT_EQ(4, sum(del.getSnapshot()));
+  del.commit();
+
+  EXPECT_EQ(7, sum(before));
+  EXPECT_EQ(4, sum(txnManager.snapshot()));
+}
+
+TEST_F(TransactionTest, TupleViewDoesNotBlockWriters) {
+  auto txn = txnManager.beginWrite();
+  TupleId id = insert(txn, 7);
+  txn.commit();
+
+  auto before = txnManager.snapshot();
+  HeapFile::TupleView view;
+  ASSERT_FALSE(heap->viewTuple(before, id, view));
+  ASSERT_TRUE(view.holdsTuple());
+  ASSERT_EQ(sizeof(int32_t), view.size());
+
+  // The view only pins the page, writers still latch it.
+  auto writer = txnManager.beginWrite();
+  TupleId other = insert(writer, 8);
+  EXPECT_FALSE(heap->deleteTuple(writer, id));
+  writer.commit();
+  EXPECT_EQ(7, *reinterpret_cast<const int32_t *>(view.data()));
+
+  HeapFile::TupleView moved = std::move(view);
+  EXPECT_FALSE(view.holdsTuple());
+  EXPECT_TRUE(moved.holdsTuple());
+
+  EXPECT_EQ(ERR_NOT_FOUND, heap->viewTuple(before, other, moved).code());
+  EXPECT_FALSE(moved.holdsTuple());
+  EXPECT_EQ(ERR_NOT_FOUND,
+            heap->viewTuple(txnManager.snapshot(), id, moved).code());
+}
+
+TEST_F(TransactionTest, ScanDoesNotBlockWriters) {
+  auto txn = txnManager.beginWrite();
+  TupleId id = insert(txn, 7);
+  txn.commit();
+
+  // The page being visited is not latched, so a writer deletes from it
+  // meanwhile.
+  auto writer = txnManager.beginWrite();
+  int visited = 0;
+  auto err = heap->scan(txnManager.snapshot(), [&](const TupleId &, iovec) {
+    std::thread([&] { EXPECT_FALSE(heap->deleteTuple(writer, id)); }).join();
+    ++visited;
+    return true;
+  });
+  EXPECT_FALSE(err);
+  EXPECT_EQ(1, visited);
+  writer.commit();
+  EXPECT_EQ(0, sum(txnManager.snapshot()));
+}
+
+TEST_F(TransactionTest, AbortUndoesChanges) {
+  auto txn = txnManager.beginWrite();
+  TupleId id = insert(txn, 5);
+  txn.commit();
+
+  {
+    // Dropped without commit.
+    auto aborted = txnManager.beginWrite();
+    insert(aborted, 100);
+    EXPECT_FALSE(heap->deleteTuple(aborted, id));
+  }
+  EXPECT_EQ(5, sum(txnManager.snapshot()));
+
+  // Aborted id is reused, the undone insert must stay invisible.
+  auto next = txnManager.beginWrite();
+  insert(next, 1);
+  next.commit();
+  EXPECT_EQ(6, sum(txnManager.snapshot()));
+}
+
+TEST_F(TransactionTest, AbortUndoesPartOfFailedBatch) {
+  // One frame and two data pages, so the batch can not fetch its second
+  // page while the first is pinned.
+  auto diskManager = std::make_shared<DiskManager>();
+  auto pool = std::make_shared<BufferPool>(1, diskManager);
+  heap = HeapFile::create(diskManager, pool, PAGE_SIZE_B, 2);
+
+  auto txn = txnManager.beginWrite();
+  TupleId small = insert(txn, 5);
+  // The large tuple goes to the other page, leaving more room on the
+  // page of the small one which the batch then fills first.
+  std::vector<int32_t> large(64, 0);
+  iovec buf;
+  buf.iov_base = large.data();
+  buf.iov_len = large.size() * sizeof(int32_t);
+  TupleId other;
+  ASSERT_FALSE(heap->addTuple(txn, buf, other));
+  ASSERT_NE(small.first, other.first);
+  txn.commit();
+
+  HeapFile::TupleView view;
+  ASSERT_FALSE(heap->viewTuple(small, view));
+  int32_t one = 1;
+  iovec tuple;
+  tuple.iov_base = &one;
+  tuple.iov_len = sizeof(one);
+  size_t count = HeapFile::Page::FREE_BYTES /
+                     HeapFile::Page::spaceForTuple(HeapFile::Tuple(0, tuple)) +
+                 1;
+  std::vector<iovec> tuples(count, tuple);
+  std::vector<TupleId> ids(count);
+  {
+    auto failed = txnManager.beginWrite();
+    EXPECT_EQ(ERR_NO_FREE_FRAME,
+              heap->addTuples(failed, tuples.data(), count, ids.data()).code());
+    // The first page was filled before the failure.
+    ASSERT_EQ(small.first, ids[0].first);
+    std::vector<unsigned char> payload;
+    EXPECT_FALSE(heap->getTuple(failed.getSnapshot(), ids[0], payload));
+    view.release();
+  }
+
+  // The aborted id is reused, the tuples placed before the failure must
+  // not show when it commits.
+  auto next = txnManager.beginWrite();
+  insert(next, 1);
+  next.commit();
+  EXPECT_EQ(6, sum(txnManager.snapshot()));
+  std::vector<unsigned char> payload;
+  EXPECT_EQ(ERR_NOT_FOUND,
+            heap->getTuple(txnManager.snapshot(), ids[0], payload).code());
+}
+
+TEST_F(TransactionTest, VacuumRemovesInvisibleVersions) {
+  auto txn = txnManager.beginWrite();
+  std::vector<TupleId> ids;
+  for (int32_t value = 1; value <= 10; ++value) {
+    ids.push_back(insert(txn, value));
+  }
+  txn.commit();
+
+  auto del = txnManager.beginWrite();
+  for (size_t i = 0; i < ids.size(); i += 2) {
+    EXPECT_FALSE(heap->deleteTuple(del, ids[i]));
+  }
+  del.commit();
+  {
+    auto aborted = txnManager.beginWrite();
+    insert(aborted, 100);
+  }
+
+  // A snapshot from before the delete still needs the old versions.
+  auto before = Snapshot{txnManager.getCommitted() - 1};
+  size_t removed;
+  ASSERT_FALSE(heap->vacuum(before.m_committed, removed));
+  EXPECT_EQ(1u, removed);
+  EXPECT_EQ(55, sum(before));
+
+  ASSERT_FALSE(heap->vacuum(txnManager.getCommitted(), removed));
+  EXPECT_EQ(5u, removed);
+  EXPECT_EQ(30, sum(txnManager.snapshot()));
+  ASSERT_FALSE(heap->vacuum(txnManager.getCommitted(), removed));
+  EXPECT_EQ(0u, removed);
+
+  std::vector<unsigned char> payload;
+  EXPECT_EQ(ERR_NOT_FOUND, heap->getTuple(ids[0], payload).code());
+  EXPECT_FALSE(heap->getTuple(ids[1], payload));
+}
+
+TEST_F(TransactionTest, ReadersSeeConsistentSnapshotsDuringInserts) {
+  // Each transaction inserts +1 and -1, so every snapshot sums to 0.
+  std::atomic_bool stop{false};
+  std::thread writer([&] {
+    for (int i = 0; i < 500; ++i) {
+      auto txn = txnManager.beginWrite();
+      insert(txn, 1);
+      insert(txn, -1);
+      txn.commit();
+    }
+    stop = true;
+  });
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 4; ++r) {
+    readers.emplace_back([&] {
+      while (!stop) {
+        EXPECT_EQ(0, sum(txnManager.snapshot()));
+      }
+    });
+  }
+  writer.join();
+  for (auto &reader : readers) {
+    reader.join();
+  }
+  EXPECT_EQ(500u + FROZEN_TXN_ID, txnManager.getCommitted());
+}
+
+} // namespace Core
+} // namespace Pig
\ No newline at end of file
@@ -0,0 +1,608 @@
+/**
+    Macro workload driver, a YCSB like load generator over the storage
+    engine.
+
+    It creates tables with an integer primary key and a few integer columns,
+    preloads them and then runs a mix of inserts, point selects and short
+    range scans from many threads with Zipfian key skew. At the end it reports
+    throughput and latency percentiles per operation along with buffer pool
+    and disk metrics, so pool sizes and eviction policies can be compared on
+    a given access pattern.
+
+    Tables live in HeapFile through a shared BufferPool. Until the B+ tree
+    lands, the primary index is an ordered in memory map from key to TupleId.
+
+    Usage: pigdb_workload [--name=value]...  (see --help)
+ */
+#include "buffer_pool.h"
+#include "buffer_pool_manager.h"
+#include "core.h"
+#include "disk-manager.h"
+#include "heap.h"
+#include "metrics.h"
+#include "util.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+using namespace Pig::Core;
+
+namespace {
+
+    enum Op : uint8_t { INSERT = 0, READ, SCAN, NUM_OPS };
+
+    constexpr std::array<const char *, NUM_OPS> OP_NAMES = {"insert", "read",
+                                                            "scan"};
+
+    struct Options {
+        uint32_t       m_threads     = 4;
+        uint32_t       m_durationSec = 10;
+        uint32_t       m_tables      = 1;
+        uint64_t       m_records     = 100000;
+        uint64_t       m_maxRecords  = 0; // 0 means 2 * m_records
+        uint32_t       m_numCols     = 4;
+        uint32_t       m_mix[NUM_OPS] = {5, 90, 5};
+        uint32_t       m_scanLength  = 100;
+        double         m_zipfTheta   = 0.99;
+        page_size_t    m_pageSize    = PAGE_SIZE_B;
+        size_t         m_poolFrames  = 4096;
+        EvictionPolicy m_eviction    = EvictionPolicy::CLOCK;
+        uint64_t       m_seed        = 42;
+        bool           m_json        = false;
+    };
+
+    void usage() {
+        fmt::print(
+            "pigdb_workload [--name=value]...\n"
+            "  --workload=ycsb-b|ycsb-c|ycsb-e|insert  preset mix\n"
+            "  --mix=I:R:S        insert, read, scan percentages (5:90:5)\n"
+            "  --threads=N        worker threads (4)\n"
+            "  --duration=S       seconds to run after load (10)\n"
+            "  --tables=N         tables, picked uniformly per op (1)\n"
+            "  --records=N        records preloaded per table (100000)\n"
+            "  --max-records=N    heap capacity per table (2 * records)\n"
+            "  --cols=N           integer columns besides the key (4)\n"
+            "  --scan-length=N    records per scan (100)\n"
+            "  --zipf=THETA       key skew in [0, 1), 0 is uniform (0.99)\n"
+            "  --page-size=KB     page size of tables (4)\n"
+            "  --pool-frames=N    buffer pool frames (4096)\n"
+            "  --eviction=clock|random\n"
+            "  --seed=N           seed of all generators (42)\n"
+            "  --json             print report as JSON\n");
+    }
+
+    bool parseMix(const std::string &value, Options &opts) {
+        uint32_t mix[NUM_OPS];
+        if (std::sscanf(value.c_str(), "%u:%u:%u", &mix[INSERT], &mix[READ],
+                        &mix[SCAN]) != 3 ||
+            mix[INSERT] + mix[READ] + mix[SCAN] != 100) {
+            return false;
+        }
+        std::copy(std::begin(mix), std::end(mix), std::begin(opts.m_mix));
+        return true;
+    }
+
+    // Whole of value as a number, false on anything else.
+    template <typename T> bool parseNumber(const std::string &value, T &out) {
+        const char *last = value.data() + value.size();
+        auto [end, ec]   = std::from_chars(value.data(), last, out);
+        return !value.empty() && ec == std::errc() && end == last;
+    }
+
+    struct TableLayout {
+        uint64_t m_numPages = 0;
+        // Records that fit, 0 if a record does not fit a page.
+        uint64_t m_capacity = 0;
+    };
+
+    TableLayout layoutFor(const Options &opts) {
+        uint64_t tupleBytes = sizeof(int32_t) * (1 + uint64_t{opts.m_numCols});
+        if (tupleBytes > HeapFile::Page::freeBytesFor(opts.m_pageSize)) {
+            return {};
+        }
+        iovec tuple;
+        tuple.iov_base         = nullptr;
+        tuple.iov_len          = tupleBytes;
+        uint32_t tuplesPerPage = HeapFile::Page::freeBytesFor(
+                                     opts.m_pageSize) /
+                                 HeapFile::Page::spaceForTuple(
+                                     HeapFile::Tuple(0, tuple));
+        if (tuplesPerPage < 2) {
+            return {};
+        }
+        // A tuple of slack per page as pages fill unevenly, and a page
+        // per thread as inserts take pages out of the free space map.
+        TableLayout layout;
+        layout.m_numPages = std::min<uint64_t>(
+            MAX_PAGES,
+            opts.m_maxRecords / (tuplesPerPage - 1) + 1 + opts.m_threads);
+        layout.m_capacity = layout.m_numPages * (tuplesPerPage - 1);
+        return layout;
+    }
+
+    bool parseArgs(int argc, char **argv, Options &opts) {
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (arg == "--json") {
+                opts.m_json = true;
+                continue;
+            }
+            auto eq = arg.find('=');
+            if (arg.rfind("--", 0) != 0 || eq == std::string::npos) {
+                return false;
+            }
+            std::string name  = arg.substr(2, eq - 2);
+            std::string value = arg.substr(eq + 1);
+
+            bool ok = true;
+            if (name == "workload") {
+                if (value == "ycsb-b") {
+                    parseMix("5:95:0", opts);
+                } else if (value == "ycsb-c") {
+                    parseMix("0:100:0", opts);
+                } else if (value == "ycsb-e") {
+                    parseMix("5:0:95", opts);
+                } else if (value == "insert") {
+                    parseMix("100:0:0", opts);
+                } else {
+                    ok = false;
+                }
+            } else if (name == "mix") {
+                ok = parseMix(value, opts);
+            } else if (name == "threads") {
+                ok = parseNumber(value, opts.m_threads);
+            } else if (name == "duration") {
+                ok = parseNumber(value, opts.m_durationSec);
+            } else if (name == "tables") {
+                ok = parseNumber(value, opts.m_tables);
+            } else if (name == "records") {
+                ok = parseNumber(value, opts.m_records);
+            } else if (name == "max-records") {
+                ok = parseNumber(value, opts.m_maxRecords);
+            } else if (name == "cols") {
+                ok = parseNumber(value, opts.m_numCols);
+            } else if (name == "scan-length") {
+                ok = parseNumber(value, opts.m_scanLength);
+            } else if (name == "zipf") {
+                ok = parseNumber(value, opts.m_zipfTheta);
+            } else if (name == "page-size") {
+                uint32_t kb = 0;
+                ok = parseNumber(value, kb) && kb <= MAX_PAGE_SIZE_KB;
+                opts.m_pageSize = kb * 1024;
+            } else if (name == "pool-frames") {
+                ok = parseNumber(value, opts.m_poolFrames);
+            } else if (name == "eviction") {
+                if (value == "clock") {
+                    opts.m_eviction = EvictionPolicy::CLOCK;
+                } else if (value == "random") {
+                    opts.m_eviction = EvictionPolicy::RANDOM;
+                } else {
+                    ok = false;
+                }
+            } else if (name == "seed") {
+                ok = parseNumber(value, opts.m_seed);
+            } else {
+                ok = false;
+            }
+            if (!ok) {
+                return false;
+            }
+        }
+        if (opts.m_maxRecords == 0) {
+            opts.m_maxRecords = 2 * opts.m_records;
+        }
+        if (opts.m_threads == 0 || opts.m_tables == 0 ||
+            opts.m_tables > MAX_TABLES || opts.m_records == 0 ||
+            opts.m_maxRecords < opts.m_records || opts.m_zipfTheta < 0 ||
+            opts.m_zipfTheta >= 1 || !isValidPageSize(opts.m_pageSize)) {
+            return false;
+        }
+        // Pages are capped at MAX_PAGES, so the preload may not fit.
+        return opts.m_records <= layoutFor(opts).m_capacity;
+    }
+
+    /**
+        Zipfian ranks in [0, n) as in YCSB(Gray et al, "Quickly generating
+        billion record synthetic databases"), rank 0 is the most popular.
+     */
+    class ZipfianGenerator {
+      public:
+        ZipfianGenerator(uint64_t n, double theta)
+            : m_n{n}, m_theta{theta}, m_alpha{1 / (1 - theta)},
+              m_zetan{zeta(n, theta)} {
+            double zeta2 = zeta(2, theta);
+            m_eta        = (1 - std::pow(2.0 / n, 1 - theta)) /
+                    (1 - zeta2 / m_zetan);
+        }
+
+        template <typename Rng> uint64_t next(Rng &rng) const {
+            if (m_theta == 0) {
+                return std::uniform_int_distribution<uint64_t>(0, m_n - 1)(rng);
+            }
+            double u  = std::uniform_real_distribution<double>(0, 1)(rng);
+            double uz = u * m_zetan;
+            if (uz < 1) {
+                return 0;
+            }
+            if (uz < 1 + std::pow(0.5, m_theta)) {
+                return 1;
+            }
+            return std::min<uint64_t>(
+                m_n - 1, m_n * std::pow(m_eta * u - m_eta + 1, m_alpha));
+        }
+
+      private:
+        static double zeta(uint64_t n, double theta) {
+            double sum = 0;
+            for (uint64_t i = 1; i <= n; ++i) {
+                sum += 1 / std::pow(static_cast<double>(i), theta);
+            }
+            return sum;
+        }
+
+        const uint64_t m_n;
+        const double   m_theta;
+        const double   m_alpha;
+        const double   m_zetan;
+        double         m_eta;
+    };
+
+    // Spreads popular ranks over the key space so hot keys do not cluster
+    // on the same pages.
+    uint64_t fnv1a(uint64_t value) {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (int i = 0; i < 8; ++i) {
+            hash ^= value & 0xFF;
+            hash *= 0x100000001B3ull;
+            value >>= 8;
+        }
+        return hash;
+    }
+
+    struct Table {
+        std::unique_ptr<HeapFile> m_heap;
+        // Keys are dense in [0, m_nextKey).
+        std::atomic_uint64_t m_nextKey{0};
+        uint64_t             m_capacity = 0;
+
+        // Stand-in for the primary index.
+        std::shared_mutex          m_indexLock;
+        std::map<int32_t, TupleId> m_index;
+    };
+
+    struct LatencyHistogram {
+        std::vector<uint64_t> m_buckets =
+            std::vector<uint64_t>(Metrics::NUM_BUCKETS);
+        uint64_t m_count = 0;
+        uint64_t m_max   = 0;
+
+        void record(uint64_t valueNs) {
+            ++m_buckets[Metrics::bucketFor(valueNs)];
+            ++m_count;
+            m_max = std::max(m_max, valueNs);
+        }
+
+        void merge(const LatencyHistogram &other) {
+            for (uint32_t b = 0; b < Metrics::NUM_BUCKETS; ++b) {
+                m_buckets[b] += other.m_buckets[b];
+            }
+            m_count += other.m_count;
+            m_max = std::max(m_max, other.m_max);
+        }
+
+        uint64_t valueAt(double q) const {
+            if (m_count == 0) {
+                return 0;
+            }
+            auto     rank = static_cast<uint64_t>(q * (m_count - 1)) + 1;
+            uint64_t seen = 0;
+            for (uint32_t b = 0; b < Metrics::NUM_BUCKETS; ++b) {
+                seen += m_buckets[b];
+                if (seen >= rank) {
+                    return Metrics::bucketLowerBound(b);
+                }
+            }
+            return m_max;
+        }
+    };
+
+    struct WorkerStats {
+        std::array<LatencyHistogram, NUM_OPS> m_latency;
+        uint64_t                       m_notFound = 0;
+        uint64_t                       m_heapFull = 0;
+    };
+
+    class Workload {
+      public:
+        explicit Workload(const Options &opts)
+            : m_opts{opts}, m_diskManager{std::make_shared<DiskManager>()},
+              m_pools{m_diskManager},
+              m_zipf{opts.m_records, opts.m_zipfTheta} {
+            auto err = m_pools.createPool("heap", opts.m_poolFrames,
+                                          opts.m_pageSize, opts.m_eviction);
+            PIG_ASSERT(!err, "Failed to create buffer pool");
+            auto pool   = m_pools.getPool("heap");
+            auto layout = layoutFor(opts);
+
+            for (uint32_t t = 0; t < opts.m_tables; ++t) {
+                auto table    = std::make_unique<Table>();
+                table->m_heap = HeapFile::create(
+                    m_diskManager, pool, opts.m_pageSize, layout.m_numPages);
+                table->m_capacity = layout.m_capacity;
+                auto assigned =
+                    m_pools.assign(table->m_heap->getIoId(), "heap");
+                PIG_ASSERT(!assigned, "Failed to assign table to pool");
+                m_tables.push_back(std::move(table));
+            }
+        }
+
+        void load() {
+            std::vector<std::thread> loaders;
+            for (uint32_t w = 0; w < m_opts.m_threads; ++w) {
+                loaders.emplace_back([this, w] {
+                    std::vector<int32_t> tuple(1 + m_opts.m_numCols);
+                    for (auto &table : m_tables) {
+                        for (uint64_t k = w; k < m_opts.m_records;
+                             k += m_opts.m_threads) {
+                            insert(*table, k, tuple);
+                        }
+                    }
+                });
+            }
+            for (auto &l : loaders) {
+                l.join();
+            }
+            for (auto &table : m_tables) {
+                table->m_nextKey = m_opts.m_records;
+            }
+        }
+
+        // Runs the mix for the configured duration, returns wall seconds.
+        double run(std::vector<WorkerStats> &stats) {
+            stats.resize(m_opts.m_threads);
+            std::atomic_bool         stop{false};
+            std::vector<std::thread> workers;
+
+            auto start = std::chrono::steady_clock::now();
+            for (uint32_t w = 0; w < m_opts.m_threads; ++w) {
+                workers.emplace_back(
+                    [this, w, &stop, &stats] { work(w, stop, stats[w]); });
+            }
+            std::this_thread::sleep_for(
+                std::chrono::seconds(m_opts.m_durationSec));
+            stop = true;
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            return std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                .count();
+        }
+
+      private:
+        void insert(Table &table, uint64_t key, std::vector<int32_t> &tuple) {
+            tuple[0] = static_cast<int32_t>(key);
+            for (uint32_t c = 1; c < tuple.size(); ++c) {
+                tuple[c] = static_cast<int32_t>(key * c);
+            }
+            iovec buf;
+            buf.iov_base = tuple.data();
+            buf.iov_len  = tuple.size() * sizeof(int32_t);
+
+            TupleId id;
+            auto    err = table.m_heap->addTuple(buf, id);
+            PIG_ASSERT(!err, fmt::format("Insert failed: {}", err.what()));
+
+            std::unique_lock lock(table.m_indexLock);
+            table.m_index.emplace(tuple[0], id);
+        }
+
+        // Skewed key among keys inserted so far.
+        template <typename Rng> int32_t pickKey(Table &table, Rng &rng) {
+            uint64_t numKeys = table.m_nextKey.load(std::memory_order_relaxed);
+            return static_cast<int32_t>(fnv1a(m_zipf.next(rng)) % numKeys);
+        }
+
+        void work(uint32_t worker, const std::atomic_bool &stop,
+                  WorkerStats &stats) {
+            std::mt19937_64 rng(m_opts.m_seed + worker);
+            std::vector<int32_t>       tuple(1 + m_opts.m_numCols);
+            std::vector<unsigned char> payload;
+            std::vector<TupleId>       range;
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                Table   &table = *m_tables[rng() % m_tables.size()];
+                uint32_t dice  = rng() % 100;
+                Op       op    = dice < m_opts.m_mix[INSERT] ? INSERT
+                                 : dice < m_opts.m_mix[INSERT] +
+                                              m_opts.m_mix[READ]
+                                     ? READ
+                                     : SCAN;
+
+                auto start = std::chrono::steady_clock::now();
+                switch (op) {
+                case INSERT: {
+                    // A failed exchange reloads key, retry till the heap
+                    // is full.
+                    uint64_t key = table.m_nextKey.load();
+                    while (key < table.m_capacity &&
+                           !table.m_nextKey.compare_exchange_weak(key,
+                                                                  key + 1)) {
+                    }
+                    if (key >= table.m_capacity) {
+                        ++stats.m_heapFull;
+                        continue;
+                    }
+                    insert(table, key, tuple);
+                    break;
+                }
+                case READ: {
+                    int32_t key = pickKey(table, rng);
+                    TupleId id;
+                    {
+                        std::shared_lock lock(table.m_indexLock);
+                        auto             it = table.m_index.find(key);
+                        if (it == table.m_index.end()) {
+                            // Inserted key not indexed yet.
+                            ++stats.m_notFound;
+                            continue;
+                        }
+                        id = it->second;
+                    }
+                    auto err = table.m_heap->getTuple(id, payload);
+                    PIG_ASSERT(!err && *reinterpret_cast<int32_t *>(
+                                           payload.data()) == key,
+                               "Read returned wrong tuple");
+                    break;
+                }
+                case SCAN: {
+                    int32_t key = pickKey(table, rng);
+                    range.clear();
+                    {
+                        std::shared_lock lock(table.m_indexLock);
+                        for (auto it = table.m_index.lower_bound(key);
+                             it != table.m_index.end() &&
+                             range.size() < m_opts.m_scanLength;
+                             ++it) {
+                            range.push_back(it->second);
+                        }
+                    }
+                    for (const auto &id : range) {
+                        auto err = table.m_heap->getTuple(id, payload);
+                        PIG_ASSERT(!err, "Scan read failed");
+                    }
+                    break;
+                }
+                default:
+                    break;
+                }
+                stats.m_latency[op].record(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count());
+            }
+        }
+
+        const Options                       &m_opts;
+        std::shared_ptr<DiskManager>         m_diskManager;
+        BufferPoolManager                    m_pools;
+        ZipfianGenerator                     m_zipf;
+        std::vector<std::unique_ptr<Table>>  m_tables;
+    };
+
+    void report(const Options &opts, const std::vector<WorkerStats> &stats,
+                double seconds, double loadSeconds) {
+        std::array<LatencyHistogram, NUM_OPS> latency;
+        uint64_t                       notFound = 0, heapFull = 0;
+        for (const auto &s : stats) {
+            for (int op = 0; op < NUM_OPS; ++op) {
+                latency[op].merge(s.m_latency[op]);
+            }
+            notFound += s.m_notFound;
+            heapFull += s.m_heapFull;
+        }
+        uint64_t total = 0;
+        for (const auto &h : latency) {
+            total += h.m_count;
+        }
+        auto metrics = Metrics::global().snapshot();
+
+        if (opts.m_json) {
+            fmt::memory_buffer out;
+            fmt::format_to(std::back_inserter(out),
+                           "{{\"threads\":{},\"tables\":{},\"records\":{},"
+                           "\"mix\":[{},{},{}],\"zipf\":{},\"page_size\":{},"
+                           "\"pool_frames\":{},\"eviction\":\"{}\","
+                           "\"load_seconds\":{:.3f},\"seconds\":{:.3f},"
+                           "\"ops_per_sec\":{:.1f},\"not_found\":{},"
+                           "\"heap_full\":{},\"ops\":{{",
+                           opts.m_threads, opts.m_tables, opts.m_records,
+                           opts.m_mix[INSERT], opts.m_mix[READ],
+                           opts.m_mix[SCAN], opts.m_zipfTheta, opts.m_pageSize,
+                           opts.m_poolFrames,
+                           opts.m_eviction == EvictionPolicy::CLOCK ? "clock"
+                                                                    : "random",
+                           loadSeconds, seconds, total / seconds, notFound,
+                           heapFull);
+            for (int op = 0; op < NUM_OPS; ++op) {
+                const auto &h = latency[op];
+                fmt::format_to(std::back_inserter(out),
+                               "{}\"{}\":{{\"count\":{},\"ops_per_sec\":{:.1f},"
+                               "\"p50_ns\":{},\"p99_ns\":{},\"p999_ns\":{},"
+                               "\"max_ns\":{}}}",
+                               op == 0 ? "" : ",", OP_NAMES[op], h.m_count,
+                               h.m_count / seconds, h.valueAt(0.5),
+                               h.valueAt(0.99), h.valueAt(0.999), h.m_max);
+            }
+            fmt::format_to(std::back_inserter(out), "}},\"metrics\":{}}}\n",
+                           metrics.toJson());
+            fmt::print("{}", fmt::to_string(out));
+            return;
+        }
+
+        fmt::print("threads={} tables={} records={} mix={}:{}:{} zipf={} "
+                   "page={}KB frames={} eviction={}\n",
+                   opts.m_threads, opts.m_tables, opts.m_records,
+                   opts.m_mix[INSERT], opts.m_mix[READ], opts.m_mix[SCAN],
+                   opts.m_zipfTheta, opts.m_pageSize / 1024, opts.m_poolFrames,
+                   opts.m_eviction == EvictionPolicy::CLOCK ? "clock"
+                                                            : "random");
+        fmt::print("load {:.2f}s, run {:.2f}s, {:.0f} ops/s, not found {}, "
+                   "heap full {}\n",
+                   loadSeconds, seconds, total / seconds, notFound, heapFull);
+        fmt::print("{:<8}{:>12}{:>12}{:>12}{:>12}{:>12}{:>12}\n", "op", "count",
+                   "ops/s", "p50(us)", "p99(us)", "p999(us)", "max(us)");
+        for (int op = 0; op < NUM_OPS; ++op) {
+            const auto &h = latency[op];
+            fmt::print("{:<8}{:>12}{:>12.0f}{:>12.1f}{:>12.1f}{:>12.1f}"
+                       "{:>12.1f}\n",
+                       OP_NAMES[op], h.m_count, h.m_count / seconds,
+                       h.valueAt(0.5) / 1e3, h.valueAt(0.99) / 1e3,
+                       h.valueAt(0.999) / 1e3, h.m_max / 1e3);
+        }
+        fmt::print("\n{}", metrics.toText());
+    }
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opts;
+    if (!parseArgs(argc, argv, opts)) {
+        usage();
+        return 1;
+    }
+
+    Workload workload(opts);
+
+    auto loadStart = std::chrono::steady_clock::now();
+    workload.load();
+    double loadSeconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - loadStart)
+                             .count();
+
+    // Only the run phase shows up in metrics.
+    Metrics::global().reset();
+    std::vector<WorkerStats> stats;
+    double                   seconds = workload.run(stats);
+    report(opts, stats, seconds, loadSeconds);
+    return 0;
+}
\ No newline at end of file